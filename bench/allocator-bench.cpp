@@ -0,0 +1,98 @@
+#include "benchmark.h"
+
+#include "splay-tree/pool-allocator.h"
+#include "splay-tree/set.h"
+
+#include <random>
+#include <set>
+
+namespace bench {
+namespace {
+
+template<typename Container>
+void runAllocator(const std::string& containerName, size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "allocators";
+    row.container = containerName;
+    row.workload = "uniform";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    std::mt19937_64 generator(3);
+    std::uniform_int_distribution<uint64_t> randomKey(0, 4 * size);
+
+    Container container;
+    {
+        Timer timer;
+        while (container.size() < size) {
+            container.insert(randomKey(generator));
+        }
+        row.operation = "fill";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / size;
+        rows.push_back(row);
+    }
+
+    {
+        // Steady-state churn: every erased node is replaced by a new one.
+        const size_t operations = 4 * size;
+        Timer timer;
+        for (size_t i = 0; i < operations; ++i) {
+            if (container.erase(randomKey(generator))) {
+                while (!container.insert(randomKey(generator)).second) {
+                }
+            }
+        }
+        row.operation = "churn";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+    }
+
+    {
+        Timer timer;
+        container.clear();
+        row.operation = "clear";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / size;
+        rows.push_back(row);
+    }
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+template<typename Container>
+void runAllocatorIsolated(
+        const Options& options,
+        const std::string& containerName,
+        size_t size) {
+    if (!matchesFilter(options.container, containerName)) {
+        return;
+    }
+    runIsolated([&]() {
+        runAllocator<Container>(containerName, size);
+    });
+}
+
+void runAllocatorSuite(const Options& options) {
+    typedef splay_tree::pool_allocator<uint64_t> PoolAllocator;
+    for (size_t size : options.sizes) {
+        runAllocatorIsolated<splay_tree::set<uint64_t>>(
+            options, "splay_tree::set", size);
+        runAllocatorIsolated<
+            splay_tree::set<uint64_t, std::less<uint64_t>, PoolAllocator>>(
+                options, "splay_tree::set<pool>", size);
+        runAllocatorIsolated<std::set<uint64_t>>(
+            options, "std::set", size);
+        runAllocatorIsolated<
+            std::set<uint64_t, std::less<uint64_t>, PoolAllocator>>(
+                options, "std::set<pool>", size);
+    }
+}
+
+SuiteRegistrar allocatorSuite("allocators", runAllocatorSuite);
+
+} // namespace
+} // namespace bench
@@ -0,0 +1,141 @@
+#include "benchmark.h"
+
+#include "splay-tree/set.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+namespace bench {
+namespace {
+
+// Membership probes in batches of a tenth of the set size, half of them hits,
+// resolved by a loop of find() and by contains_batch(), first in random then
+// in sorted order.
+void runBatch(size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "batch";
+    row.workload = "uniform";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937_64 generator(5);
+    std::shuffle(keys.begin(), keys.end(), generator);
+
+    splay_tree::set<uint64_t> splaySet(keys.begin(), keys.end());
+    std::set<uint64_t> stlSet(keys.begin(), keys.end());
+
+    const size_t batchSize = std::max<size_t>(size / 10, 1);
+    const size_t batches = 10;
+    const size_t operations = batchSize * batches;
+    std::uniform_int_distribution<uint64_t> randomKey(0, 2 * size);
+    std::vector<std::vector<uint64_t>> probeBatches(batches);
+    for (auto& probes : probeBatches) {
+        probes.resize(batchSize);
+        for (auto& probe : probes) {
+            probe = randomKey(generator);
+        }
+    }
+    std::vector<bool> results(batchSize);
+
+    {
+        uint64_t checksum = 0;
+        Timer timer;
+        for (const auto& probes : probeBatches) {
+            for (uint64_t probe : probes) {
+                checksum += stlSet.find(probe) != stlSet.end();
+            }
+        }
+        row.container = "std::set";
+        row.operation = "find-loop";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    row.container = "splay_tree::set";
+    {
+        uint64_t checksum = 0;
+        Timer timer;
+        for (const auto& probes : probeBatches) {
+            for (uint64_t probe : probes) {
+                checksum += splaySet.find(probe) != splaySet.end();
+            }
+        }
+        row.operation = "find-loop";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    {
+        uint64_t checksum = 0;
+        Timer timer;
+        for (const auto& probes : probeBatches) {
+            splaySet.contains_batch(probes.begin(), probes.end(), results.begin());
+            checksum += std::count(results.begin(), results.end(), true);
+        }
+        row.operation = "batch";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    for (auto& probes : probeBatches) {
+        std::sort(probes.begin(), probes.end());
+    }
+
+    {
+        uint64_t checksum = 0;
+        Timer timer;
+        for (const auto& probes : probeBatches) {
+            for (uint64_t probe : probes) {
+                checksum += splaySet.find(probe) != splaySet.end();
+            }
+        }
+        row.operation = "sorted-loop";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    {
+        uint64_t checksum = 0;
+        Timer timer;
+        for (const auto& probes : probeBatches) {
+            splaySet.contains_batch(probes.begin(), probes.end(), results.begin());
+            checksum += std::count(results.begin(), results.end(), true);
+        }
+        row.operation = "sorted-batch";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runBatchSuite(const Options& options) {
+    if (!matchesFilter(options.workload, "uniform")) {
+        return;
+    }
+    for (size_t size : options.sizes) {
+        runIsolated([&]() {
+            runBatch(size);
+        });
+    }
+}
+
+SuiteRegistrar batchSuite("batch", runBatchSuite);
+
+} // namespace
+} // namespace bench
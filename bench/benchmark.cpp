@@ -0,0 +1,82 @@
+#include "benchmark.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+
+namespace bench {
+
+namespace {
+
+// Stores to a volatile cannot be elided, so the values passed to
+// doNotOptimize() must be computed.
+volatile uint64_t sink;
+
+} // namespace
+
+std::vector<Suite>& suites() {
+    static std::vector<Suite> registeredSuites;
+    return registeredSuites;
+}
+
+bool matchesFilter(const std::string& filter, const std::string& name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+double peakRssMegabytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is reported in kilobytes on Linux.
+    return usage.ru_maxrss / 1024.0;
+}
+
+void runIsolated(const std::function<void()>& function) {
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        function();
+        return;
+    }
+    if (pid == 0) {
+        function();
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "benchmark child process failed\n";
+    }
+}
+
+void printHeader() {
+    std::printf("%-12s %-32s %-15s %-12s %10s %12s %12s %10s\n",
+        "suite", "container", "workload", "operation", "n",
+        "ns/op", "rotations/op", "peak MB");
+}
+
+void printRow(const Row& row) {
+    char rotations[32] = "-";
+    if (row.rotationsPerOperation >= 0) {
+        std::snprintf(rotations, sizeof(rotations), "%.2f", row.rotationsPerOperation);
+    }
+    std::printf("%-12s %-32s %-15s %-12s %10zu %12.1f %12s %10.1f\n",
+        row.suite.c_str(),
+        row.container.c_str(),
+        row.workload.c_str(),
+        row.operation.c_str(),
+        row.size,
+        row.nanosecondsPerOperation,
+        rotations,
+        row.peakRssMegabytes);
+    std::fflush(stdout);
+}
+
+void doNotOptimize(uint64_t value) {
+    sink = value;
+}
+
+} // namespace bench
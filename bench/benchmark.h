@@ -0,0 +1,84 @@
+#ifndef SPLAY_TREE_BENCH_BENCHMARK_H_
+#define SPLAY_TREE_BENCH_BENCHMARK_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct Options {
+    std::vector<size_t> sizes;
+    // Empty filters select everything.
+    std::string suite;
+    std::string workload;
+    std::string container;
+};
+
+typedef void (*SuiteFunction)(const Options& options);
+
+struct Suite {
+    const char* name;
+    SuiteFunction run;
+};
+
+std::vector<Suite>& suites();
+
+// Benchmark translation units register their suites with a static
+// SuiteRegistrar, so adding a suite does not require touching main().
+struct SuiteRegistrar {
+    SuiteRegistrar(const char* name, SuiteFunction run) {
+        suites().push_back({name, run});
+    }
+};
+
+bool matchesFilter(const std::string& filter, const std::string& name);
+
+class Timer {
+public:
+    Timer() :
+        start_(std::chrono::steady_clock::now()) {
+    }
+
+    double elapsedNanoseconds() const {
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Peak resident set size of the current process in megabytes.
+double peakRssMegabytes();
+
+// Runs the function in a forked child so that peakRssMegabytes() reported
+// from inside it belongs to this run only. Falls back to running the function
+// in-process if fork() fails.
+void runIsolated(const std::function<void()>& function);
+
+struct Row {
+    std::string suite;
+    std::string container;
+    std::string workload;
+    std::string operation;
+    size_t size;
+    double nanosecondsPerOperation;
+    // Negative when the container does not count rotations.
+    double rotationsPerOperation;
+    double peakRssMegabytes;
+};
+
+void printHeader();
+
+void printRow(const Row& row);
+
+// Keeps the optimizer from discarding results of the measured loops.
+void doNotOptimize(uint64_t value);
+
+} // namespace bench
+
+#endif // SPLAY_TREE_BENCH_BENCHMARK_H_
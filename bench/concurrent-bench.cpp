@@ -0,0 +1,133 @@
+#include "benchmark.h"
+
+#include "splay-tree/concurrent-set.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace bench {
+namespace {
+
+const size_t SHARDS = 64;
+const size_t OPERATIONS_PER_THREAD = 200000;
+
+template<typename ConcurrentSet>
+void fill(ConcurrentSet& set, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        set.insert(2 * i);
+    }
+}
+
+// Every thread runs a mix of 90% lookups, 5% insertions and 5% erasures of
+// uniform keys, half of them present. Reported is the wall-clock time per
+// operation over all threads, i.e. the inverse throughput.
+template<typename ConcurrentSet>
+void runThreads(
+        std::vector<Row>& rows,
+        Row row,
+        ConcurrentSet& set,
+        size_t threadCount) {
+    std::atomic<uint64_t> checksum(0);
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < threadCount; ++thread) {
+        threads.emplace_back([&, thread]() {
+            std::mt19937_64 generator(thread + 1);
+            std::uniform_int_distribution<uint64_t> randomKey(0, 2 * row.size);
+            uint64_t found = 0;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+                const uint64_t key = randomKey(generator);
+                const unsigned operation = i % 20;
+                if (operation == 0) {
+                    set.insert(key);
+                } else if (operation == 1) {
+                    set.erase(key);
+                } else {
+                    found += set.contains(key);
+                }
+            }
+            checksum += found;
+        });
+    }
+
+    Timer timer;
+    start = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    row.operation = "mixed-t" + std::to_string(threadCount);
+    row.nanosecondsPerOperation =
+        timer.elapsedNanoseconds() / (threadCount * OPERATIONS_PER_THREAD);
+    rows.push_back(row);
+    doNotOptimize(checksum.load());
+}
+
+typedef splay_tree::concurrent_set<uint64_t> ConcurrentSet;
+
+std::unique_ptr<ConcurrentSet> createSet(const std::string& containerName, size_t size) {
+    if (containerName == "concurrent_set<hash>") {
+        return std::unique_ptr<ConcurrentSet>(new ConcurrentSet(SHARDS));
+    }
+    if (containerName == "concurrent_set<range>") {
+        std::vector<uint64_t> boundaries;
+        for (size_t i = 1; i < SHARDS; ++i) {
+            boundaries.push_back(2 * size * i / SHARDS);
+        }
+        return std::unique_ptr<ConcurrentSet>(new ConcurrentSet(
+            splay_tree::range_partitioned, boundaries.begin(), boundaries.end()));
+    }
+    // A single shard: one set behind one mutex.
+    return std::unique_ptr<ConcurrentSet>(new ConcurrentSet(1));
+}
+
+void runConcurrent(const std::string& containerName, size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "concurrent";
+    row.container = containerName;
+    row.workload = "uniform";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    for (size_t threadCount = 1; threadCount <= 64; threadCount *= 2) {
+        std::unique_ptr<ConcurrentSet> set = createSet(containerName, size);
+        fill(*set, size);
+        runThreads(rows, row, *set, threadCount);
+    }
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runConcurrentSuite(const Options& options) {
+    if (!matchesFilter(options.workload, "uniform")) {
+        return;
+    }
+    for (size_t size : options.sizes) {
+        for (const char* containerName : {
+                "set+mutex",
+                "concurrent_set<hash>",
+                "concurrent_set<range>"}) {
+            if (!matchesFilter(options.container, containerName)) {
+                continue;
+            }
+            runIsolated([&]() {
+                runConcurrent(containerName, size);
+            });
+        }
+    }
+}
+
+SuiteRegistrar concurrentSuite("concurrent", runConcurrentSuite);
+
+} // namespace
+} // namespace bench
@@ -0,0 +1,251 @@
+#include "benchmark.h"
+#include "workloads.h"
+
+#include "splay-tree/compact-set.h"
+#include "splay-tree/set.h"
+#include "splay-tree/multiset.h"
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+
+namespace bench {
+namespace {
+
+template<typename Container>
+struct RotationCounter {
+    static double rotations(const Container&) {
+        return -1;
+    }
+};
+
+template<typename Container>
+struct SplayRotationCounter {
+    static double rotations(const Container& container) {
+#ifdef SPLAY_TREE_ENABLE_STATS
+        return static_cast<double>(container.stats().rotations);
+#else
+        (void)container;
+        return -1;
+#endif
+    }
+};
+
+template<typename... Args>
+struct RotationCounter<splay_tree::set<Args...>> :
+    SplayRotationCounter<splay_tree::set<Args...>> {
+};
+
+template<typename... Args>
+struct RotationCounter<splay_tree::multiset<Args...>> :
+    SplayRotationCounter<splay_tree::multiset<Args...>> {
+};
+
+template<typename SplayPolicy>
+using PolicySet = splay_tree::set<
+    uint64_t,
+    std::less<uint64_t>,
+    std::allocator<uint64_t>,
+    splay_tree::NullNodeUpdate,
+    SplayPolicy>;
+
+template<typename Container>
+class Measurement {
+public:
+    Measurement(const Container& container, size_t operations) :
+        container_(container),
+        operations_(operations),
+        startRotations_(RotationCounter<Container>::rotations(container)) {
+    }
+
+    void finish(std::vector<Row>& rows, Row row) const {
+        const double nanoseconds = timer_.elapsedNanoseconds();
+        const double rotations = RotationCounter<Container>::rotations(container_);
+        row.nanosecondsPerOperation = nanoseconds / operations_;
+        row.rotationsPerOperation = rotations < 0 ?
+            -1 : (rotations - startRotations_) / operations_;
+        rows.push_back(row);
+    }
+
+private:
+    const Container& container_;
+    size_t operations_;
+    double startRotations_;
+    Timer timer_;
+};
+
+std::vector<uint64_t> shuffledPopulation(size_t size, uint32_t seed) {
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937_64 generator(seed);
+    std::shuffle(keys.begin(), keys.end(), generator);
+    return keys;
+}
+
+template<typename Container>
+void runContainer(
+        const std::string& containerName,
+        Workload workload,
+        size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "containers";
+    row.container = containerName;
+    row.workload = workloadName(workload);
+    row.size = size;
+
+    // Streams are generated up front so that key generation is not measured.
+    std::vector<uint64_t> stream(size);
+    {
+        KeyStream keyStream(workload, size, size, 1);
+        for (auto& key : stream) {
+            key = keyStream.next();
+        }
+    }
+
+    {
+        std::vector<uint64_t> sortedKeys(size);
+        for (size_t i = 0; i < size; ++i) {
+            sortedKeys[i] = 2 * i;
+        }
+        Timer timer;
+        Container container(sortedKeys.begin(), sortedKeys.end());
+        row.operation = "build-sorted";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / size;
+        row.rotationsPerOperation =
+            RotationCounter<Container>::rotations(container) < 0 ? -1 : 0;
+        rows.push_back(row);
+        doNotOptimize(container.size());
+    }
+
+    {
+        Container container;
+        Measurement<Container> measurement(container, size);
+        for (uint64_t key : stream) {
+            container.insert(key);
+        }
+        row.operation = "insert";
+        measurement.finish(rows, row);
+
+        // Forward and reverse scans of the shape the inserts left, a long
+        // path for the sequential workload.
+        {
+            Measurement<Container> iteration(container, container.size());
+            const uint64_t checksum = std::accumulate(
+                container.begin(), container.end(), uint64_t(0));
+            row.operation = "scan-insert";
+            iteration.finish(rows, row);
+            doNotOptimize(checksum);
+        }
+
+        {
+            Measurement<Container> iteration(container, container.size());
+            const uint64_t checksum = std::accumulate(
+                container.rbegin(), container.rend(), uint64_t(0));
+            row.operation = "rscan-insert";
+            iteration.finish(rows, row);
+            doNotOptimize(checksum);
+        }
+    }
+
+    Container container;
+    for (uint64_t key : shuffledPopulation(size, 2)) {
+        container.insert(key);
+    }
+
+    {
+        uint64_t checksum = 0;
+        Measurement<Container> measurement(container, size);
+        for (uint64_t key : stream) {
+            checksum += container.find(key) != container.end();
+        }
+        row.operation = "find";
+        measurement.finish(rows, row);
+        doNotOptimize(checksum);
+    }
+
+    {
+        uint64_t checksum = 0;
+        Measurement<Container> measurement(container, size);
+        for (uint64_t key : stream) {
+            auto it = container.lower_bound(key + 1);
+            checksum += it != container.end() ? *it : 0;
+        }
+        row.operation = "lower_bound";
+        measurement.finish(rows, row);
+        doNotOptimize(checksum);
+    }
+
+    {
+        Measurement<Container> measurement(container, container.size());
+        const uint64_t checksum = std::accumulate(
+            container.begin(), container.end(), uint64_t(0));
+        row.operation = "iterate";
+        measurement.finish(rows, row);
+        doNotOptimize(checksum);
+    }
+
+    {
+        Measurement<Container> measurement(container, size);
+        for (uint64_t key : stream) {
+            container.erase(key);
+        }
+        row.operation = "erase";
+        measurement.finish(rows, row);
+    }
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+template<typename Container>
+void runContainerIsolated(
+        const Options& options,
+        const std::string& containerName,
+        Workload workload,
+        size_t size) {
+    if (!matchesFilter(options.container, containerName)) {
+        return;
+    }
+    runIsolated([&]() {
+        runContainer<Container>(containerName, workload, size);
+    });
+}
+
+void runContainerSuite(const Options& options) {
+    for (size_t size : options.sizes) {
+        for (Workload workload : ALL_WORKLOADS) {
+            if (!matchesFilter(options.workload, workloadName(workload))) {
+                continue;
+            }
+            runContainerIsolated<splay_tree::set<uint64_t>>(
+                options, "splay_tree::set", workload, size);
+            runContainerIsolated<PolicySet<splay_tree::TopDownSplay>>(
+                options, "splay_tree::set<top-down>", workload, size);
+            runContainerIsolated<PolicySet<splay_tree::SemiSplay>>(
+                options, "splay_tree::set<semi-splay>", workload, size);
+            runContainerIsolated<PolicySet<splay_tree::SplayOnWrite>>(
+                options, "splay_tree::set<splay-on-write>", workload, size);
+            runContainerIsolated<PolicySet<splay_tree::SplayEveryKth<8>>>(
+                options, "splay_tree::set<every-8th>", workload, size);
+            runContainerIsolated<splay_tree::compact_set<uint64_t>>(
+                options, "splay_tree::compact_set", workload, size);
+            runContainerIsolated<std::set<uint64_t>>(
+                options, "std::set", workload, size);
+            runContainerIsolated<splay_tree::multiset<uint64_t>>(
+                options, "splay_tree::multiset", workload, size);
+            runContainerIsolated<std::multiset<uint64_t>>(
+                options, "std::multiset", workload, size);
+        }
+    }
+}
+
+SuiteRegistrar containerSuite("containers", runContainerSuite);
+
+} // namespace
+} // namespace bench
@@ -0,0 +1,130 @@
+#include "benchmark.h"
+
+#include "splay-tree/key-of-value.h"
+#include "splay-tree/splay-tree.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bench {
+namespace {
+
+typedef splay_tree::SplayTree<uint64_t, uint64_t, splay_tree::Identity> Tree;
+
+// Probe sequences with locality, over the keys 0, 2, ..., 2 * (size - 1). A
+// walk takes random steps of up to 16 keys either way, a window probes the
+// key entering it and then the one leaving it, 64 keys behind.
+std::vector<uint64_t> makeProbes(
+        const std::string& workload,
+        size_t size,
+        size_t count) {
+    std::vector<uint64_t> probes(count);
+    std::mt19937_64 generator(size);
+    if (workload == "walk") {
+        std::uniform_int_distribution<int64_t> step(-16, 16);
+        int64_t position = size / 2;
+        for (auto& probe : probes) {
+            position = std::max<int64_t>(
+                0, std::min<int64_t>(size - 1, position + step(generator)));
+            probe = 2 * position + (generator() & 1);
+        }
+    } else {
+        const size_t width = std::min<size_t>(64, size);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t entering = (i / 2) % size;
+            probes[i] = 2 * (i % 2 ? (entering + size - width) % size : entering);
+        }
+    }
+    return probes;
+}
+
+void runFinger(const std::string& workload, size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "finger";
+    row.workload = workload;
+    row.size = size;
+
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    const size_t operations = std::max<size_t>(size, 1 << 20);
+    const std::vector<uint64_t> probes = makeProbes(workload, size, operations);
+
+    {
+        std::set<uint64_t> stlSet(keys.begin(), keys.end());
+        uint64_t checksum = 0;
+        Timer timer;
+        for (uint64_t probe : probes) {
+            auto it = stlSet.lower_bound(probe);
+            checksum += it == stlSet.end() ? 0 : *it;
+        }
+        row.container = "std::set";
+        row.operation = "lower_bound";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        row.rotationsPerOperation = -1;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    }
+
+    row.container = "SplayTree";
+    auto measure = [&](const char* operation, bool useFinger, bool splays) {
+        Tree tree(splay_tree::from_sorted, keys.begin(), keys.end());
+        const Tree& constTree = tree;
+        auto finger = tree.finger(splays);
+        tree.resetStats();
+        uint64_t checksum = 0;
+        Timer timer;
+        for (uint64_t probe : probes) {
+            if (useFinger) {
+                auto it = finger.seek(probe);
+                checksum += it == tree.end() ? 0 : *it;
+            } else if (splays) {
+                auto it = tree.lower_bound(probe);
+                checksum += it == tree.end() ? 0 : *it;
+            } else {
+                auto it = constTree.lower_bound(probe);
+                checksum += it == tree.cend() ? 0 : *it;
+            }
+        }
+        row.operation = operation;
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        row.rotationsPerOperation =
+            static_cast<double>(tree.stats().rotations) / operations;
+        rows.push_back(row);
+        doNotOptimize(checksum);
+    };
+    measure("lower_bound", false, true);
+    measure("const-lb", false, false);
+    measure("finger", true, false);
+    measure("finger-splay", true, true);
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runFingerSuite(const Options& options) {
+    for (const char* workload : {"walk", "window"}) {
+        if (!matchesFilter(options.workload, workload) ||
+                !matchesFilter(options.container, "SplayTree")) {
+            continue;
+        }
+        for (size_t size : options.sizes) {
+            runIsolated([&]() {
+                runFinger(workload, size);
+            });
+        }
+    }
+}
+
+SuiteRegistrar fingerSuite("finger", runFingerSuite);
+
+} // namespace
+} // namespace bench
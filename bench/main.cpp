@@ -0,0 +1,75 @@
+#include "benchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+        "  --min-size=N     smallest container size (default 1000)\n"
+        "  --max-size=N     largest container size, sizes grow by 10x\n"
+        "                   (default 1000000, up to 100000000)\n"
+        "  --suite=NAME     run only suites whose name contains NAME\n"
+        "  --workload=NAME  run only workloads whose name contains NAME\n"
+        "  --container=NAME run only containers whose name contains NAME\n"
+        "  --list           list registered suites\n";
+}
+
+bool parseOption(const char* argument, const char* name, std::string& value) {
+    const size_t length = std::strlen(name);
+    if (std::strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        value = argument + length + 1;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    size_t minSize = 1000;
+    size_t maxSize = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (parseOption(argv[i], "--min-size", value)) {
+            minSize = static_cast<size_t>(std::atof(value.c_str()));
+        } else if (parseOption(argv[i], "--max-size", value)) {
+            maxSize = static_cast<size_t>(std::atof(value.c_str()));
+        } else if (parseOption(argv[i], "--suite", value)) {
+            options.suite = value;
+        } else if (parseOption(argv[i], "--workload", value)) {
+            options.workload = value;
+        } else if (parseOption(argv[i], "--container", value)) {
+            options.container = value;
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            for (const auto& suite : bench::suites()) {
+                std::cout << suite.name << "\n";
+            }
+            return 0;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (minSize == 0 || minSize > maxSize) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    for (size_t size = minSize; size <= maxSize; size *= 10) {
+        options.sizes.push_back(size);
+    }
+
+    bench::printHeader();
+    for (const auto& suite : bench::suites()) {
+        if (bench::matchesFilter(options.suite, suite.name)) {
+            suite.run(options);
+        }
+    }
+    return 0;
+}
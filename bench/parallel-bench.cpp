@@ -0,0 +1,97 @@
+#include "benchmark.h"
+
+#include "splay-tree/parallel.h"
+#include "splay-tree/set.h"
+
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace bench {
+namespace {
+
+// Bulk operations over the whole set, serial and on all hardware threads,
+// reported per element.
+void runParallel(size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "parallel";
+    row.container = "splay_tree::set";
+    row.workload = "sorted";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    const splay_tree::ParallelOptions options;
+    const size_t operations = std::max<size_t>(size, 1);
+
+    auto measure = [&](const char* operation, const std::function<void()>& run) {
+        Timer timer;
+        run();
+        row.operation = operation;
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+    };
+
+    typedef splay_tree::set<uint64_t> Set;
+    Set set;
+    measure("build", [&]() {
+        set = Set(splay_tree::from_sorted, keys.begin(), keys.end());
+    });
+    set.clear();
+    measure("par-build", [&]() {
+        splay_tree::parallel_assign_sorted(set, keys.begin(), keys.end(), options);
+    });
+
+    measure("accumulate", [&]() {
+        doNotOptimize(std::accumulate(set.begin(), set.end(), uint64_t(0)));
+    });
+    measure("par-accum", [&]() {
+        doNotOptimize(splay_tree::parallel_accumulate(
+            set,
+            uint64_t(0),
+            std::plus<uint64_t>(),
+            std::plus<uint64_t>(),
+            options));
+    });
+
+    Set copy;
+    measure("copy", [&]() {
+        copy = set;
+    });
+    measure("clear", [&]() {
+        copy.clear();
+    });
+    measure("par-copy", [&]() {
+        copy = splay_tree::parallel_copy(set, options);
+    });
+    measure("par-clear", [&]() {
+        splay_tree::parallel_clear(copy, options);
+    });
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runParallelSuite(const Options& options) {
+    if (!matchesFilter(options.workload, "sorted") ||
+            !matchesFilter(options.container, "splay_tree::set")) {
+        return;
+    }
+    for (size_t size : options.sizes) {
+        runIsolated([&]() {
+            runParallel(size);
+        });
+    }
+}
+
+SuiteRegistrar parallelSuite("parallel", runParallelSuite);
+
+} // namespace
+} // namespace bench
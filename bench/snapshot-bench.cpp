@@ -0,0 +1,98 @@
+#include "benchmark.h"
+
+#include "splay-tree/mapped-set.h"
+#include "splay-tree/set.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+namespace {
+
+// Startup paths for a set of shuffled keys: rebuilding it by insertions or
+// from sorted keys, against writing a snapshot once and mapping it. Reported
+// per element; lookups are timed on the mapped snapshot.
+void runSnapshot(size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "snapshot";
+    row.container = "mapped_set";
+    row.workload = "uniform";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937_64 generator(size);
+    std::shuffle(keys.begin(), keys.end(), generator);
+    const size_t operations = std::max<size_t>(size, 1);
+
+    auto measure = [&](const char* operation, const std::function<void()>& run) {
+        Timer timer;
+        run();
+        row.operation = operation;
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / operations;
+        rows.push_back(row);
+    };
+
+    typedef splay_tree::set<uint64_t> Set;
+    typedef splay_tree::mapped_set<uint64_t> Snapshot;
+    Set set;
+    measure("insert", [&]() {
+        for (uint64_t key : keys) {
+            set.insert(key);
+        }
+    });
+
+    const std::string path = "/tmp/splay-tree-bench-" + std::to_string(size) + ".snapshot";
+    measure("write", [&]() {
+        Snapshot::write(set, path);
+    });
+
+    Snapshot snapshot = Snapshot::open(path);
+    measure("open", [&]() {
+        Snapshot reopened = Snapshot::open(path);
+        doNotOptimize(reopened.size());
+    });
+    measure("find", [&]() {
+        uint64_t found = 0;
+        for (uint64_t key : keys) {
+            found += snapshot.contains(key + (key & 2));
+        }
+        doNotOptimize(found);
+    });
+    measure("promote", [&]() {
+        Set promoted(splay_tree::from_sorted, snapshot.begin(), snapshot.end());
+        doNotOptimize(promoted.size());
+    });
+    std::remove(path.c_str());
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runSnapshotSuite(const Options& options) {
+    if (!matchesFilter(options.workload, "uniform") ||
+            !matchesFilter(options.container, "mapped_set")) {
+        return;
+    }
+    for (size_t size : options.sizes) {
+        runIsolated([&]() {
+            runSnapshot(size);
+        });
+    }
+}
+
+SuiteRegistrar snapshotSuite("snapshot", runSnapshotSuite);
+
+} // namespace
+} // namespace bench
@@ -0,0 +1,109 @@
+#include "benchmark.h"
+
+#include "splay-tree/node-update.h"
+#include "splay-tree/set.h"
+#include "splay-tree/splay-tree.h"
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+namespace {
+
+template<typename NodeUpdate>
+using Tree = splay_tree::SplayTree<
+    uint64_t,
+    uint64_t,
+    splay_tree::Identity,
+    std::less<uint64_t>,
+    std::allocator<uint64_t>,
+    NodeUpdate>;
+
+template<typename NodeUpdate>
+using Set = splay_tree::set<
+    uint64_t,
+    std::less<uint64_t>,
+    std::allocator<uint64_t>,
+    NodeUpdate>;
+
+// Few round trips: without subtree sizes every split counts the smaller of
+// its parts, which takes time linear in the size of the tree.
+const size_t OPERATIONS = 100;
+
+// Splits at uniformly random keys and merges the parts back; extracts ranges
+// of 64 keys and merges them back. Reported per round trip.
+template<typename NodeUpdate>
+void runSplit(const std::string& containerSuffix, size_t size) {
+    std::vector<Row> rows;
+    Row row;
+    row.suite = "split";
+    row.workload = "uniform";
+    row.size = size;
+    row.rotationsPerOperation = -1;
+
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937_64 generator(size);
+    std::uniform_int_distribution<size_t> position(0, size - 1);
+    std::vector<uint64_t> splitKeys(OPERATIONS);
+    for (auto& key : splitKeys) {
+        key = keys[position(generator)];
+    }
+
+    {
+        Tree<NodeUpdate> tree(splay_tree::from_sorted, keys.begin(), keys.end());
+        Timer timer;
+        for (uint64_t key : splitKeys) {
+            auto right = tree.split(key);
+            tree.mergeUnique(std::move(right));
+        }
+        row.container = "SplayTree" + containerSuffix;
+        row.operation = "split-merge";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / OPERATIONS;
+        rows.push_back(row);
+        doNotOptimize(tree.size());
+    }
+
+    {
+        Set<NodeUpdate> set(splay_tree::from_sorted, keys.begin(), keys.end());
+        Timer timer;
+        for (uint64_t key : splitKeys) {
+            auto range = set.extract_range(key, key + 2 * 64);
+            set.merge(range);
+        }
+        row.container = "splay_tree::set" + containerSuffix;
+        row.operation = "extract-merge";
+        row.nanosecondsPerOperation = timer.elapsedNanoseconds() / OPERATIONS;
+        rows.push_back(row);
+        doNotOptimize(set.size());
+    }
+
+    const double peakRss = peakRssMegabytes();
+    for (auto& result : rows) {
+        result.peakRssMegabytes = peakRss;
+        printRow(result);
+    }
+}
+
+void runSplitSuite(const Options& options) {
+    if (!matchesFilter(options.workload, "uniform")) {
+        return;
+    }
+    for (size_t size : options.sizes) {
+        runIsolated([&]() {
+            runSplit<splay_tree::NullNodeUpdate>("", size);
+        });
+        runIsolated([&]() {
+            runSplit<splay_tree::SubtreeSizeNodeUpdate>("<subtree-size>", size);
+        });
+    }
+}
+
+SuiteRegistrar splitSuite("split", runSplitSuite);
+
+} // namespace
+} // namespace bench
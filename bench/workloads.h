@@ -0,0 +1,161 @@
+#ifndef SPLAY_TREE_BENCH_WORKLOADS_H_
+#define SPLAY_TREE_BENCH_WORKLOADS_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace bench {
+
+// Zipf distribution over [1, n] sampled by rejection-inversion
+// (W. Hormann, G. Derflinger, "Rejection-inversion to generate variates from
+// monotone discrete distributions"). Uses O(1) memory, so it works for the
+// largest benchmark sizes where a precomputed CDF would not fit.
+class ZipfDistribution {
+public:
+    ZipfDistribution(uint64_t n, double exponent) :
+        n_(n),
+        exponent_(exponent),
+        hIntegralX1_(hIntegral(1.5) - 1.0),
+        hIntegralN_(hIntegral(n + 0.5)),
+        s_(2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0))) {
+    }
+
+    template<typename Generator>
+    uint64_t operator()(Generator& generator) {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        while (true) {
+            const double u =
+                hIntegralN_ + uniform(generator) * (hIntegralX1_ - hIntegralN_);
+            const double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1.0) {
+                k = 1.0;
+            } else if (k > n_) {
+                k = static_cast<double>(n_);
+            }
+            if (k - x <= s_ || u >= hIntegral(k + 0.5) - h(k)) {
+                return static_cast<uint64_t>(k);
+            }
+        }
+    }
+
+private:
+    double h(double x) const {
+        return std::exp(-exponent_ * std::log(x));
+    }
+
+    double hIntegral(double x) const {
+        const double logX = std::log(x);
+        return helper2((1.0 - exponent_) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - exponent_);
+        if (t < -1.0) {
+            t = -1.0;
+        }
+        return std::exp(helper1(t) * x);
+    }
+
+    // log1p(x) / x with the limit at zero.
+    static double helper1(double x) {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x / 2.0;
+    }
+
+    // expm1(x) / x with the limit at zero.
+    static double helper2(double x) {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x / 2.0;
+    }
+
+    uint64_t n_;
+    double exponent_;
+    double hIntegralX1_;
+    double hIntegralN_;
+    double s_;
+};
+
+enum class Workload {
+    UNIFORM,
+    ZIPFIAN,
+    SEQUENTIAL,
+    SLIDING_WINDOW
+};
+
+const Workload ALL_WORKLOADS[] = {
+    Workload::UNIFORM,
+    Workload::ZIPFIAN,
+    Workload::SEQUENTIAL,
+    Workload::SLIDING_WINDOW
+};
+
+inline std::string workloadName(Workload workload) {
+    switch (workload) {
+        case Workload::UNIFORM:
+            return "uniform";
+        case Workload::ZIPFIAN:
+            return "zipfian";
+        case Workload::SEQUENTIAL:
+            return "sequential";
+        case Workload::SLIDING_WINDOW:
+            return "sliding-window";
+    }
+    return "unknown";
+}
+
+// The population of a benchmark of size n is the set of even keys
+// {0, 2, ..., 2(n - 1)}; odd keys are guaranteed misses. A KeyStream yields
+// population keys in the order prescribed by the workload.
+class KeyStream {
+public:
+    KeyStream(Workload workload, uint64_t n, uint64_t numberOfKeys, uint32_t seed) :
+        workload_(workload),
+        n_(n),
+        numberOfKeys_(numberOfKeys),
+        window_(n / 100 > 16 ? n / 100 : 16),
+        generator_(seed),
+        zipf_(n, 0.99) {
+    }
+
+    uint64_t next() {
+        uint64_t index = 0;
+        switch (workload_) {
+            case Workload::UNIFORM:
+                index = std::uniform_int_distribution<uint64_t>(0, n_ - 1)(generator_);
+                break;
+            case Workload::ZIPFIAN:
+                // Scatter the hot ranks over the key space, otherwise the
+                // hottest keys would also be the smallest ones.
+                index = ((zipf_(generator_) - 1) * 2654435761ull) % n_;
+                break;
+            case Workload::SEQUENTIAL:
+                index = position_ % n_;
+                break;
+            case Workload::SLIDING_WINDOW:
+                {
+                    const uint64_t start = position_ * n_ / numberOfKeys_;
+                    index = (start +
+                        std::uniform_int_distribution<uint64_t>(0, window_ - 1)(
+                            generator_)) % n_;
+                }
+                break;
+        }
+        ++position_;
+        return 2 * index;
+    }
+
+private:
+    Workload workload_;
+    uint64_t n_;
+    uint64_t numberOfKeys_;
+    uint64_t window_;
+    uint64_t position_{0};
+    std::mt19937_64 generator_;
+    ZipfDistribution zipf_;
+};
+
+} // namespace bench
+
+#endif // SPLAY_TREE_BENCH_WORKLOADS_H_
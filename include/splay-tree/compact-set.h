@@ -0,0 +1,900 @@
+#ifndef SPLAY_TREE_COMPACT_SET_H_
+#define SPLAY_TREE_COMPACT_SET_H_
+
+#include "splay-tree.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace splay_tree {
+
+// A set for very large tables of small keys. Nodes live in one contiguous
+// pool and address their children through 32-bit indices, without a parent
+// link, so an element costs the key plus 8 bytes: 12 bytes for a uint32_t key
+// against 32 bytes and the allocator overhead in set. Every access splays
+// top-down, which needs no parent links.
+//
+// Keys must be trivially copyable, as the pool relocates them when it grows.
+// Up to 2^32 - 1 elements are supported.
+//
+// Iterators remember the index of their element and, to move, the path to it
+// from the root, so a full pass takes amortized constant time per step. The
+// first nodes of the path are kept in the iterator itself: copying one
+// allocates only when it points deeper into the tree. Splaying restructures
+// the tree, so an iterator rebuilds its path (in O(depth)) when it is moved
+// after the tree has changed. Iterators stay valid until their element is
+// erased or the sets are swapped.
+template<typename Key, typename Compare = std::less<Key>>
+class compact_set {
+    static_assert(
+        std::is_trivially_copyable<Key>::value,
+        "compact_set requires trivially copyable keys.");
+
+    typedef uint32_t NodeIndex;
+
+    enum : NodeIndex {
+        NO_NODE = ~NodeIndex(0)
+    };
+
+    struct Node {
+        Key value;
+        NodeIndex leftChild;
+        NodeIndex rightChild;
+    };
+
+    enum {
+        INLINE_PATH_NODES = 32
+    };
+
+    // The path of an iterator from the root to its node. The first
+    // INLINE_PATH_NODES nodes are stored inline, the rest in overflow_.
+    class NodePath {
+    public:
+        bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        NodeIndex back() const noexcept {
+            return size_ > INLINE_PATH_NODES ?
+                overflow_.back() :
+                inline_[size_ - 1];
+        }
+
+        void push_back(NodeIndex node) {
+            if (size_ < INLINE_PATH_NODES) {
+                inline_[size_] = node;
+            } else {
+                overflow_.push_back(node);
+            }
+            ++size_;
+        }
+
+        void pop_back() noexcept {
+            if (size_ > INLINE_PATH_NODES) {
+                overflow_.pop_back();
+            }
+            --size_;
+        }
+
+        void clear() noexcept {
+            overflow_.clear();
+            size_ = 0;
+        }
+
+    private:
+        NodeIndex inline_[INLINE_PATH_NODES] = {};
+        std::vector<NodeIndex> overflow_;
+        size_t size_{0};
+    };
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const Key* pointer;
+    typedef const Key* const_pointer;
+    typedef const Key& reference;
+    typedef const Key& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    class const_reverse_iterator;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Key value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Key* pointer;
+        typedef const Key& reference;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return set_->nodes_[node_].value;
+        }
+
+        pointer operator->() const {
+            return &set_->nodes_[node_].value;
+        }
+
+        const_iterator& operator++() {
+            updatePath();
+            NodeIndex node = path_.back();
+            if (set_->nodes_[node].rightChild != NO_NODE) {
+                node = set_->nodes_[node].rightChild;
+                path_.push_back(node);
+                descendLeft();
+            } else {
+                path_.pop_back();
+                while (!path_.empty() &&
+                        set_->nodes_[path_.back()].rightChild == node) {
+                    node = path_.back();
+                    path_.pop_back();
+                }
+            }
+            node_ = path_.empty() ? NodeIndex(NO_NODE) : path_.back();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        const_iterator& operator--() {
+            if (node_ == NO_NODE) {
+                path_.clear();
+                pathVersion_ = set_->version_;
+                if (set_->root_ != NO_NODE) {
+                    path_.push_back(set_->root_);
+                    descendRight();
+                    node_ = path_.back();
+                }
+                return *this;
+            }
+            updatePath();
+            NodeIndex node = path_.back();
+            if (set_->nodes_[node].leftChild != NO_NODE) {
+                node = set_->nodes_[node].leftChild;
+                path_.push_back(node);
+                descendRight();
+            } else {
+                path_.pop_back();
+                while (!path_.empty() &&
+                        set_->nodes_[path_.back()].leftChild == node) {
+                    node = path_.back();
+                    path_.pop_back();
+                }
+            }
+            node_ = path_.empty() ? NodeIndex(NO_NODE) : path_.back();
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator result = *this;
+            --*this;
+            return result;
+        }
+
+        friend bool operator==(
+                const const_iterator& lhs,
+                const const_iterator& rhs) noexcept {
+            return lhs.node_ == rhs.node_;
+        }
+
+        friend bool operator!=(
+                const const_iterator& lhs,
+                const const_iterator& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class compact_set;
+        friend class const_reverse_iterator;
+
+        const_iterator(const compact_set* set, NodeIndex node) noexcept :
+            set_(set),
+            node_(node) {
+        }
+
+        // Rebuilds the path from the root if the tree changed since it was
+        // recorded.
+        void updatePath() {
+            if (!path_.empty() && pathVersion_ == set_->version_) {
+                return;
+            }
+            path_.clear();
+            pathVersion_ = set_->version_;
+            const Key& key = set_->nodes_[node_].value;
+            NodeIndex node = set_->root_;
+            while (node != node_) {
+                path_.push_back(node);
+                node = set_->comparator_(key, set_->nodes_[node].value) ?
+                    set_->nodes_[node].leftChild :
+                    set_->nodes_[node].rightChild;
+            }
+            path_.push_back(node_);
+        }
+
+        void descendLeft() {
+            NodeIndex node = path_.back();
+            while (set_->nodes_[node].leftChild != NO_NODE) {
+                node = set_->nodes_[node].leftChild;
+                path_.push_back(node);
+            }
+        }
+
+        void descendRight() {
+            NodeIndex node = path_.back();
+            while (set_->nodes_[node].rightChild != NO_NODE) {
+                node = set_->nodes_[node].rightChild;
+                path_.push_back(node);
+            }
+        }
+
+        const compact_set* set_{nullptr};
+        NodeIndex node_{NO_NODE};
+        NodePath path_;
+        size_t pathVersion_{0};
+    };
+
+    // Unlike std::reverse_iterator, which copies its base iterator for every
+    // dereference, this keeps an iterator to its element, so a reverse pass
+    // is as cheap as a forward one.
+    class const_reverse_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Key value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Key* pointer;
+        typedef const Key& reference;
+
+        const_reverse_iterator() = default;
+
+        // Refers to the element before position, as std::reverse_iterator
+        // does.
+        explicit const_reverse_iterator(const_iterator position) :
+            position_(std::move(position)) {
+            --position_;
+        }
+
+        const_iterator base() const {
+            if (position_.node_ == NO_NODE) {
+                return position_.set_->begin();
+            }
+            const_iterator result = position_;
+            return ++result;
+        }
+
+        reference operator*() const {
+            return *position_;
+        }
+
+        pointer operator->() const {
+            return position_.operator->();
+        }
+
+        const_reverse_iterator& operator++() {
+            --position_;
+            return *this;
+        }
+
+        const_reverse_iterator operator++(int) {
+            const_reverse_iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        const_reverse_iterator& operator--() {
+            if (position_.node_ == NO_NODE) {
+                position_ = position_.set_->begin();
+            } else {
+                ++position_;
+            }
+            return *this;
+        }
+
+        const_reverse_iterator operator--(int) {
+            const_reverse_iterator result = *this;
+            --*this;
+            return result;
+        }
+
+        friend bool operator==(
+                const const_reverse_iterator& lhs,
+                const const_reverse_iterator& rhs) noexcept {
+            return lhs.position_ == rhs.position_;
+        }
+
+        friend bool operator!=(
+                const const_reverse_iterator& lhs,
+                const const_reverse_iterator& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class compact_set;
+
+        // Without a node past the first element.
+        const_iterator position_;
+    };
+
+    typedef const_iterator iterator;
+    typedef const_reverse_iterator reverse_iterator;
+
+    compact_set() {
+    }
+
+    explicit compact_set(const Compare& comparator) :
+        comparator_(comparator) {
+    }
+
+    template<typename InputIterator>
+    compact_set(
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare()) :
+            comparator_(comparator) {
+        insert(first, last);
+    }
+
+    // The range must be sorted without duplicates. Builds a balanced tree in
+    // linear time.
+    template<typename InputIterator>
+    compact_set(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare()) :
+            comparator_(comparator) {
+        for (; first != last; ++first) {
+            allocateNode(*first);
+        }
+        size_ = nodes_.size();
+        root_ = buildBalancedTree(0, static_cast<NodeIndex>(size_));
+    }
+
+    compact_set(
+        std::initializer_list<Key> initializerList,
+        const Compare& comparator = Compare()) :
+            comparator_(comparator) {
+        insert(initializerList.begin(), initializerList.end());
+    }
+
+    compact_set& operator=(std::initializer_list<Key> initializerList) {
+        clear();
+        insert(initializerList.begin(), initializerList.end());
+        return *this;
+    }
+
+    const_iterator begin() const {
+        if (root_ == NO_NODE) {
+            return end();
+        }
+        const_iterator result(this, root_);
+        result.pathVersion_ = version_;
+        result.path_.push_back(root_);
+        result.descendLeft();
+        result.node_ = result.path_.back();
+        return result;
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator(this, NO_NODE);
+    }
+
+    const_iterator cend() const noexcept {
+        return end();
+    }
+
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator crbegin() const {
+        return rbegin();
+    }
+
+    // Unlike const_reverse_iterator(begin()), takes constant time.
+    const_reverse_iterator rend() const noexcept {
+        const_reverse_iterator result;
+        result.position_ = end();
+        return result;
+    }
+
+    const_reverse_iterator crend() const {
+        return rend();
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    size_type size() const noexcept {
+        return size_;
+    }
+
+    size_type max_size() const noexcept {
+        return NO_NODE;
+    }
+
+    // Preallocates the pool for the given number of elements, which avoids
+    // the slack left by geometric growth.
+    void reserve(size_type count) {
+        nodes_.reserve(count);
+    }
+
+    size_type capacity() const noexcept {
+        return nodes_.capacity();
+    }
+
+    void clear() noexcept {
+        nodes_.clear();
+        root_ = NO_NODE;
+        freeList_ = NO_NODE;
+        size_ = 0;
+        ++version_;
+    }
+
+    void swap(compact_set& rhs) {
+        using std::swap;
+        swap(nodes_, rhs.nodes_);
+        swap(root_, rhs.root_);
+        swap(freeList_, rhs.freeList_);
+        swap(size_, rhs.size_);
+        swap(version_, rhs.version_);
+        swap(comparator_, rhs.comparator_);
+    }
+
+    std::pair<iterator, bool> insert(const Key& key);
+
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    void insert(std::initializer_list<Key> initializerList) {
+        insert(initializerList.begin(), initializerList.end());
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(Key(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const_iterator position) {
+        const Key key = *position;
+        ++position;
+        erase(key);
+        return position;
+    }
+
+    size_type erase(const Key& key);
+
+    // The non-const lookups splay, the const ones leave the tree unchanged.
+    iterator find(const Key& key) {
+        if (root_ == NO_NODE) {
+            return end();
+        }
+        splay(FindDirection{comparator_, key});
+        return keysAreEqual(nodes_[root_].value, key) ? iterator(this, root_) : end();
+    }
+
+    const_iterator find(const Key& key) const {
+        NodeIndex node = root_;
+        while (node != NO_NODE) {
+            if (comparator_(key, nodes_[node].value)) {
+                node = nodes_[node].leftChild;
+            } else if (comparator_(nodes_[node].value, key)) {
+                node = nodes_[node].rightChild;
+            } else {
+                break;
+            }
+        }
+        return const_iterator(this, node);
+    }
+
+    size_type count(const Key& key) {
+        return find(key) != end();
+    }
+
+    size_type count(const Key& key) const {
+        return find(key) != end();
+    }
+
+    iterator lower_bound(const Key& key) {
+        if (root_ == NO_NODE) {
+            return end();
+        }
+        const NodeIndex greaterNode = splay(LowerBoundDirection{comparator_, key});
+        return iterator(
+            this,
+            comparator_(nodes_[root_].value, key) ? greaterNode : root_);
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return const_iterator(this, lowerBoundNode(key));
+    }
+
+    iterator upper_bound(const Key& key) {
+        if (root_ == NO_NODE) {
+            return end();
+        }
+        const NodeIndex greaterNode = splay(UpperBoundDirection{comparator_, key});
+        return iterator(
+            this,
+            comparator_(key, nodes_[root_].value) ? root_ : greaterNode);
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        return const_iterator(this, upperBoundNode(key));
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        auto first = lower_bound(key);
+        auto last = first;
+        if (last != end() && !comparator_(key, *last)) {
+            ++last;
+        }
+        return {first, last};
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        auto first = lower_bound(key);
+        auto last = first;
+        if (last != end() && !comparator_(key, *last)) {
+            ++last;
+        }
+        return {first, last};
+    }
+
+    key_compare key_comp() const {
+        return comparator_;
+    }
+
+    value_compare value_comp() const {
+        return comparator_;
+    }
+
+private:
+    enum class Direction {
+        LEFT,
+        RIGHT,
+        STOP
+    };
+
+    struct FindDirection {
+        const Compare& comparator;
+        const Key& key;
+
+        Direction operator()(const Key& nodeKey) const {
+            if (comparator(key, nodeKey)) {
+                return Direction::LEFT;
+            } else if (comparator(nodeKey, key)) {
+                return Direction::RIGHT;
+            } else {
+                return Direction::STOP;
+            }
+        }
+    };
+
+    struct LowerBoundDirection {
+        const Compare& comparator;
+        const Key& key;
+
+        Direction operator()(const Key& nodeKey) const {
+            return comparator(nodeKey, key) ? Direction::RIGHT : Direction::LEFT;
+        }
+    };
+
+    struct UpperBoundDirection {
+        const Compare& comparator;
+        const Key& key;
+
+        Direction operator()(const Key& nodeKey) const {
+            return comparator(key, nodeKey) ? Direction::LEFT : Direction::RIGHT;
+        }
+    };
+
+    struct MaximumDirection {
+        Direction operator()(const Key&) const {
+            return Direction::RIGHT;
+        }
+    };
+
+    // Top-down splay, see SplayTree::topDownSplay(). Returns the last node
+    // other than the new root at which the search went left.
+    template<typename DirectionOf>
+    NodeIndex splay(DirectionOf directionOf);
+
+    // Searches without splaying, NO_NODE if there is no such node.
+    NodeIndex lowerBoundNode(const Key& key) const;
+
+    NodeIndex upperBoundNode(const Key& key) const;
+
+    NodeIndex allocateNode(const Key& key);
+
+    NodeIndex buildBalancedTree(NodeIndex first, NodeIndex last) noexcept;
+
+    bool keysAreEqual(const Key& lhs, const Key& rhs) const {
+        return !comparator_(lhs, rhs) && !comparator_(rhs, lhs);
+    }
+
+    std::vector<Node> nodes_;
+    NodeIndex root_{NO_NODE};
+    // Erased nodes, chained through leftChild.
+    NodeIndex freeList_{NO_NODE};
+    size_type size_{0};
+    // Changes whenever the shape of the tree does, see const_iterator.
+    size_t version_{0};
+    Compare comparator_;
+};
+
+template<typename Key, typename Compare>
+template<typename DirectionOf>
+typename compact_set<Key, Compare>::NodeIndex
+compact_set<Key, Compare>::splay(DirectionOf directionOf) {
+    ++version_;
+    NodeIndex leftTreeRoot = NO_NODE;
+    NodeIndex leftTreeMax = NO_NODE;
+    NodeIndex rightTreeRoot = NO_NODE;
+    NodeIndex rightTreeMin = NO_NODE;
+
+    NodeIndex node = root_;
+    Direction direction = directionOf(nodes_[node].value);
+    while (direction != Direction::STOP) {
+        if (direction == Direction::LEFT) {
+            NodeIndex child = nodes_[node].leftChild;
+            if (child == NO_NODE) {
+                break;
+            }
+            direction = directionOf(nodes_[child].value);
+            if (direction == Direction::LEFT) {
+                nodes_[node].leftChild = nodes_[child].rightChild;
+                nodes_[child].rightChild = node;
+                node = child;
+                child = nodes_[node].leftChild;
+                if (child == NO_NODE) {
+                    break;
+                }
+                direction = directionOf(nodes_[child].value);
+            }
+            if (rightTreeMin != NO_NODE) {
+                nodes_[rightTreeMin].leftChild = node;
+            } else {
+                rightTreeRoot = node;
+            }
+            rightTreeMin = node;
+            node = child;
+        } else {
+            NodeIndex child = nodes_[node].rightChild;
+            if (child == NO_NODE) {
+                break;
+            }
+            direction = directionOf(nodes_[child].value);
+            if (direction == Direction::RIGHT) {
+                nodes_[node].rightChild = nodes_[child].leftChild;
+                nodes_[child].leftChild = node;
+                node = child;
+                child = nodes_[node].rightChild;
+                if (child == NO_NODE) {
+                    break;
+                }
+                direction = directionOf(nodes_[child].value);
+            }
+            if (leftTreeMax != NO_NODE) {
+                nodes_[leftTreeMax].rightChild = node;
+            } else {
+                leftTreeRoot = node;
+            }
+            leftTreeMax = node;
+            node = child;
+        }
+    }
+
+    if (leftTreeRoot != NO_NODE) {
+        nodes_[leftTreeMax].rightChild = nodes_[node].leftChild;
+        nodes_[node].leftChild = leftTreeRoot;
+    }
+    if (rightTreeRoot != NO_NODE) {
+        nodes_[rightTreeMin].leftChild = nodes_[node].rightChild;
+        nodes_[node].rightChild = rightTreeRoot;
+    }
+    root_ = node;
+    return rightTreeMin;
+}
+
+template<typename Key, typename Compare>
+typename compact_set<Key, Compare>::NodeIndex
+compact_set<Key, Compare>::lowerBoundNode(const Key& key) const {
+    NodeIndex lowerBound = NO_NODE;
+    for (NodeIndex node = root_; node != NO_NODE;) {
+        if (comparator_(nodes_[node].value, key)) {
+            node = nodes_[node].rightChild;
+        } else {
+            lowerBound = node;
+            node = nodes_[node].leftChild;
+        }
+    }
+    return lowerBound;
+}
+
+template<typename Key, typename Compare>
+typename compact_set<Key, Compare>::NodeIndex
+compact_set<Key, Compare>::upperBoundNode(const Key& key) const {
+    NodeIndex upperBound = NO_NODE;
+    for (NodeIndex node = root_; node != NO_NODE;) {
+        if (comparator_(key, nodes_[node].value)) {
+            upperBound = node;
+            node = nodes_[node].leftChild;
+        } else {
+            node = nodes_[node].rightChild;
+        }
+    }
+    return upperBound;
+}
+
+template<typename Key, typename Compare>
+typename compact_set<Key, Compare>::NodeIndex
+compact_set<Key, Compare>::allocateNode(const Key& key) {
+    NodeIndex node = freeList_;
+    if (node != NO_NODE) {
+        freeList_ = nodes_[node].leftChild;
+        nodes_[node] = Node{key, NO_NODE, NO_NODE};
+        return node;
+    }
+    if (nodes_.size() >= max_size()) {
+        throw std::length_error("compact_set holds at most 2^32 - 1 elements.");
+    }
+    nodes_.push_back(Node{key, NO_NODE, NO_NODE});
+    return static_cast<NodeIndex>(nodes_.size() - 1);
+}
+
+template<typename Key, typename Compare>
+typename compact_set<Key, Compare>::NodeIndex
+compact_set<Key, Compare>::buildBalancedTree(
+        NodeIndex first,
+        NodeIndex last) noexcept {
+    if (first == last) {
+        return NO_NODE;
+    }
+    const NodeIndex middle = first + (last - first) / 2;
+    nodes_[middle].leftChild = buildBalancedTree(first, middle);
+    nodes_[middle].rightChild = buildBalancedTree(middle + 1, last);
+    return middle;
+}
+
+template<typename Key, typename Compare>
+std::pair<typename compact_set<Key, Compare>::iterator, bool>
+compact_set<Key, Compare>::insert(const Key& key) {
+    if (root_ == NO_NODE) {
+        root_ = allocateNode(key);
+        size_ = 1;
+        return {iterator(this, root_), true};
+    }
+    splay(FindDirection{comparator_, key});
+    if (keysAreEqual(nodes_[root_].value, key)) {
+        return {iterator(this, root_), false};
+    }
+
+    // The root is a neighbour of the key, the new node replaces it as the
+    // root. allocateNode() may move the pool, so no references are kept.
+    const NodeIndex newNode = allocateNode(key);
+    const NodeIndex oldRoot = root_;
+    if (comparator_(key, nodes_[oldRoot].value)) {
+        nodes_[newNode].leftChild = nodes_[oldRoot].leftChild;
+        nodes_[newNode].rightChild = oldRoot;
+        nodes_[oldRoot].leftChild = NO_NODE;
+    } else {
+        nodes_[newNode].rightChild = nodes_[oldRoot].rightChild;
+        nodes_[newNode].leftChild = oldRoot;
+        nodes_[oldRoot].rightChild = NO_NODE;
+    }
+    root_ = newNode;
+    ++size_;
+    return {iterator(this, newNode), true};
+}
+
+template<typename Key, typename Compare>
+typename compact_set<Key, Compare>::size_type
+compact_set<Key, Compare>::erase(const Key& key) {
+    if (root_ == NO_NODE) {
+        return 0;
+    }
+    splay(FindDirection{comparator_, key});
+    if (!keysAreEqual(nodes_[root_].value, key)) {
+        return 0;
+    }
+
+    const NodeIndex erased = root_;
+    const NodeIndex rightSubtree = nodes_[erased].rightChild;
+    if (nodes_[erased].leftChild == NO_NODE) {
+        root_ = rightSubtree;
+    } else {
+        // The maximum of the left subtree has no right child after the
+        // splay, so the right subtree is attached there.
+        root_ = nodes_[erased].leftChild;
+        splay(MaximumDirection());
+        nodes_[root_].rightChild = rightSubtree;
+    }
+
+    if (--size_ == 0) {
+        clear();
+    } else {
+        nodes_[erased].leftChild = freeList_;
+        freeList_ = erased;
+    }
+    return 1;
+}
+
+template<typename Key, typename Compare>
+inline bool operator==(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<typename Key, typename Compare>
+inline bool operator!=(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename Key, typename Compare>
+inline bool operator<(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return std::lexicographical_compare(
+        lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template<typename Key, typename Compare>
+inline bool operator<=(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return !(rhs < lhs);
+}
+
+template<typename Key, typename Compare>
+inline bool operator>(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return rhs < lhs;
+}
+
+template<typename Key, typename Compare>
+inline bool operator>=(
+        const compact_set<Key, Compare>& lhs,
+        const compact_set<Key, Compare>& rhs) {
+    return !(lhs < rhs);
+}
+
+template<typename Key, typename Compare>
+inline void swap(
+        compact_set<Key, Compare>& lhs,
+        compact_set<Key, Compare>& rhs) {
+    lhs.swap(rhs);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_COMPACT_SET_H_
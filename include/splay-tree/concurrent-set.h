@@ -0,0 +1,192 @@
+#ifndef SPLAY_TREE_CONCURRENT_SET_H_
+#define SPLAY_TREE_CONCURRENT_SET_H_
+
+#include "set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace splay_tree {
+
+struct range_partitioned_t {
+    explicit range_partitioned_t() = default;
+};
+
+constexpr range_partitioned_t range_partitioned{};
+
+// A set shared between threads. The keys are partitioned across shards, each
+// an independent splay tree guarded by its own mutex, so threads contend only
+// when they access the same shard. Lookups splay, so they lock their shard
+// exclusively just like insertions.
+//
+// Keys are partitioned either by hash, which spreads any key distribution
+// evenly, or by range, between boundaries given at construction, which keeps
+// the shards ordered: for_each() then visits the keys in ascending order.
+//
+// Operations on a single key are atomic. size() and for_each() lock one shard
+// at a time, so under concurrent modification they do not see a snapshot.
+template <
+    typename Key,
+    typename Compare = std::less<Key>,
+    typename Hash = std::hash<Key>,
+    typename Allocator = std::allocator<Key>,
+    typename SplayPolicy = AlwaysSplay
+>
+class concurrent_set {
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef Hash hasher;
+    typedef Allocator allocator_type;
+    typedef size_t size_type;
+
+    // Partitions the keys by hash into the given number of shards.
+    explicit concurrent_set(
+        size_type shardCount,
+        const Compare& comparator = Compare(),
+        const Hash& hash = Hash(),
+        const Allocator& allocator = Allocator()) :
+            comparator_(comparator),
+            hash_(hash),
+            shardCount_(shardCount) {
+        if (shardCount == 0) {
+            throw std::invalid_argument("A concurrent_set needs at least one shard.");
+        }
+        createShards(allocator);
+    }
+
+    // Partitions the keys by range. The boundaries must be sorted and
+    // distinct; shard i holds the keys from boundary i - 1 up to, but
+    // excluding, boundary i, so there is one shard more than boundaries.
+    template<typename InputIterator>
+    concurrent_set(
+        range_partitioned_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            comparator_(comparator),
+            boundaries_(first, last),
+            shardCount_(boundaries_.size() + 1) {
+        createShards(allocator);
+    }
+
+    concurrent_set(const concurrent_set&) = delete;
+    concurrent_set& operator=(const concurrent_set&) = delete;
+
+    size_type shard_count() const noexcept {
+        return shardCount_;
+    }
+
+    // Not a snapshot under concurrent modification.
+    size_type size() const {
+        size_type size = 0;
+        for (size_type i = 0; i < shardCount_; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            size += shards_[i].keys.size();
+        }
+        return size;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    void clear() {
+        for (size_type i = 0; i < shardCount_; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            shards_[i].keys.clear();
+        }
+    }
+
+    bool insert(const Key& key) {
+        Shard& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.insert(key).second;
+    }
+
+    bool insert(Key&& key) {
+        Shard& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.insert(std::move(key)).second;
+    }
+
+    size_type erase(const Key& key) {
+        Shard& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.erase(key);
+    }
+
+    bool contains(const Key& key) const {
+        Shard& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.find(key) != shard.keys.end();
+    }
+
+    size_type count(const Key& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    // Calls function with every key, shard by shard while holding the lock of
+    // the shard, so function must not access this set. The keys come in
+    // ascending order when the set is range-partitioned.
+    template<typename Function>
+    void for_each(Function function) const {
+        for (size_type i = 0; i < shardCount_; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            for (const Key& key : shards_[i].keys) {
+                function(key);
+            }
+        }
+    }
+
+private:
+    typedef set<Key, Compare, Allocator, NullNodeUpdate, SplayPolicy> ShardSet;
+
+    struct Shard {
+        std::mutex mutex;
+        ShardSet keys;
+        // Keeps the locks of neighbouring shards off each other's cache line.
+        char padding[64];
+    };
+
+    void createShards(const Allocator& allocator) {
+        shards_.reset(new Shard[shardCount_]);
+        for (size_type i = 0; i < shardCount_; ++i) {
+            shards_[i].keys = ShardSet(comparator_, allocator);
+        }
+    }
+
+    // The shards are mutable: lookups splay, but are logically const and
+    // synchronized by the shard locks.
+    Shard& shardOf(const Key& key) const {
+        if (boundaries_.empty()) {
+            // std::hash is the identity for integers, so the hash is mixed
+            // first: keys with common low bits would share a few shards.
+            const uint64_t mixedHash =
+                static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+            return shards_[(mixedHash >> 32) % shardCount_];
+        }
+        return shards_[std::upper_bound(
+            boundaries_.begin(),
+            boundaries_.end(),
+            key,
+            comparator_) - boundaries_.begin()];
+    }
+
+    Compare comparator_;
+    Hash hash_;
+    std::vector<Key> boundaries_;
+    size_type shardCount_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_CONCURRENT_SET_H_
@@ -13,6 +13,15 @@ struct Identity {
     }
 };
 
+// Extracts the key of a map element, i.e. the first member of a pair.
+struct Select1st {
+    template<typename Pair>
+    constexpr const typename Pair::first_type& operator()(
+            const Pair& pair) const noexcept {
+        return pair.first;
+    }
+};
+
 } // namespace splay_tree
 
 #endif // SPLAY_TREE_KEY_OF_VALUE_H_
@@ -0,0 +1,84 @@
+#ifndef SPLAY_TREE_KEY_TRAITS_H_
+#define SPLAY_TREE_KEY_TRAITS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+namespace splay_tree {
+
+// Key traits let a tree store a fixed-width prefix of every key in its node,
+// so that searches compare prefixes and read the keys themselves only when
+// the prefixes are equal. A comparator opts in by naming them:
+//
+//   struct Less : std::less<Key> {
+//       typedef Traits key_traits;
+//   };
+//
+// The traits provide a prefix_type ordered by operator<() and
+//
+//   static prefix_type prefix(const Key& key);
+//
+// which must not throw and must agree with the comparator: a key with a
+// smaller prefix has to precede every key with a greater one.
+template<typename Compare, typename = void>
+struct KeyTraitsOf {
+    typedef void type;
+};
+
+template<typename Compare>
+struct KeyTraitsOf<
+    Compare,
+    typename std::conditional<
+        true, void, typename Compare::key_traits>::type> {
+    typedef typename Compare::key_traits type;
+};
+
+// The prefix stored in a node. Without key traits there is none.
+template<typename KeyTraits>
+struct KeyPrefix {
+    template<typename K>
+    void storePrefix(const K& key) noexcept {
+        keyPrefix = KeyTraits::prefix(key);
+    }
+
+    typename KeyTraits::prefix_type keyPrefix;
+};
+
+template<>
+struct KeyPrefix<void> {
+    template<typename K>
+    void storePrefix(const K&) noexcept {
+    }
+};
+
+// The first eight bytes of a string as a big-endian number, padded with
+// zero bytes, which orders strings as std::less<std::string> does.
+struct StringKeyTraits {
+    typedef uint64_t prefix_type;
+
+    static prefix_type prefix(const std::string& key) noexcept {
+        unsigned char bytes[sizeof(prefix_type)] = {};
+        std::memcpy(bytes, key.data(), std::min(key.size(), sizeof(bytes)));
+        prefix_type prefix = 0;
+        for (unsigned char byte : bytes) {
+            prefix = prefix << 8 | byte;
+        }
+        return prefix;
+    }
+};
+
+// std::less with key traits, e.g. set<std::string, StringPrefixLess>.
+template<typename Key, typename KeyTraits>
+struct PrefixLess : std::less<Key> {
+    typedef KeyTraits key_traits;
+};
+
+typedef PrefixLess<std::string, StringKeyTraits> StringPrefixLess;
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_KEY_TRAITS_H_
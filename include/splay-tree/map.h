@@ -0,0 +1,589 @@
+#ifndef SPLAY_TREE_MAP_H_
+#define SPLAY_TREE_MAP_H_
+
+#include "splay-tree.h"
+#include "key-of-value.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace splay_tree {
+
+// SplayPolicy (see splay-policy.h) selects how lookups and insertions splay.
+// NodeUpdate = SubtreeSizeNodeUpdate enables the order statistics nth() and
+// rank().
+template <
+    typename Key,
+    typename T,
+    typename Compare = std::less<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, T>>,
+    typename NodeUpdate = NullNodeUpdate,
+    typename SplayPolicy = AlwaysSplay
+>
+class map {
+private:
+    template<typename K>
+    using EnableIfTransparent =
+        typename std::enable_if<IsTransparent<Compare, K>::value>::type;
+
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key, T> value_type;
+    typedef Compare key_compare;
+    typedef Allocator allocator_type;
+
+    class value_compare {
+    public:
+        bool operator()(const value_type& lhs, const value_type& rhs) const {
+            return comparator_(lhs.first, rhs.first);
+        }
+
+    protected:
+        friend class map;
+
+        explicit value_compare(const Compare& comparator) :
+            comparator_(comparator) {
+        }
+
+        Compare comparator_;
+    };
+
+private:
+    typedef typename Allocator::template rebind<value_type>::other ValueAllocator;
+
+    typedef SplayTree<
+        Key, value_type, Select1st, Compare, ValueAllocator, NodeUpdate, SplayPolicy>
+        MapImpl;
+
+public:
+    typedef typename MapImpl::pointer pointer;
+    typedef typename MapImpl::const_pointer const_pointer;
+    typedef typename MapImpl::reference reference;
+    typedef typename MapImpl::const_reference const_reference;
+    typedef typename MapImpl::size_type size_type;
+    typedef typename MapImpl::difference_type difference_type;
+
+    typedef typename MapImpl::iterator iterator;
+    typedef typename MapImpl::const_iterator const_iterator;
+    typedef typename MapImpl::reverse_iterator reverse_iterator;
+    typedef typename MapImpl::const_reverse_iterator const_reverse_iterator;
+
+    map() :
+        mapImpl_() {
+    }
+
+    explicit map(const Compare& comparator, const Allocator& allocator = Allocator()) :
+        mapImpl_(comparator, ValueAllocator(allocator)) {
+    }
+
+    template<typename InputIterator>
+    map(InputIterator first, InputIterator last) :
+            mapImpl_() {
+        mapImpl_.insertUnique(first, last);
+    }
+
+    template<typename InputIterator>
+    map(
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator,
+        const Allocator& allocator = Allocator()) :
+            mapImpl_(comparator, ValueAllocator(allocator)) {
+        mapImpl_.insertUnique(first, last);
+    }
+
+    // The range must be sorted by key without duplicate keys. Builds the map
+    // in linear time.
+    template<typename InputIterator>
+    map(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            mapImpl_(
+                from_sorted,
+                first,
+                last,
+                comparator,
+                ValueAllocator(allocator)) {
+    }
+
+    map(
+        std::initializer_list<value_type> initializerList,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            mapImpl_(comparator, ValueAllocator(allocator)) {
+        mapImpl_.insertUnique(initializerList.begin(), initializerList.end());
+    }
+
+    map(const map& rhs) = default;
+
+    map(map&& rhs) = default;
+
+    map& operator=(const map& rhs) = default;
+
+    map& operator=(map&& rhs) = default;
+
+    map& operator=(std::initializer_list<value_type> initializerList) {
+        clear();
+        insert(initializerList.begin(), initializerList.end());
+        return *this;
+    }
+
+    iterator begin() noexcept {
+        return mapImpl_.begin();
+    }
+
+    const_iterator begin() const noexcept {
+        return mapImpl_.begin();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return mapImpl_.cbegin();
+    }
+
+    iterator end() noexcept {
+        return mapImpl_.end();
+    }
+
+    const_iterator end() const noexcept {
+        return mapImpl_.end();
+    }
+
+    const_iterator cend() const noexcept {
+        return mapImpl_.cend();
+    }
+
+    reverse_iterator rbegin() noexcept {
+        return mapImpl_.rbegin();
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return mapImpl_.rbegin();
+    }
+
+    const_reverse_iterator crbegin() const noexcept {
+        return mapImpl_.crbegin();
+    }
+
+    reverse_iterator rend() noexcept {
+        return mapImpl_.rend();
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return mapImpl_.rend();
+    }
+
+    const_reverse_iterator crend() const noexcept {
+        return mapImpl_.crend();
+    }
+
+    bool empty() const noexcept {
+        return mapImpl_.empty();
+    }
+
+    size_type size() const noexcept {
+        return mapImpl_.size();
+    }
+
+    size_type max_size() const noexcept {
+        return mapImpl_.max_size();
+    }
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+    const SplayTreeStats& stats() const noexcept {
+        return mapImpl_.stats();
+    }
+
+    void reset_stats() noexcept {
+        mapImpl_.resetStats();
+    }
+#endif
+
+    void swap(map& rhs) noexcept(
+            IsNothrowSwappable<Compare>::value &&
+            IsNothrowSwappable<SplayPolicy>::value) {
+        mapImpl_.swap(rhs.mapImpl_);
+    }
+
+    void clear() noexcept {
+        mapImpl_.clear();
+    }
+
+    // Element access. The value is constructed only if the key is absent.
+    T& operator[](const Key& key) {
+        return try_emplace(key).first->second;
+    }
+
+    T& operator[](Key&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    T& at(const Key& key) {
+        auto position = find(key);
+        if (position == end()) {
+            throw std::out_of_range("splay_tree::map::at");
+        }
+        return position->second;
+    }
+
+    const T& at(const Key& key) const {
+        auto position = find(key);
+        if (position == end()) {
+            throw std::out_of_range("splay_tree::map::at");
+        }
+        return position->second;
+    }
+
+    // Insert/erase operations.
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return mapImpl_.insertUnique(value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return mapImpl_.insertUnique(std::move(value));
+    }
+
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        mapImpl_.insertUnique(first, last);
+    }
+
+    void insert(std::initializer_list<value_type> initializerList) {
+        insert(initializerList.begin(), initializerList.end());
+    }
+
+    // Always constructs the element, and destroys it again if the key is
+    // present. try_emplace() avoids that.
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return mapImpl_.emplaceUnique(std::forward<Args>(args)...);
+    }
+
+    // A value belonging directly before hint is linked there without a
+    // descent from the root, otherwise the hint is ignored.
+    iterator insert(const_iterator hint, const value_type& value) {
+        return mapImpl_.insertUniqueWithHint(hint, value);
+    }
+
+    iterator insert(const_iterator hint, value_type&& value) {
+        return mapImpl_.insertUniqueWithHint(hint, std::move(value));
+    }
+
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        return mapImpl_.emplaceUniqueWithHint(hint, std::forward<Args>(args)...);
+    }
+
+    // Constructs the mapped value from args only if the key is absent, the
+    // arguments are left untouched otherwise.
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        return mapImpl_.tryEmplaceUnique(
+            key,
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+        // The key is only moved from once the search is over.
+        return mapImpl_.tryEmplaceUnique(
+            key,
+            std::piecewise_construct,
+            std::forward_as_tuple(std::move(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& object) {
+        auto result = try_emplace(key, std::forward<M>(object));
+        if (!result.second) {
+            result.first->second = std::forward<M>(object);
+        }
+        return result;
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& object) {
+        auto result = try_emplace(std::move(key), std::forward<M>(object));
+        if (!result.second) {
+            result.first->second = std::forward<M>(object);
+        }
+        return result;
+    }
+
+    iterator erase(const_iterator position) {
+        return mapImpl_.erase(position);
+    }
+
+    iterator erase(iterator position) {
+        return mapImpl_.erase(position);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        return mapImpl_.erase(first, last);
+    }
+
+    // Moves the elements with keys in [lowerKey, upperKey) to the returned
+    // map, in amortized logarithmic time with SubtreeSizeNodeUpdate.
+    // Otherwise the smaller of the range and the rest is counted, which adds
+    // time linear in its size, see SplayTree::split().
+    map extract_range(const Key& lowerKey, const Key& upperKey) {
+        return map(mapImpl_.extractRange(lowerKey, upperKey));
+    }
+
+    size_type erase(const Key& key) {
+        return mapImpl_.erase(key);
+    }
+
+    template<
+        typename K,
+        typename = EnableIfTransparent<K>,
+        typename = typename std::enable_if<
+            !std::is_convertible<K, const_iterator>::value>::type
+    >
+    size_type erase(const K& key) {
+        return mapImpl_.erase(key);
+    }
+
+    // Find operations.
+    // The non-const lookups splay as the splay policy requests. With a
+    // transparent comparator they also take any type comparable with the keys.
+    iterator find(const Key& key) {
+        return mapImpl_.find(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator find(const K& key) {
+        return mapImpl_.find(key);
+    }
+
+    const_iterator find(const Key& key) const {
+        return mapImpl_.find(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator find(const K& key) const {
+        return mapImpl_.find(key);
+    }
+
+    size_type count(const Key& key) {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    size_type count(const Key& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    iterator lower_bound(const Key& key) {
+        return mapImpl_.lower_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator lower_bound(const K& key) {
+        return mapImpl_.lower_bound(key);
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return mapImpl_.lower_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator lower_bound(const K& key) const {
+        return mapImpl_.lower_bound(key);
+    }
+
+    iterator upper_bound(const Key& key) {
+        return mapImpl_.upper_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) {
+        return mapImpl_.upper_bound(key);
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        return mapImpl_.upper_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator upper_bound(const K& key) const {
+        return mapImpl_.upper_bound(key);
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        return mapImpl_.equal_range(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return mapImpl_.equal_range(key);
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        return mapImpl_.equal_range(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return mapImpl_.equal_range(key);
+    }
+
+    // Order statistics, see SplayTree::nth() and SplayTree::rank().
+    iterator nth(size_type index) {
+        return mapImpl_.nth(index);
+    }
+
+    const_iterator nth(size_type index) const {
+        return mapImpl_.nth(index);
+    }
+
+    size_type rank(const Key& key) {
+        return mapImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) {
+        return mapImpl_.rank(key);
+    }
+
+    size_type rank(const Key& key) const {
+        return mapImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) const {
+        return mapImpl_.rank(key);
+    }
+
+private:
+    explicit map(MapImpl&& impl) :
+        mapImpl_(std::move(impl)) {
+    }
+
+    MapImpl mapImpl_;
+};
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator==(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator!=(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs == rhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator<(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return std::lexicographical_compare(
+        lhs.begin(),
+        lhs.end(),
+        rhs.begin(),
+        rhs.end());
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator>=(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs < rhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator>(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return rhs < lhs;
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator<=(
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(rhs < lhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline void swap(
+        map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        map<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_MAP_H_
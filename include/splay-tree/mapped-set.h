@@ -0,0 +1,440 @@
+#ifndef SPLAY_TREE_MAPPED_SET_H_
+#define SPLAY_TREE_MAPPED_SET_H_
+
+#include "splay-tree.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace splay_tree {
+
+// A read-only set over a persistent snapshot, used in place: opening maps the
+// file and touches nothing else, so loading takes constant time and the pages
+// are read in on demand.
+//
+// A snapshot is a header followed by a flat array of nodes, each a key and
+// the indices of its children, written by an in-order walk of any sorted
+// container (set, multiset or a SplayTree) with write(). The children form a
+// balanced tree, so lookups descend in O(log(n)) without restructuring
+// anything, and iteration is a sequential scan of the array. Since the nodes
+// address each other by index, the array is valid at any address.
+//
+// The snapshot is promoted to a mutable set in linear time, without
+// comparisons, by building one from the sorted range:
+// set<Key>(from_sorted, snapshot.begin(), snapshot.end()).
+//
+// Keys must be trivially copyable and hold no pointers. The format is that of
+// the machine writing it, so snapshots are not portable across endianness or
+// ABIs. Up to 2^32 - 1 elements are supported.
+template<typename Key, typename Compare = std::less<Key>>
+class mapped_set {
+    static_assert(
+        std::is_trivially_copyable<Key>::value,
+        "mapped_set requires trivially copyable keys.");
+
+    typedef uint32_t NodeIndex;
+
+    enum : NodeIndex {
+        NO_NODE = ~NodeIndex(0)
+    };
+
+    struct Node {
+        Key value;
+        NodeIndex leftChild;
+        NodeIndex rightChild;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t nodeSize;
+        uint64_t size;
+        NodeIndex root;
+        uint32_t keySize;
+    };
+
+    enum : uint32_t {
+        VERSION = 1
+    };
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const Key* pointer;
+    typedef const Key* const_pointer;
+    typedef const Key& reference;
+    typedef const Key& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Key value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Key* pointer;
+        typedef const Key& reference;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return node_->value;
+        }
+
+        pointer operator->() const {
+            return &node_->value;
+        }
+
+        const_iterator& operator++() {
+            ++node_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++node_;
+            return result;
+        }
+
+        const_iterator& operator--() {
+            --node_;
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator result = *this;
+            --node_;
+            return result;
+        }
+
+        friend bool operator==(
+                const const_iterator& lhs,
+                const const_iterator& rhs) noexcept {
+            return lhs.node_ == rhs.node_;
+        }
+
+        friend bool operator!=(
+                const const_iterator& lhs,
+                const const_iterator& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class mapped_set;
+
+        explicit const_iterator(const Node* node) noexcept :
+            node_(node) {
+        }
+
+        // The nodes are stored in order, so iterating is stepping through
+        // the array.
+        const Node* node_{nullptr};
+    };
+
+    typedef const_iterator iterator;
+    typedef std::reverse_iterator<const_iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    // Writes the elements of a sorted container as a snapshot file.
+    template<typename Container>
+    static void write(const Container& container, const std::string& path);
+
+    // Maps a snapshot file. Throws std::runtime_error when the file cannot be
+    // mapped or is not a snapshot of this key type.
+    static mapped_set open(const std::string& path, const Compare& comparator = Compare()) {
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("Cannot open the snapshot " + path + ".");
+        }
+        struct stat status;
+        if (::fstat(file, &status) != 0 || status.st_size == 0) {
+            ::close(file);
+            throw std::runtime_error("Cannot map the snapshot " + path + ".");
+        }
+        const size_t bytes = static_cast<size_t>(status.st_size);
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, file, 0);
+        ::close(file);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map the snapshot " + path + ".");
+        }
+
+        mapped_set result(comparator);
+        // Owning the mapping before validation unmaps it if that throws.
+        result.mapping_ = mapping;
+        result.mappingBytes_ = bytes;
+        result.attach(mapping, bytes);
+        return result;
+    }
+
+    // Uses a snapshot already in memory, which must stay alive and unchanged
+    // as long as the set, and be aligned like the nodes.
+    mapped_set(const void* data, size_t bytes, const Compare& comparator = Compare()) :
+            comparator_(comparator) {
+        attach(data, bytes);
+    }
+
+    mapped_set(mapped_set&& rhs) noexcept :
+            nodes_(rhs.nodes_),
+            size_(rhs.size_),
+            root_(rhs.root_),
+            comparator_(rhs.comparator_),
+            mapping_(rhs.mapping_),
+            mappingBytes_(rhs.mappingBytes_) {
+        rhs.mapping_ = nullptr;
+        rhs.nodes_ = nullptr;
+        rhs.size_ = 0;
+        rhs.root_ = NO_NODE;
+    }
+
+    mapped_set& operator=(mapped_set&& rhs) noexcept {
+        swap(rhs);
+        return *this;
+    }
+
+    mapped_set(const mapped_set&) = delete;
+    mapped_set& operator=(const mapped_set&) = delete;
+
+    ~mapped_set() noexcept {
+        if (mapping_) {
+            ::munmap(mapping_, mappingBytes_);
+        }
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator(nodes_);
+    }
+
+    const_iterator cbegin() const noexcept {
+        return begin();
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator(nodes_ + size_);
+    }
+
+    const_iterator cend() const noexcept {
+        return end();
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator crbegin() const noexcept {
+        return rbegin();
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crend() const noexcept {
+        return rend();
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    size_type size() const noexcept {
+        return size_;
+    }
+
+    void swap(mapped_set& rhs) noexcept {
+        using std::swap;
+        swap(nodes_, rhs.nodes_);
+        swap(size_, rhs.size_);
+        swap(root_, rhs.root_);
+        swap(comparator_, rhs.comparator_);
+        swap(mapping_, rhs.mapping_);
+        swap(mappingBytes_, rhs.mappingBytes_);
+    }
+
+    const_iterator find(const Key& key) const {
+        const NodeIndex node = lowerBound(key);
+        if (node == size_ || comparator_(key, nodes_[node].value)) {
+            return end();
+        }
+        return const_iterator(nodes_ + node);
+    }
+
+    bool contains(const Key& key) const {
+        return find(key) != end();
+    }
+
+    // Snapshots of a multiset keep their duplicates.
+    size_type count(const Key& key) const {
+        return upperBound(key) - lowerBound(key);
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return const_iterator(nodes_ + lowerBound(key));
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        return const_iterator(nodes_ + upperBound(key));
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+private:
+    explicit mapped_set(const Compare& comparator) :
+        comparator_(comparator) {
+    }
+
+    static size_t nodesOffset() noexcept {
+        return (sizeof(Header) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+    }
+
+    static NodeIndex middleOf(NodeIndex first, NodeIndex last) noexcept {
+        return first < last ? first + (last - first) / 2 : NodeIndex(NO_NODE);
+    }
+
+    // Writes the node of the balanced tree over the indices from first to
+    // last, and its subtrees, in order.
+    template<typename InputIterator>
+    static void writeNodes(
+        std::ostream& out,
+        InputIterator& element,
+        NodeIndex first,
+        NodeIndex last);
+
+    void attach(const void* data, size_t bytes) {
+        const char* base = static_cast<const char*>(data);
+        Header header;
+        if (bytes < sizeof(header)) {
+            throw std::runtime_error("The snapshot is truncated.");
+        }
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, "SPLAYSNP", sizeof(header.magic)) != 0 ||
+                header.version != VERSION) {
+            throw std::runtime_error("The data is not a splay tree snapshot.");
+        }
+        if (header.keySize != sizeof(Key) || header.nodeSize != sizeof(Node)) {
+            throw std::runtime_error("The snapshot has another key type.");
+        }
+        if (header.size >= NO_NODE ||
+                bytes != nodesOffset() + header.size * sizeof(Node) ||
+                (header.size == 0) != (header.root == NO_NODE) ||
+                (header.size != 0 && header.root >= header.size)) {
+            throw std::runtime_error("The snapshot is truncated or corrupt.");
+        }
+        if (reinterpret_cast<uintptr_t>(base + nodesOffset()) % alignof(Node) != 0) {
+            throw std::invalid_argument("The snapshot is misaligned.");
+        }
+        nodes_ = reinterpret_cast<const Node*>(base + nodesOffset());
+        size_ = static_cast<size_type>(header.size);
+        root_ = header.root;
+    }
+
+    // Index of the first element not less than the key, size_ if none.
+    NodeIndex lowerBound(const Key& key) const {
+        NodeIndex result = static_cast<NodeIndex>(size_);
+        for (NodeIndex node = root_; node != NO_NODE; ) {
+            if (comparator_(nodes_[node].value, key)) {
+                node = nodes_[node].rightChild;
+            } else {
+                result = node;
+                node = nodes_[node].leftChild;
+            }
+        }
+        return result;
+    }
+
+    NodeIndex upperBound(const Key& key) const {
+        NodeIndex result = static_cast<NodeIndex>(size_);
+        for (NodeIndex node = root_; node != NO_NODE; ) {
+            if (comparator_(key, nodes_[node].value)) {
+                result = node;
+                node = nodes_[node].leftChild;
+            } else {
+                node = nodes_[node].rightChild;
+            }
+        }
+        return result;
+    }
+
+    const Node* nodes_{nullptr};
+    size_type size_{0};
+    NodeIndex root_{NO_NODE};
+    Compare comparator_;
+    // The mapping of a file opened by open(), null for data in memory.
+    void* mapping_{nullptr};
+    size_t mappingBytes_{0};
+};
+
+template<typename Key, typename Compare>
+template<typename Container>
+void mapped_set<Key, Compare>::write(const Container& container, const std::string& path) {
+    if (container.size() >= NO_NODE) {
+        throw std::length_error("Too many elements for a snapshot.");
+    }
+    const NodeIndex size = static_cast<NodeIndex>(container.size());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SPLAYSNP", sizeof(header.magic));
+    header.version = VERSION;
+    header.nodeSize = sizeof(Node);
+    header.size = size;
+    header.root = middleOf(0, size);
+    header.keySize = sizeof(Key);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[alignof(Node)] = {};
+    out.write(padding, nodesOffset() - sizeof(header));
+
+    auto element = container.begin();
+    writeNodes(out, element, 0, size);
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Cannot write the snapshot " + path + ".");
+    }
+}
+
+template<typename Key, typename Compare>
+template<typename InputIterator>
+void mapped_set<Key, Compare>::writeNodes(
+        std::ostream& out,
+        InputIterator& element,
+        NodeIndex first,
+        NodeIndex last) {
+    // The recursion is as deep as the balanced tree, i.e. logarithmic.
+    if (first >= last) {
+        return;
+    }
+    const NodeIndex middle = middleOf(first, last);
+    writeNodes(out, element, first, middle);
+
+    Node node;
+    // Zeroes the padding too, so that snapshots of equal sets are equal.
+    std::memset(static_cast<void*>(&node), 0, sizeof(node));
+    node.value = *element;
+    ++element;
+    node.leftChild = middleOf(first, middle);
+    node.rightChild = middleOf(middle + 1, last);
+    out.write(reinterpret_cast<const char*>(&node), sizeof(node));
+
+    writeNodes(out, element, middle + 1, last);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_MAPPED_SET_H_
@@ -0,0 +1,522 @@
+#ifndef SPLAY_TREE_MULTIMAP_H_
+#define SPLAY_TREE_MULTIMAP_H_
+
+#include "splay-tree.h"
+#include "key-of-value.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace splay_tree {
+
+// SplayPolicy (see splay-policy.h) selects how lookups and insertions splay.
+// NodeUpdate = SubtreeSizeNodeUpdate enables the order statistics nth() and
+// rank().
+template <
+    typename Key,
+    typename T,
+    typename Compare = std::less<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, T>>,
+    typename NodeUpdate = NullNodeUpdate,
+    typename SplayPolicy = AlwaysSplay
+>
+class multimap {
+private:
+    template<typename K>
+    using EnableIfTransparent =
+        typename std::enable_if<IsTransparent<Compare, K>::value>::type;
+
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key, T> value_type;
+    typedef Compare key_compare;
+    typedef Allocator allocator_type;
+
+    class value_compare {
+    public:
+        bool operator()(const value_type& lhs, const value_type& rhs) const {
+            return comparator_(lhs.first, rhs.first);
+        }
+
+    protected:
+        friend class multimap;
+
+        explicit value_compare(const Compare& comparator) :
+            comparator_(comparator) {
+        }
+
+        Compare comparator_;
+    };
+
+private:
+    typedef typename Allocator::template rebind<value_type>::other ValueAllocator;
+
+    typedef SplayTree<
+        Key, value_type, Select1st, Compare, ValueAllocator, NodeUpdate, SplayPolicy>
+        MultimapImpl;
+
+public:
+    typedef typename MultimapImpl::pointer pointer;
+    typedef typename MultimapImpl::const_pointer const_pointer;
+    typedef typename MultimapImpl::reference reference;
+    typedef typename MultimapImpl::const_reference const_reference;
+    typedef typename MultimapImpl::size_type size_type;
+    typedef typename MultimapImpl::difference_type difference_type;
+
+    typedef typename MultimapImpl::iterator iterator;
+    typedef typename MultimapImpl::const_iterator const_iterator;
+    typedef typename MultimapImpl::reverse_iterator reverse_iterator;
+    typedef typename MultimapImpl::const_reverse_iterator const_reverse_iterator;
+
+    multimap() :
+        multimapImpl_() {
+    }
+
+    explicit multimap(
+            const Compare& comparator,
+            const Allocator& allocator = Allocator()) :
+        multimapImpl_(comparator, ValueAllocator(allocator)) {
+    }
+
+    template<typename InputIterator>
+    multimap(InputIterator first, InputIterator last) :
+            multimapImpl_() {
+        multimapImpl_.insertEqual(first, last);
+    }
+
+    template<typename InputIterator>
+    multimap(
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator,
+        const Allocator& allocator = Allocator()) :
+            multimapImpl_(comparator, ValueAllocator(allocator)) {
+        multimapImpl_.insertEqual(first, last);
+    }
+
+    // The range must be sorted by key. Builds the multimap in linear time.
+    template<typename InputIterator>
+    multimap(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            multimapImpl_(
+                from_sorted,
+                first,
+                last,
+                comparator,
+                ValueAllocator(allocator)) {
+    }
+
+    multimap(
+        std::initializer_list<value_type> initializerList,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            multimapImpl_(comparator, ValueAllocator(allocator)) {
+        multimapImpl_.insertEqual(initializerList.begin(), initializerList.end());
+    }
+
+    multimap(const multimap& rhs) = default;
+
+    multimap(multimap&& rhs) = default;
+
+    multimap& operator=(const multimap& rhs) = default;
+
+    multimap& operator=(multimap&& rhs) = default;
+
+    multimap& operator=(std::initializer_list<value_type> initializerList) {
+        clear();
+        insert(initializerList.begin(), initializerList.end());
+        return *this;
+    }
+
+    iterator begin() noexcept {
+        return multimapImpl_.begin();
+    }
+
+    const_iterator begin() const noexcept {
+        return multimapImpl_.begin();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return multimapImpl_.cbegin();
+    }
+
+    iterator end() noexcept {
+        return multimapImpl_.end();
+    }
+
+    const_iterator end() const noexcept {
+        return multimapImpl_.end();
+    }
+
+    const_iterator cend() const noexcept {
+        return multimapImpl_.cend();
+    }
+
+    reverse_iterator rbegin() noexcept {
+        return multimapImpl_.rbegin();
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return multimapImpl_.rbegin();
+    }
+
+    const_reverse_iterator crbegin() const noexcept {
+        return multimapImpl_.crbegin();
+    }
+
+    reverse_iterator rend() noexcept {
+        return multimapImpl_.rend();
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return multimapImpl_.rend();
+    }
+
+    const_reverse_iterator crend() const noexcept {
+        return multimapImpl_.crend();
+    }
+
+    bool empty() const noexcept {
+        return multimapImpl_.empty();
+    }
+
+    size_type size() const noexcept {
+        return multimapImpl_.size();
+    }
+
+    size_type max_size() const noexcept {
+        return multimapImpl_.max_size();
+    }
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+    const SplayTreeStats& stats() const noexcept {
+        return multimapImpl_.stats();
+    }
+
+    void reset_stats() noexcept {
+        multimapImpl_.resetStats();
+    }
+#endif
+
+    void swap(multimap& rhs) noexcept(
+            IsNothrowSwappable<Compare>::value &&
+            IsNothrowSwappable<SplayPolicy>::value) {
+        multimapImpl_.swap(rhs.multimapImpl_);
+    }
+
+    void clear() noexcept {
+        multimapImpl_.clear();
+    }
+
+    // Insert/erase operations.
+    iterator insert(const value_type& value) {
+        return multimapImpl_.insertEqual(value);
+    }
+
+    iterator insert(value_type&& value) {
+        return multimapImpl_.insertEqual(std::move(value));
+    }
+
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        multimapImpl_.insertEqual(first, last);
+    }
+
+    void insert(std::initializer_list<value_type> initializerList) {
+        insert(initializerList.begin(), initializerList.end());
+    }
+
+    template<typename... Args>
+    iterator emplace(Args&&... args) {
+        return multimapImpl_.emplaceEqual(std::forward<Args>(args)...);
+    }
+
+    // A value belonging directly before hint is linked there without a
+    // descent from the root, otherwise the hint is ignored.
+    iterator insert(const_iterator hint, const value_type& value) {
+        return multimapImpl_.insertEqualWithHint(hint, value);
+    }
+
+    iterator insert(const_iterator hint, value_type&& value) {
+        return multimapImpl_.insertEqualWithHint(hint, std::move(value));
+    }
+
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        return multimapImpl_.emplaceEqualWithHint(hint, std::forward<Args>(args)...);
+    }
+
+    iterator erase(const_iterator position) {
+        return multimapImpl_.erase(position);
+    }
+
+    iterator erase(iterator position) {
+        return multimapImpl_.erase(position);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        return multimapImpl_.erase(first, last);
+    }
+
+    // Moves the elements with keys in [lowerKey, upperKey) to the returned
+    // multimap, in amortized logarithmic time with SubtreeSizeNodeUpdate.
+    // Otherwise the smaller of the range and the rest is counted, which adds
+    // time linear in its size, see SplayTree::split().
+    multimap extract_range(const Key& lowerKey, const Key& upperKey) {
+        return multimap(multimapImpl_.extractRange(lowerKey, upperKey));
+    }
+
+    size_type erase(const Key& key) {
+        return multimapImpl_.erase(key);
+    }
+
+    template<
+        typename K,
+        typename = EnableIfTransparent<K>,
+        typename = typename std::enable_if<
+            !std::is_convertible<K, const_iterator>::value>::type
+    >
+    size_type erase(const K& key) {
+        return multimapImpl_.erase(key);
+    }
+
+    // Find operations.
+    // The non-const lookups splay as the splay policy requests. With a
+    // transparent comparator they also take any type comparable with the keys.
+    iterator find(const Key& key) {
+        return multimapImpl_.find(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator find(const K& key) {
+        return multimapImpl_.find(key);
+    }
+
+    const_iterator find(const Key& key) const {
+        return multimapImpl_.find(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator find(const K& key) const {
+        return multimapImpl_.find(key);
+    }
+
+    size_type count(const Key& key) {
+        return multimapImpl_.count(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) {
+        return multimapImpl_.count(key);
+    }
+
+    size_type count(const Key& key) const {
+        return multimapImpl_.count(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) const {
+        return multimapImpl_.count(key);
+    }
+
+    iterator lower_bound(const Key& key) {
+        return multimapImpl_.lower_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator lower_bound(const K& key) {
+        return multimapImpl_.lower_bound(key);
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return multimapImpl_.lower_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator lower_bound(const K& key) const {
+        return multimapImpl_.lower_bound(key);
+    }
+
+    iterator upper_bound(const Key& key) {
+        return multimapImpl_.upper_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) {
+        return multimapImpl_.upper_bound(key);
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        return multimapImpl_.upper_bound(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator upper_bound(const K& key) const {
+        return multimapImpl_.upper_bound(key);
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        return multimapImpl_.equal_range(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return multimapImpl_.equal_range(key);
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        return multimapImpl_.equal_range(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return multimapImpl_.equal_range(key);
+    }
+
+    // Order statistics, see SplayTree::nth() and SplayTree::rank().
+    iterator nth(size_type index) {
+        return multimapImpl_.nth(index);
+    }
+
+    const_iterator nth(size_type index) const {
+        return multimapImpl_.nth(index);
+    }
+
+    size_type rank(const Key& key) {
+        return multimapImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) {
+        return multimapImpl_.rank(key);
+    }
+
+    size_type rank(const Key& key) const {
+        return multimapImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) const {
+        return multimapImpl_.rank(key);
+    }
+
+private:
+    explicit multimap(MultimapImpl&& impl) :
+        multimapImpl_(std::move(impl)) {
+    }
+
+    MultimapImpl multimapImpl_;
+};
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator==(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator!=(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs == rhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator<(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return std::lexicographical_compare(
+        lhs.begin(),
+        lhs.end(),
+        rhs.begin(),
+        rhs.end());
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator>=(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs < rhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator>(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return rhs < lhs;
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline bool operator<=(
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(rhs < lhs);
+}
+
+template<
+    typename Key,
+    typename T,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+inline void swap(
+        multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        multimap<Key, T, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_MULTIMAP_H_
@@ -4,20 +4,33 @@
 #include "splay-tree.h"
 #include "key-of-value.h"
 
+#include <algorithm>
 #include <initializer_list>
 
 namespace splay_tree {
 
+// SplayPolicy (see splay-policy.h) selects how lookups and insertions splay.
+// NodeUpdate = SubtreeSizeNodeUpdate enables the order statistics nth() and
+// rank(), and makes count() logarithmic instead of linear in the number of
+// duplicates.
 template <
     typename Key,
     typename Compare = std::less<Key>,
-    typename Allocator = std::allocator<Key>
+    typename Allocator = std::allocator<Key>,
+    typename NodeUpdate = NullNodeUpdate,
+    typename SplayPolicy = AlwaysSplay
 >
 class multiset {
 private:
+    template<typename K>
+    using EnableIfTransparent =
+        typename std::enable_if<IsTransparent<Compare, K>::value>::type;
+
     typedef typename Allocator::template rebind<Key>::other KeyAllocator;
 
-    typedef SplayTree<Key, Key, Identity, Compare, KeyAllocator> MultisetImpl;
+    typedef SplayTree<
+        Key, Key, Identity, Compare, KeyAllocator, NodeUpdate, SplayPolicy>
+        MultisetImpl;
 
 public:
     typedef Compare key_compare;
@@ -35,9 +48,11 @@ public:
 
     typedef typename MultisetImpl::const_iterator iterator;
     typedef typename MultisetImpl::const_iterator const_iterator;
-    typedef typename MultisetImpl::reverse_iterator reverse_iterator;
+    typedef typename MultisetImpl::const_reverse_iterator reverse_iterator;
     typedef typename MultisetImpl::const_reverse_iterator const_reverse_iterator;
 
+    typedef typename MultisetImpl::node_type node_type;
+
     multiset() :
         multisetImpl_() {
     }
@@ -64,6 +79,22 @@ public:
         multisetImpl_.insertEqual(first, last);
     }
 
+    // The range must be sorted. Builds the multiset in linear time.
+    template<typename InputIterator>
+    multiset(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            multisetImpl_(
+                from_sorted,
+                first,
+                last,
+                comparator,
+                KeyAllocator(allocator)) {
+    }
+
     multiset(
         std::initializer_list<Key> initializerList,
         const Compare& comparator = Compare(),
@@ -74,20 +105,11 @@ public:
 
     multiset(const multiset& rhs) = default;
 
-    // TODO Make noexcept.
     multiset(multiset&& rhs) = default;
 
-    multiset& operator=(const multiset& rhs) {
-        multiset temp = rhs;
-        swap(temp);
-        return *this;
-    }
+    multiset& operator=(const multiset& rhs) = default;
 
-    multiset& operator=(multiset&& rhs) {
-        clear();
-        swap(rhs);
-        return *this;
-    }
+    multiset& operator=(multiset&& rhs) = default;
 
     multiset& operator=(std::initializer_list<Key> initializerList) {
         clear();
@@ -111,19 +133,19 @@ public:
         return multisetImpl_.cend();
     }
 
-    iterator rbegin() const noexcept {
+    reverse_iterator rbegin() const noexcept {
         return multisetImpl_.rbegin();
     }
 
-    iterator crbegin() const noexcept {
+    reverse_iterator crbegin() const noexcept {
         return multisetImpl_.crbegin();
     }
 
-    iterator rend() const noexcept {
+    reverse_iterator rend() const noexcept {
         return multisetImpl_.rend();
     }
 
-    iterator crend() const noexcept {
+    reverse_iterator crend() const noexcept {
         return multisetImpl_.crend();
     }
 
@@ -139,7 +161,19 @@ public:
         return multisetImpl_.max_size();
     }
 
-    void swap(multiset& rhs) {
+#ifdef SPLAY_TREE_ENABLE_STATS
+    const SplayTreeStats& stats() const noexcept {
+        return multisetImpl_.stats();
+    }
+
+    void reset_stats() noexcept {
+        multisetImpl_.resetStats();
+    }
+#endif
+
+    void swap(multiset& rhs) noexcept(
+            IsNothrowSwappable<Compare>::value &&
+            IsNothrowSwappable<SplayPolicy>::value) {
         multisetImpl_.swap(rhs.multisetImpl_);
     }
 
@@ -166,8 +200,23 @@ public:
     }
 
     template<typename... Args>
-    std::pair<iterator, bool> emplace(Args&&... args) {
-        return multisetImpl_.emplaceUnique(std::forward<Args>(args)...);
+    iterator emplace(Args&&... args) {
+        return multisetImpl_.emplaceEqual(std::forward<Args>(args)...);
+    }
+
+    // A value belonging directly before hint is linked there without a
+    // descent from the root, otherwise the hint is ignored.
+    iterator insert(const_iterator hint, const Key& key) {
+        return multisetImpl_.insertEqualWithHint(hint, key);
+    }
+
+    iterator insert(const_iterator hint, Key&& key) {
+        return multisetImpl_.insertEqualWithHint(hint, std::move(key));
+    }
+
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        return multisetImpl_.emplaceEqualWithHint(hint, std::forward<Args>(args)...);
     }
 
     iterator erase(const_iterator position) {
@@ -178,103 +227,326 @@ public:
         return multisetImpl_.erase(first, last);
     }
 
+    // Moves the keys in [lowerKey, upperKey) to the returned multiset, in
+    // amortized logarithmic time with SubtreeSizeNodeUpdate. Otherwise the
+    // smaller of the range and the rest is counted, which adds time linear
+    // in its size, see SplayTree::split().
+    multiset extract_range(const Key& lowerKey, const Key& upperKey) {
+        return multiset(multisetImpl_.extractRange(lowerKey, upperKey));
+    }
+
     size_type erase(const Key& key) {
         return multisetImpl_.erase(key);
     }
 
+    template<
+        typename K,
+        typename = EnableIfTransparent<K>,
+        typename = typename std::enable_if<
+            !std::is_convertible<K, const_iterator>::value>::type
+    >
+    size_type erase(const K& key) {
+        return multisetImpl_.erase(key);
+    }
+
+    // Node handles move elements between multisets without allocations: the
+    // extracted node is relinked by insert() and merge().
+    node_type extract(const_iterator position) {
+        return multisetImpl_.extract(position);
+    }
+
+    node_type extract(const Key& key) {
+        return multisetImpl_.extract(key);
+    }
+
+    iterator insert(node_type&& node) {
+        return multisetImpl_.insertEqual(std::move(node));
+    }
+
+    // Moves all elements of source into this multiset.
+    void merge(multiset& source) {
+        multisetImpl_.spliceEqual(source.multisetImpl_);
+    }
+
+    void merge(multiset&& source) {
+        merge(source);
+    }
+
     // Find operations.
-    // Does a splay if the key is found.
+    // The non-const lookups splay as the splay policy requests. With a
+    // transparent comparator they also take any type comparable with the keys.
     iterator find(const Key& key) {
         return multisetImpl_.find(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator find(const K& key) {
+        return multisetImpl_.find(key);
+    }
+
     const_iterator find(const Key& key) const {
         return multisetImpl_.find(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator find(const K& key) const {
+        return multisetImpl_.find(key);
+    }
+
     size_type count(const Key& key) {
         return multisetImpl_.count(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) {
+        return multisetImpl_.count(key);
+    }
+
     size_type count(const Key& key) const {
         return multisetImpl_.count(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) const {
+        return multisetImpl_.count(key);
+    }
+
     iterator lower_bound(const Key& key) {
         return multisetImpl_.lower_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator lower_bound(const K& key) {
+        return multisetImpl_.lower_bound(key);
+    }
+
     const_iterator lower_bound(const Key& key) const {
         return multisetImpl_.lower_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator lower_bound(const K& key) const {
+        return multisetImpl_.lower_bound(key);
+    }
+
     iterator upper_bound(const Key& key) {
         return multisetImpl_.upper_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) {
+        return multisetImpl_.upper_bound(key);
+    }
+
     iterator upper_bound(const Key& key) const {
         return multisetImpl_.upper_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) const {
+        return multisetImpl_.upper_bound(key);
+    }
+
     std::pair<iterator, iterator> equal_range(const Key& key) {
         return multisetImpl_.equal_range(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return multisetImpl_.equal_range(key);
+    }
+
     std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
         return multisetImpl_.equal_range(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return multisetImpl_.equal_range(key);
+    }
+
+    // Order statistics, see SplayTree::nth() and SplayTree::rank().
+    iterator nth(size_type index) {
+        return multisetImpl_.nth(index);
+    }
+
+    const_iterator nth(size_type index) const {
+        return multisetImpl_.nth(index);
+    }
+
+    size_type rank(const Key& key) {
+        return multisetImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) {
+        return multisetImpl_.rank(key);
+    }
+
+    size_type rank(const Key& key) const {
+        return multisetImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) const {
+        return multisetImpl_.rank(key);
+    }
+
+    // Set algebra in place, see SplayTree::unionWith(). An rvalue rhs gives
+    // up its nodes and is left empty.
+    void union_with(multiset&& rhs) {
+        multisetImpl_.unionWith(std::move(rhs.multisetImpl_));
+    }
+
+    void union_with(const multiset& rhs) {
+        multisetImpl_.unionWith(rhs.multisetImpl_);
+    }
+
+    void intersect_with(multiset&& rhs) {
+        multisetImpl_.intersectWith(std::move(rhs.multisetImpl_));
+    }
+
+    void intersect_with(const multiset& rhs) {
+        multisetImpl_.intersectWith(rhs.multisetImpl_);
+    }
+
+    void difference_with(multiset&& rhs) {
+        multisetImpl_.differenceWith(std::move(rhs.multisetImpl_));
+    }
+
+    void difference_with(const multiset& rhs) {
+        multisetImpl_.differenceWith(rhs.multisetImpl_);
+    }
+
+    // Batch lookups, see SplayTree::findBatch(). The results for the keys in
+    // [first, last) are written to out in the order of the keys.
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator find_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return multisetImpl_.findBatch(first, last, out);
+    }
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator count_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return multisetImpl_.countBatch(first, last, out);
+    }
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator contains_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return multisetImpl_.containsBatch(first, last, out);
+    }
+
 private:
+    friend class ParallelOperations;
+
+    explicit multiset(MultisetImpl&& impl) :
+        multisetImpl_(std::move(impl)) {
+    }
 
     MultisetImpl multisetImpl_;
 };
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator==(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ == rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator!=(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ != rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs == rhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator<(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ < rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return std::lexicographical_compare(
+        lhs.begin(),
+        lhs.end(),
+        rhs.begin(),
+        rhs.end());
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator>=(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ >= rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs < rhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator>(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ > rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return rhs < lhs;
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator<=(
-        const multiset<Key, Compare, Allocator>& lhs,
-        const multiset<Key, Compare, Allocator>& rhs) {
-    return lhs.multisetImpl_ <= rhs.multisetImpl_;
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(rhs < lhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline void swap(
-        multiset<Key, Compare, Allocator>& lhs,
-        multiset<Key, Compare, Allocator>& rhs) {
+        multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
     lhs.swap(rhs);
 }
 
@@ -0,0 +1,76 @@
+#ifndef SPLAY_TREE_NODE_UPDATE_H_
+#define SPLAY_TREE_NODE_UPDATE_H_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace splay_tree {
+
+// A node update augments every tree node with Metadata (the node type derives
+// from it) holding a function of the node's subtree. The tree calls
+// update(node) whenever the children of a node change, children first, so
+// update may rely on the metadata of both children being up to date.
+
+// The default: no metadata, so nodes carry no extra memory.
+struct NullNodeUpdate {
+    struct Metadata {
+    };
+
+    template<typename Node>
+    static void update(Node&) noexcept {
+    }
+};
+
+struct SubtreeSize {
+    size_t subtreeSize{1};
+};
+
+// Maintains subtree sizes, which enables order statistics (nth(), rank()),
+// logarithmic count() and constant-time sizing of split results.
+struct SubtreeSizeNodeUpdate {
+    typedef SubtreeSize Metadata;
+
+    template<typename Node>
+    static void update(Node& node) noexcept {
+        node.subtreeSize = 1 +
+            (node.leftChild ? node.leftChild->subtreeSize : 0) +
+            (node.rightChild ? node.rightChild->subtreeSize : 0);
+    }
+};
+
+// True when NodeUpdate keeps SubtreeSize up to date. Custom node updates can
+// derive their metadata from SubtreeSize (and maintain it) to keep order
+// statistics available.
+template<typename NodeUpdate>
+struct TracksSubtreeSize :
+    std::is_base_of<SubtreeSize, typename NodeUpdate::Metadata> {
+};
+
+struct SubtreeHeight {
+    size_t subtreeHeight{1};
+};
+
+// Maintains subtree heights, the number of nodes on the longest path down
+// from a node, which lets the tree find its deepest element (deepest()).
+struct SubtreeHeightNodeUpdate {
+    typedef SubtreeHeight Metadata;
+
+    template<typename Node>
+    static void update(Node& node) noexcept {
+        const size_t leftHeight =
+            node.leftChild ? node.leftChild->subtreeHeight : 0;
+        const size_t rightHeight =
+            node.rightChild ? node.rightChild->subtreeHeight : 0;
+        node.subtreeHeight =
+            1 + (leftHeight < rightHeight ? rightHeight : leftHeight);
+    }
+};
+
+template<typename NodeUpdate>
+struct TracksSubtreeHeight :
+    std::is_base_of<SubtreeHeight, typename NodeUpdate::Metadata> {
+};
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_NODE_UPDATE_H_
@@ -0,0 +1,578 @@
+#ifndef SPLAY_TREE_PARALLEL_H_
+#define SPLAY_TREE_PARALLEL_H_
+
+#include "splay-tree.h"
+#include "set.h"
+#include "multiset.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace splay_tree {
+
+// Tunes the parallel bulk operations: their work is divided into at most
+// threads tasks, each of at least grain elements.
+struct ParallelOptions {
+    size_t threads{std::max(std::thread::hardware_concurrency(), 1u)};
+    size_t grain{1 << 14};
+};
+
+// The implementation of the parallel_* functions below, a friend of the
+// containers.
+class ParallelOperations {
+public:
+    template<typename Container>
+    static Container copy(const Container& container, const ParallelOptions& options);
+
+    template<typename Container>
+    static void clear(Container& container, const ParallelOptions& options) noexcept {
+        clearTree(treeOf(container), options);
+    }
+
+    template<typename Container, typename RandomAccessIterator>
+    static void assignSorted(
+        Container& container,
+        RandomAccessIterator first,
+        RandomAccessIterator last,
+        const ParallelOptions& options);
+
+    template<typename Container, typename Function>
+    static void forEach(
+            const Container& container,
+            Function& function,
+            const ParallelOptions& options) {
+        const auto& tree = treeOf(container);
+        typedef typename std::decay<decltype(tree)>::type Tree;
+        forEachInSubtree<Tree>(tree.root(), function, forkBudgetOf(options, tree.size()));
+    }
+
+    template<typename Container, typename T, typename BinaryOp, typename Combine>
+    static T accumulate(
+            const Container& container,
+            const T& identity,
+            BinaryOp& op,
+            Combine& combine,
+            const ParallelOptions& options) {
+        const auto& tree = treeOf(container);
+        typedef typename std::decay<decltype(tree)>::type Tree;
+        return accumulateSubtree<Tree>(
+            tree.root(),
+            identity,
+            op,
+            combine,
+            forkBudgetOf(options, tree.size()));
+    }
+
+private:
+    template<
+        typename Key,
+        typename Value,
+        typename KeyOfValue,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&
+    treeOf(SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&
+            tree) noexcept {
+        return tree;
+    }
+
+    template<
+        typename Key,
+        typename Value,
+        typename KeyOfValue,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&
+    treeOf(const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&
+            tree) noexcept {
+        return tree;
+    }
+
+    template<
+        typename Key,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static typename set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>::SetImpl&
+    treeOf(set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& container) noexcept {
+        return container.setImpl_;
+    }
+
+    template<
+        typename Key,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static const typename set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>::SetImpl&
+    treeOf(const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& container) noexcept {
+        return container.setImpl_;
+    }
+
+    template<
+        typename Key,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static typename multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>::MultisetImpl&
+    treeOf(multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& container) noexcept {
+        return container.multisetImpl_;
+    }
+
+    template<
+        typename Key,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    static const typename multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>::MultisetImpl&
+    treeOf(const multiset<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& container) noexcept {
+        return container.multisetImpl_;
+    }
+
+    template<typename Tree>
+    struct NodeUpdateOf;
+
+    template<
+        typename Key,
+        typename Value,
+        typename KeyOfValue,
+        typename Compare,
+        typename Allocator,
+        typename NodeUpdate,
+        typename SplayPolicy
+    >
+    struct NodeUpdateOf<
+            SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>> {
+        typedef NodeUpdate type;
+    };
+
+    // How far a parallel operation may still divide its work: the number of
+    // levels it may fork at and the estimated size of the current subtree.
+    struct ForkBudget {
+        unsigned levels;
+        size_t size;
+        size_t grain;
+
+        bool allowsFork(size_t subtreeSize) const noexcept {
+            return levels > 0 && subtreeSize >= 2 * grain;
+        }
+
+        template<typename Node>
+        bool allowsFork(const Node* node) const noexcept {
+            return node->leftChild && node->rightChild && allowsFork(size);
+        }
+
+        ForkBudget child(size_t subtreeSize) const noexcept {
+            return ForkBudget{levels - 1, subtreeSize, grain};
+        }
+    };
+
+    static ForkBudget forkBudgetOf(const ParallelOptions& options, size_t size) noexcept {
+        // Every level of forks doubles the number of tasks.
+        unsigned levels = 0;
+        while (levels < 32 && (size_t(1) << levels) < options.threads) {
+            ++levels;
+        }
+        return ForkBudget{levels, size, std::max<size_t>(options.grain, 1)};
+    }
+
+    // Runs left on a new thread, or on this one when none can be started, and
+    // right on this one. If either throws, the result of the other is passed
+    // to discard and the exception is rethrown.
+    template<typename Result, typename Left, typename Right, typename Discard>
+    static std::pair<Result, Result> forkJoin(Left left, Right right, Discard discard);
+
+    template<typename Tree>
+    static void clearTree(Tree& tree, const ParallelOptions& options) noexcept;
+
+    template<typename Tree>
+    static typename Tree::SplayTreeNode* copySubtree(
+        Tree& tree,
+        typename Tree::SplayTreeNode* root,
+        ForkBudget budget);
+
+    template<typename Tree>
+    static void destroySubtree(
+        Tree& tree,
+        typename Tree::SplayTreeNode* root,
+        ForkBudget budget) noexcept;
+
+    template<typename Tree, typename RandomAccessIterator>
+    static typename Tree::SplayTreeNode* buildSubtree(
+        Tree& tree,
+        RandomAccessIterator first,
+        size_t size,
+        ForkBudget budget);
+
+    template<typename Tree, typename Function>
+    static void forEachInSubtree(
+        typename Tree::SplayTreeNode* root,
+        Function& function,
+        ForkBudget budget);
+
+    template<typename Tree, typename T, typename BinaryOp, typename Combine>
+    static T accumulateSubtree(
+        typename Tree::SplayTreeNode* root,
+        const T& identity,
+        BinaryOp& op,
+        Combine& combine,
+        ForkBudget budget);
+};
+
+// Parallel bulk operations on a SplayTree, set or multiset. The tree is
+// divided at the subtree roots near its root, which leaves it unchanged and
+// assumes that its top is roughly balanced, as it is after a sorted build or
+// random accesses; a degenerate top just leaves less to run in parallel. The
+// node allocator must be safe to use from several threads at once, as
+// std::allocator is and pool_allocator is not.
+template<typename Container>
+Container parallel_copy(
+        const Container& container,
+        const ParallelOptions& options = ParallelOptions()) {
+    return ParallelOperations::copy(container, options);
+}
+
+template<typename Container>
+void parallel_clear(
+        Container& container,
+        const ParallelOptions& options = ParallelOptions()) noexcept {
+    ParallelOperations::clear(container, options);
+}
+
+// Replaces the contents with the sorted range, as the from_sorted
+// constructor would build them. For a set the range must not contain
+// duplicates.
+template<typename Container, typename RandomAccessIterator>
+void parallel_assign_sorted(
+        Container& container,
+        RandomAccessIterator first,
+        RandomAccessIterator last,
+        const ParallelOptions& options = ParallelOptions()) {
+    ParallelOperations::assignSorted(container, first, last, options);
+}
+
+// Calls function with every element, from several threads at once and in no
+// particular order.
+template<typename Container, typename Function>
+void parallel_for_each(
+        const Container& container,
+        Function function,
+        const ParallelOptions& options = ParallelOptions()) {
+    ParallelOperations::forEach(container, function, options);
+}
+
+// Folds every part of the elements in order with op, starting from the
+// identity, and combines the results of consecutive parts in order, so op and
+// combine need to be associative but not commutative.
+template<typename Container, typename T, typename BinaryOp, typename Combine>
+T parallel_accumulate(
+        const Container& container,
+        T identity,
+        BinaryOp op,
+        Combine combine,
+        const ParallelOptions& options = ParallelOptions()) {
+    return ParallelOperations::accumulate(container, identity, op, combine, options);
+}
+
+template<typename Container>
+Container ParallelOperations::copy(
+        const Container& container,
+        const ParallelOptions& options) {
+    const auto& tree = treeOf(container);
+    typedef typename std::decay<decltype(tree)>::type Tree;
+    Tree result(
+        nullptr,
+        nullptr,
+        nullptr,
+        0,
+        tree.comparator_,
+        Tree::NodeAllocatorTraits::select_on_container_copy_construction(
+            tree.nodeAllocator_));
+    result.splayPolicy_ = tree.splayPolicy_;
+    if (tree.root()) {
+        result.setRoot(copySubtree(
+            result,
+            tree.root(),
+            forkBudgetOf(options, tree.size())));
+        result.leftMostNode_ = result.getLeftMostNode();
+        result.header_.parent = result.getRightMostNode();
+        result.numberOfNodes_ = tree.size();
+    }
+    return Container(std::move(result));
+}
+
+template<typename Container, typename RandomAccessIterator>
+void ParallelOperations::assignSorted(
+        Container& container,
+        RandomAccessIterator first,
+        RandomAccessIterator last,
+        const ParallelOptions& options) {
+    auto& tree = treeOf(container);
+    const size_t size = last - first;
+    auto root = buildSubtree(tree, first, size, forkBudgetOf(options, size));
+    clearTree(tree, options);
+    tree.setRoot(root);
+    tree.leftMostNode_ = tree.leftMostNodeOf(root);
+    tree.header_.parent = tree.rightMostNodeOf(root);
+    tree.numberOfNodes_ = size;
+}
+
+template<typename Result, typename Left, typename Right, typename Discard>
+std::pair<Result, Result> ParallelOperations::forkJoin(
+        Left left,
+        Right right,
+        Discard discard) {
+    std::future<Result> leftResult;
+    try {
+        leftResult = std::async(std::launch::async, left);
+    } catch (...) {
+        // No thread could be started, both run here.
+        Result leftValue = left();
+        try {
+            return std::make_pair(std::move(leftValue), right());
+        } catch (...) {
+            discard(leftValue);
+            throw;
+        }
+    }
+    try {
+        Result rightValue = right();
+        try {
+            return std::make_pair(leftResult.get(), std::move(rightValue));
+        } catch (...) {
+            discard(rightValue);
+            throw;
+        }
+    } catch (...) {
+        // The left task must finish before its inputs go away in any case.
+        if (leftResult.valid()) {
+            try {
+                discard(leftResult.get());
+            } catch (...) {
+            }
+        }
+        throw;
+    }
+}
+
+template<typename Tree>
+void ParallelOperations::clearTree(Tree& tree, const ParallelOptions& options) noexcept {
+    destroySubtree(tree, tree.root(), forkBudgetOf(options, tree.size()));
+    tree.header_.leftChild = nullptr;
+    tree.leftMostNode_ = nullptr;
+    tree.header_.parent = nullptr;
+    tree.numberOfNodes_ = 0;
+}
+
+template<typename Tree>
+typename Tree::SplayTreeNode* ParallelOperations::copySubtree(
+        Tree& tree,
+        typename Tree::SplayTreeNode* root,
+        ForkBudget budget) {
+    typedef typename Tree::SplayTreeNode SplayTreeNode;
+    typedef typename NodeUpdateOf<Tree>::type NodeUpdate;
+    if (!budget.allowsFork(root)) {
+        return tree.copyTree(
+            root,
+            Tree::countNodes(root, TracksSubtreeSize<NodeUpdate>()));
+    }
+    const ForkBudget childBudget = budget.child(budget.size / 2);
+    SplayTreeNode* rootCopy = tree.createNode(root->value);
+    std::pair<SplayTreeNode*, SplayTreeNode*> children;
+    try {
+        children = forkJoin<SplayTreeNode*>(
+            [&tree, root, childBudget]() {
+                return copySubtree(tree, root->leftChild, childBudget);
+            },
+            [&tree, root, childBudget]() {
+                return copySubtree(tree, root->rightChild, childBudget);
+            },
+            [&tree](SplayTreeNode* subtree) {
+                tree.destroyTree(subtree);
+            });
+    } catch (...) {
+        tree.destroyNode(rootCopy);
+        throw;
+    }
+    rootCopy->leftChild = children.first;
+    rootCopy->leftChild->parent = rootCopy;
+    rootCopy->rightChild = children.second;
+    rootCopy->rightChild->parent = rootCopy;
+    NodeUpdate::update(*rootCopy);
+    return rootCopy;
+}
+
+template<typename Tree>
+void ParallelOperations::destroySubtree(
+        Tree& tree,
+        typename Tree::SplayTreeNode* root,
+        ForkBudget budget) noexcept {
+    typedef typename Tree::SplayTreeNode SplayTreeNode;
+    if (!root || !budget.allowsFork(root)) {
+        tree.destroyTree(root);
+        return;
+    }
+    // destroyTree() climbs past the subtree root, so the subtrees are cut
+    // off first.
+    SplayTreeNode* leftChild = root->leftChild;
+    SplayTreeNode* rightChild = root->rightChild;
+    leftChild->parent = nullptr;
+    rightChild->parent = nullptr;
+    tree.destroyNode(root);
+    const ForkBudget childBudget = budget.child(budget.size / 2);
+    forkJoin<bool>(
+        [&tree, leftChild, childBudget]() {
+            destroySubtree(tree, leftChild, childBudget);
+            return true;
+        },
+        [&tree, rightChild, childBudget]() {
+            destroySubtree(tree, rightChild, childBudget);
+            return true;
+        },
+        [](bool) {
+        });
+}
+
+template<typename Tree, typename RandomAccessIterator>
+typename Tree::SplayTreeNode* ParallelOperations::buildSubtree(
+        Tree& tree,
+        RandomAccessIterator first,
+        size_t size,
+        ForkBudget budget) {
+    typedef typename Tree::SplayTreeNode SplayTreeNode;
+    if (size == 0) {
+        return nullptr;
+    }
+    // The same shape as SplayTree::buildBalancedTree() gives.
+    const size_t leftSize = (size - 1) / 2;
+    const size_t rightSize = size - 1 - leftSize;
+    SplayTreeNode* node = tree.createNode(first[leftSize]);
+    std::pair<SplayTreeNode*, SplayTreeNode*> children;
+    try {
+        if (budget.allowsFork(size)) {
+            children = forkJoin<SplayTreeNode*>(
+                [&tree, first, leftSize, budget]() {
+                    return buildSubtree(tree, first, leftSize, budget.child(leftSize));
+                },
+                [&tree, first, leftSize, rightSize, budget]() {
+                    return buildSubtree(
+                        tree,
+                        first + leftSize + 1,
+                        rightSize,
+                        budget.child(rightSize));
+                },
+                [&tree](SplayTreeNode* subtree) {
+                    tree.destroyTree(subtree);
+                });
+        } else {
+            children.first = buildSubtree(tree, first, leftSize, budget);
+            try {
+                children.second =
+                    buildSubtree(tree, first + leftSize + 1, rightSize, budget);
+            } catch (...) {
+                tree.destroyTree(children.first);
+                throw;
+            }
+        }
+    } catch (...) {
+        tree.destroyNode(node);
+        throw;
+    }
+    node->leftChild = children.first;
+    if (node->leftChild) {
+        node->leftChild->parent = node;
+    }
+    node->rightChild = children.second;
+    if (node->rightChild) {
+        node->rightChild->parent = node;
+    }
+    NodeUpdateOf<Tree>::type::update(*node);
+    return node;
+}
+
+template<typename Tree, typename Function>
+void ParallelOperations::forEachInSubtree(
+        typename Tree::SplayTreeNode* root,
+        Function& function,
+        ForkBudget budget) {
+    typedef typename Tree::value_type Value;
+    if (!root || !budget.allowsFork(root)) {
+        Tree::forEachInSubtree(root, function);
+        return;
+    }
+    const ForkBudget childBudget = budget.child(budget.size / 2);
+    forkJoin<bool>(
+        [&function, root, childBudget]() {
+            forEachInSubtree<Tree>(root->leftChild, function, childBudget);
+            return true;
+        },
+        [&function, root, childBudget]() {
+            function(static_cast<const Value&>(root->value));
+            forEachInSubtree<Tree>(root->rightChild, function, childBudget);
+            return true;
+        },
+        [](bool) {
+        });
+}
+
+template<typename Tree, typename T, typename BinaryOp, typename Combine>
+T ParallelOperations::accumulateSubtree(
+        typename Tree::SplayTreeNode* root,
+        const T& identity,
+        BinaryOp& op,
+        Combine& combine,
+        ForkBudget budget) {
+    typedef typename Tree::value_type Value;
+    if (!root || !budget.allowsFork(root)) {
+        T result = identity;
+        auto fold = [&result, &op](const Value& value) {
+            result = op(result, value);
+        };
+        Tree::forEachInSubtree(root, fold);
+        return result;
+    }
+    const ForkBudget childBudget = budget.child(budget.size / 2);
+    std::pair<T, T> parts = forkJoin<T>(
+        [&, root, childBudget]() {
+            return accumulateSubtree<Tree>(
+                root->leftChild,
+                identity,
+                op,
+                combine,
+                childBudget);
+        },
+        [&, root, childBudget]() {
+            return combine(
+                op(identity, static_cast<const Value&>(root->value)),
+                accumulateSubtree<Tree>(
+                    root->rightChild,
+                    identity,
+                    op,
+                    combine,
+                    childBudget));
+        },
+        [](const T&) {
+        });
+    return combine(std::move(parts.first), std::move(parts.second));
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_PARALLEL_H_
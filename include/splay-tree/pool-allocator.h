@@ -0,0 +1,281 @@
+#ifndef SPLAY_TREE_POOL_ALLOCATOR_H_
+#define SPLAY_TREE_POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace splay_tree {
+
+// Hands out fixed-size objects from slabs of geometrically growing size and
+// recycles freed objects through an intrusive free list. When the last object
+// is returned, all slabs but the first are released at once and the first is
+// reused from its start, so a pool that keeps emptying and refilling does not
+// allocate. The first slab is released when the pool is destroyed. Not
+// thread-safe.
+class SlabPool {
+public:
+    SlabPool(size_t objectSize, size_t objectAlignment) :
+        requestedSize_(objectSize),
+        requestedAlignment_(objectAlignment),
+        objectSize_(roundUp(
+            objectSize < sizeof(FreeObject) ? sizeof(FreeObject) : objectSize,
+            objectAlignment < alignof(FreeObject) ?
+                alignof(FreeObject) : objectAlignment)) {
+    }
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    ~SlabPool() noexcept {
+        releaseSlabs();
+    }
+
+    void* allocate() {
+        if (freeList_) {
+            FreeObject* object = freeList_;
+            freeList_ = object->next;
+            ++liveObjects_;
+            return object;
+        }
+        if (current_ == end_) {
+            addSlab();
+        }
+        void* object = current_;
+        current_ += objectSize_;
+        ++liveObjects_;
+        return object;
+    }
+
+    void deallocate(void* pointer) noexcept {
+        FreeObject* object = static_cast<FreeObject*>(pointer);
+        object->next = freeList_;
+        freeList_ = object;
+        if (--liveObjects_ == 0) {
+            rewind();
+        }
+    }
+
+    // Makes room for the given number of objects in the current slab, so that
+    // as many allocations after it, while the free list is empty, are served
+    // contiguously and in address order.
+    void reserve(size_t objects) {
+        if (objects > static_cast<size_t>(end_ - current_) / objectSize_) {
+            addSlab(objects);
+        }
+    }
+
+    // Number of objects the pool can hold without allocating a new slab.
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    bool serves(size_t objectSize, size_t objectAlignment) const noexcept {
+        return requestedSize_ == objectSize &&
+            requestedAlignment_ == objectAlignment;
+    }
+
+private:
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    static size_t roundUp(size_t size, size_t alignment) noexcept {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // A slab for at least minObjects objects; a reservation may exceed the
+    // usual slab size.
+    void addSlab(size_t minObjects = 1) {
+        const size_t firstSlabObjects = 64;
+        const size_t maxSlabBytes = 1 << 20;
+
+        // Every slab doubles the capacity until slabs reach maxSlabBytes.
+        size_t objects = capacity_ ? capacity_ : firstSlabObjects;
+        if (objects * objectSize_ > maxSlabBytes) {
+            objects = maxSlabBytes / objectSize_;
+        }
+        if (objects < minObjects) {
+            objects = minObjects;
+        }
+        slabs_.reserve(slabs_.size() + 1);
+        char* slab = static_cast<char*>(::operator new(objects * objectSize_));
+        slabs_.push_back(slab);
+        if (slabs_.size() == 1) {
+            firstSlabObjects_ = objects;
+        }
+        current_ = slab;
+        end_ = slab + objects * objectSize_;
+        capacity_ += objects;
+    }
+
+    // Keeps only the first slab, with all of its objects free.
+    void rewind() noexcept {
+        for (size_t i = 1; i < slabs_.size(); ++i) {
+            ::operator delete(slabs_[i]);
+        }
+        slabs_.resize(1);
+        freeList_ = nullptr;
+        current_ = slabs_.front();
+        end_ = current_ + firstSlabObjects_ * objectSize_;
+        capacity_ = firstSlabObjects_;
+    }
+
+    void releaseSlabs() noexcept {
+        for (char* slab : slabs_) {
+            ::operator delete(slab);
+        }
+        slabs_.clear();
+        freeList_ = nullptr;
+        current_ = nullptr;
+        end_ = nullptr;
+        capacity_ = 0;
+    }
+
+    size_t requestedSize_;
+    size_t requestedAlignment_;
+    size_t objectSize_;
+    std::vector<char*> slabs_;
+    FreeObject* freeList_{nullptr};
+    char* current_{nullptr};
+    char* end_{nullptr};
+    size_t capacity_{0};
+    size_t firstSlabObjects_{0};
+    size_t liveObjects_{0};
+};
+
+// The pools used by one family of rebound pool_allocator copies, one pool per
+// object size and alignment.
+class SlabPoolGroup {
+public:
+    SlabPool& pool(size_t objectSize, size_t objectAlignment) {
+        for (const auto& pool : pools_) {
+            if (pool->serves(objectSize, objectAlignment)) {
+                return *pool;
+            }
+        }
+        pools_.emplace_back(new SlabPool(objectSize, objectAlignment));
+        return *pools_.back();
+    }
+
+private:
+    std::vector<std::unique_ptr<SlabPool>> pools_;
+};
+
+// Allocator serving single-object requests, such as tree nodes, from a
+// SlabPool. Copies and rebound copies share their pools, while a default
+// constructed allocator and a container copy-constructed from another start a
+// fresh group, so every tree gets its own free list. Requests for several
+// objects fall back to operator new.
+template<typename T>
+class pool_allocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind {
+        typedef pool_allocator<U> other;
+    };
+
+    pool_allocator() :
+        group_(std::make_shared<SlabPoolGroup>()),
+        pool_(&group_->pool(sizeof(T), alignof(T))) {
+    }
+
+    pool_allocator(const pool_allocator& rhs) noexcept = default;
+
+    template<typename U>
+    pool_allocator(const pool_allocator<U>& rhs) :
+        group_(rhs.group_),
+        pool_(&group_->pool(sizeof(T), alignof(T))) {
+    }
+
+    pool_allocator& operator=(const pool_allocator& rhs) noexcept = default;
+
+    T* allocate(size_type n) {
+        if (n == 1) {
+            return static_cast<T*>(pool_->allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_type n) noexcept {
+        if (n == 1) {
+            pool_->deallocate(pointer);
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* pointer, Args&&... args) {
+        ::new(static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U* pointer) noexcept {
+        pointer->~U();
+    }
+
+    size_type max_size() const noexcept {
+        return size_type(-1) / sizeof(T);
+    }
+
+    pool_allocator select_on_container_copy_construction() const {
+        return pool_allocator();
+    }
+
+    // See SlabPool::reserve(). Containers that know how many nodes they are
+    // about to allocate, such as a copied tree, call it to lay them out in
+    // one block.
+    void reserve(size_type n) {
+        pool_->reserve(n);
+    }
+
+    // Number of objects the underlying pool can hold without growing.
+    size_type capacity() const noexcept {
+        return pool_->capacity();
+    }
+
+    template<typename U>
+    friend class pool_allocator;
+
+    template<typename U, typename V>
+    friend bool operator==(
+        const pool_allocator<U>& lhs,
+        const pool_allocator<V>& rhs) noexcept;
+
+private:
+    std::shared_ptr<SlabPoolGroup> group_;
+    SlabPool* pool_;
+};
+
+template<typename U, typename V>
+inline bool operator==(
+        const pool_allocator<U>& lhs,
+        const pool_allocator<V>& rhs) noexcept {
+    return lhs.group_ == rhs.group_;
+}
+
+template<typename U, typename V>
+inline bool operator!=(
+        const pool_allocator<U>& lhs,
+        const pool_allocator<V>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_POOL_ALLOCATOR_H_
@@ -4,20 +4,32 @@
 #include "splay-tree.h"
 #include "key-of-value.h"
 
+#include <algorithm>
 #include <initializer_list>
 
 namespace splay_tree {
 
+// SplayPolicy (see splay-policy.h) selects how lookups and insertions splay.
+// NodeUpdate = SubtreeSizeNodeUpdate enables the order statistics nth() and
+// rank().
 template <
     typename Key,
     typename Compare = std::less<Key>,
-    typename Allocator = std::allocator<Key>
+    typename Allocator = std::allocator<Key>,
+    typename NodeUpdate = NullNodeUpdate,
+    typename SplayPolicy = AlwaysSplay
 >
 class set {
 private:
+    template<typename K>
+    using EnableIfTransparent =
+        typename std::enable_if<IsTransparent<Compare, K>::value>::type;
+
     typedef typename Allocator::template rebind<Key>::other KeyAllocator;
 
-    typedef SplayTree<Key, Key, Identity, Compare, KeyAllocator> SetImpl;
+    typedef SplayTree<
+        Key, Key, Identity, Compare, KeyAllocator, NodeUpdate, SplayPolicy>
+        SetImpl;
 
 public:
     typedef Compare key_compare;
@@ -35,9 +47,12 @@ public:
 
     typedef typename SetImpl::const_iterator iterator;
     typedef typename SetImpl::const_iterator const_iterator;
-    typedef typename SetImpl::reverse_iterator reverse_iterator;
+    typedef typename SetImpl::const_reverse_iterator reverse_iterator;
     typedef typename SetImpl::const_reverse_iterator const_reverse_iterator;
 
+    typedef typename SetImpl::node_type node_type;
+    typedef InsertReturnType<iterator, node_type> insert_return_type;
+
     set() :
         setImpl_() {
     }
@@ -62,6 +77,22 @@ public:
         setImpl_.insertUnique(first, last);
     }
 
+    // The range must be sorted without duplicates. Builds the set in linear time.
+    template<typename InputIterator>
+    set(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            setImpl_(
+                from_sorted,
+                first,
+                last,
+                comparator,
+                KeyAllocator(allocator)) {
+    }
+
     set(
         std::initializer_list<Key> initializerList,
         const Compare& comparator = Compare(),
@@ -72,20 +103,11 @@ public:
 
     set(const set& rhs) = default;
 
-    // TODO Make noexcept.
     set(set&& rhs) = default;
 
-    set& operator=(const set& rhs) {
-        set temp = rhs;
-        swap(temp);
-        return *this;
-    }
+    set& operator=(const set& rhs) = default;
 
-    set& operator=(set&& rhs) {
-        clear();
-        swap(rhs);
-        return *this;
-    }
+    set& operator=(set&& rhs) = default;
 
     set& operator=(std::initializer_list<Key> initializerList) {
         clear();
@@ -109,19 +131,19 @@ public:
         return setImpl_.cend();
     }
 
-    iterator rbegin() const noexcept {
+    reverse_iterator rbegin() const noexcept {
         return setImpl_.rbegin();
     }
 
-    iterator crbegin() const noexcept {
+    reverse_iterator crbegin() const noexcept {
         return setImpl_.crbegin();
     }
 
-    iterator rend() const noexcept {
+    reverse_iterator rend() const noexcept {
         return setImpl_.rend();
     }
 
-    iterator crend() const noexcept {
+    reverse_iterator crend() const noexcept {
         return setImpl_.crend();
     }
 
@@ -137,7 +159,19 @@ public:
         return setImpl_.max_size();
     }
 
-    void swap(set& rhs) {
+#ifdef SPLAY_TREE_ENABLE_STATS
+    const SplayTreeStats& stats() const noexcept {
+        return setImpl_.stats();
+    }
+
+    void reset_stats() noexcept {
+        setImpl_.resetStats();
+    }
+#endif
+
+    void swap(set& rhs) noexcept(
+            IsNothrowSwappable<Compare>::value &&
+            IsNothrowSwappable<SplayPolicy>::value) {
         setImpl_.swap(rhs.setImpl_);
     }
 
@@ -168,6 +202,21 @@ public:
         return setImpl_.emplaceUnique(std::forward<Args>(args)...);
     }
 
+    // A value belonging directly before hint is linked there without a
+    // descent from the root, otherwise the hint is ignored.
+    iterator insert(const_iterator hint, const Key& key) {
+        return setImpl_.insertUniqueWithHint(hint, key);
+    }
+
+    iterator insert(const_iterator hint, Key&& key) {
+        return setImpl_.insertUniqueWithHint(hint, std::move(key));
+    }
+
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        return setImpl_.emplaceUniqueWithHint(hint, std::forward<Args>(args)...);
+    }
+
     iterator erase(const_iterator position) {
         return setImpl_.erase(position);
     }
@@ -176,104 +225,328 @@ public:
         return setImpl_.erase(first, last);
     }
 
+    // Moves the keys in [lowerKey, upperKey) to the returned set, in
+    // amortized logarithmic time with SubtreeSizeNodeUpdate. Otherwise the
+    // smaller of the range and the rest is counted, which adds time linear
+    // in its size, see SplayTree::split().
+    set extract_range(const Key& lowerKey, const Key& upperKey) {
+        return set(setImpl_.extractRange(lowerKey, upperKey));
+    }
+
     size_type erase(const Key& key) {
         return setImpl_.erase(key);
     }
 
+    template<
+        typename K,
+        typename = EnableIfTransparent<K>,
+        typename = typename std::enable_if<
+            !std::is_convertible<K, const_iterator>::value>::type
+    >
+    size_type erase(const K& key) {
+        return setImpl_.erase(key);
+    }
+
+    // Node handles move elements between sets without allocations: the
+    // extracted node is relinked by insert() and merge().
+    node_type extract(const_iterator position) {
+        return setImpl_.extract(position);
+    }
+
+    node_type extract(const Key& key) {
+        return setImpl_.extract(key);
+    }
+
+    insert_return_type insert(node_type&& node) {
+        auto result = setImpl_.insertUnique(std::move(node));
+        return {result.position, result.inserted, std::move(result.node)};
+    }
+
+    // Moves the keys of source missing here into this set, the others stay in
+    // source.
+    void merge(set& source) {
+        setImpl_.spliceUnique(source.setImpl_);
+    }
+
+    void merge(set&& source) {
+        merge(source);
+    }
+
     // Find operations.
-    // Does a splay if the key is found.
+    // The non-const lookups splay as the splay policy requests. With a
+    // transparent comparator they also take any type comparable with the keys.
     iterator find(const Key& key) {
         return setImpl_.find(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator find(const K& key) {
+        return setImpl_.find(key);
+    }
+
     const_iterator find(const Key& key) const {
         return setImpl_.find(key);
     }
 
-    // Does a splay if the key is found.
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator find(const K& key) const {
+        return setImpl_.find(key);
+    }
+
     size_type count(const Key& key) {
         return find(key) == end() ? 0 : 1;
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) {
+        return find(key) == end() ? 0 : 1;
+    }
+
     size_type count(const Key& key) const {
         return find(key) == end() ? 0 : 1;
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
     iterator lower_bound(const Key& key) {
         return setImpl_.lower_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator lower_bound(const K& key) {
+        return setImpl_.lower_bound(key);
+    }
+
     const_iterator lower_bound(const Key& key) const {
         return setImpl_.lower_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator lower_bound(const K& key) const {
+        return setImpl_.lower_bound(key);
+    }
+
     iterator upper_bound(const Key& key) {
         return setImpl_.upper_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) {
+        return setImpl_.upper_bound(key);
+    }
+
     iterator upper_bound(const Key& key) const {
         return setImpl_.upper_bound(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) const {
+        return setImpl_.upper_bound(key);
+    }
+
     std::pair<iterator, iterator> equal_range(const Key& key) {
         return setImpl_.equal_range(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return setImpl_.equal_range(key);
+    }
+
     std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
         return setImpl_.equal_range(key);
     }
 
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return setImpl_.equal_range(key);
+    }
+
+    // Order statistics, see SplayTree::nth() and SplayTree::rank().
+    iterator nth(size_type index) {
+        return setImpl_.nth(index);
+    }
+
+    const_iterator nth(size_type index) const {
+        return setImpl_.nth(index);
+    }
+
+    size_type rank(const Key& key) {
+        return setImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) {
+        return setImpl_.rank(key);
+    }
+
+    size_type rank(const Key& key) const {
+        return setImpl_.rank(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) const {
+        return setImpl_.rank(key);
+    }
+
+    // Set algebra in place, see SplayTree::unionWith(). An rvalue rhs gives
+    // up its nodes and is left empty.
+    void union_with(set&& rhs) {
+        setImpl_.unionWith(std::move(rhs.setImpl_));
+    }
+
+    void union_with(const set& rhs) {
+        setImpl_.unionWith(rhs.setImpl_);
+    }
+
+    void intersect_with(set&& rhs) {
+        setImpl_.intersectWith(std::move(rhs.setImpl_));
+    }
+
+    void intersect_with(const set& rhs) {
+        setImpl_.intersectWith(rhs.setImpl_);
+    }
+
+    void difference_with(set&& rhs) {
+        setImpl_.differenceWith(std::move(rhs.setImpl_));
+    }
+
+    void difference_with(const set& rhs) {
+        setImpl_.differenceWith(rhs.setImpl_);
+    }
+
+    // Batch lookups, see SplayTree::findBatch(). The results for the keys in
+    // [first, last) are written to out in the order of the keys.
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator find_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return setImpl_.findBatch(first, last, out);
+    }
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator count_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return setImpl_.countBatch(first, last, out);
+    }
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator contains_batch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+        return setImpl_.containsBatch(first, last, out);
+    }
+
 private:
+    friend class ParallelOperations;
+
+    explicit set(SetImpl&& impl) :
+        setImpl_(std::move(impl)) {
+    }
 
     SetImpl setImpl_;
 };
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator==(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ == rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator!=(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ != rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs == rhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator<(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ < rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return std::lexicographical_compare(
+        lhs.begin(),
+        lhs.end(),
+        rhs.begin(),
+        rhs.end());
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator>=(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ >= rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(lhs < rhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator>(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ > rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return rhs < lhs;
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline bool operator<=(
-        const set<Key, Compare, Allocator>& lhs,
-        const set<Key, Compare, Allocator>& rhs) {
-    return lhs.setImpl_ <= rhs.setImpl_;
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
+    return !(rhs < lhs);
 }
 
-template<typename Key, typename Compare, typename Allocator>
+template<
+    typename Key,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
 inline void swap(
-        set<Key, Compare, Allocator>& lhs,
-        set<Key, Compare, Allocator>& rhs) {
+        set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        set<Key, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
     lhs.swap(rhs);
 }
 
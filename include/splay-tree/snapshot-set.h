@@ -0,0 +1,288 @@
+#ifndef SPLAY_TREE_SNAPSHOT_SET_H_
+#define SPLAY_TREE_SNAPSHOT_SET_H_
+
+#include "set.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace splay_tree {
+
+// A set for read-mostly sharing between one writer and many reader threads.
+// The writer owns a splay tree, which it keeps splaying privately, and makes
+// its changes visible with publish(): that copies the working tree into an
+// immutable sorted snapshot, in linear time, and swaps it in atomically.
+//
+// Readers register once with make_reader() and then pin the latest snapshot
+// with acquire(). Lookups and iteration on a pinned view never restructure
+// anything and never wait: they are binary searches over immutable memory.
+// Pinning itself is lock-free, it retries only when a publication races
+// with it. Replaced snapshots are reclaimed by the writer once no reader has
+// them pinned, via hazard pointers: every reader announces the snapshot it
+// pins in its own slot.
+//
+// Writer methods must be called from one thread at a time. Readers must not
+// outlive the set.
+template <
+    typename Key,
+    typename Compare = std::less<Key>,
+    typename Allocator = std::allocator<Key>,
+    typename SplayPolicy = AlwaysSplay
+>
+class snapshot_set {
+private:
+    typedef typename Allocator::template rebind<Key>::other KeyAllocator;
+
+    typedef std::vector<Key, KeyAllocator> Snapshot;
+
+    struct ReaderSlot {
+        std::atomic<bool> claimed{false};
+        std::atomic<const Snapshot*> hazard{nullptr};
+        // Keeps slots of different readers off each other's cache line.
+        char padding[64];
+    };
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef Allocator allocator_type;
+    typedef size_t size_type;
+
+    // A pinned snapshot. It stays valid, and unchanged, until the view is
+    // destroyed, however often the writer publishes meanwhile.
+    class view {
+    public:
+        typedef typename Snapshot::const_iterator const_iterator;
+        typedef const_iterator iterator;
+
+        view(view&& rhs) noexcept :
+                snapshot_(rhs.snapshot_),
+                slot_(rhs.slot_),
+                comparator_(rhs.comparator_) {
+            rhs.slot_ = nullptr;
+        }
+
+        view(const view&) = delete;
+        view& operator=(const view&) = delete;
+
+        ~view() noexcept {
+            if (slot_) {
+                slot_->hazard.store(nullptr);
+            }
+        }
+
+        const_iterator begin() const noexcept {
+            return snapshot_->begin();
+        }
+
+        const_iterator end() const noexcept {
+            return snapshot_->end();
+        }
+
+        bool empty() const noexcept {
+            return snapshot_->empty();
+        }
+
+        size_type size() const noexcept {
+            return snapshot_->size();
+        }
+
+        const_iterator find(const Key& key) const {
+            const_iterator position = lower_bound(key);
+            if (position != end() && comparator_(key, *position)) {
+                return end();
+            }
+            return position;
+        }
+
+        bool contains(const Key& key) const {
+            return find(key) != end();
+        }
+
+        size_type count(const Key& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        const_iterator lower_bound(const Key& key) const {
+            return std::lower_bound(begin(), end(), key, comparator_);
+        }
+
+        const_iterator upper_bound(const Key& key) const {
+            return std::upper_bound(begin(), end(), key, comparator_);
+        }
+
+    private:
+        friend class snapshot_set;
+
+        view(const Snapshot* snapshot, ReaderSlot* slot, const Compare& comparator) :
+                snapshot_(snapshot),
+                slot_(slot),
+                comparator_(comparator) {
+        }
+
+        const Snapshot* snapshot_;
+        ReaderSlot* slot_;
+        Compare comparator_;
+    };
+
+    // A registered reader, to be used by one thread. It holds at most one
+    // view at a time.
+    class reader {
+    public:
+        reader(reader&& rhs) noexcept :
+                set_(rhs.set_),
+                slot_(rhs.slot_) {
+            rhs.slot_ = nullptr;
+        }
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        ~reader() noexcept {
+            if (slot_) {
+                assert(!slot_->hazard.load());
+                slot_->claimed.store(false);
+            }
+        }
+
+        view acquire() const {
+            assert(!slot_->hazard.load());
+            const Snapshot* snapshot = set_->published_.load();
+            for (;;) {
+                slot_->hazard.store(snapshot);
+                // The writer reclaims only snapshots that are unpublished
+                // and not announced, so announcing and then seeing the
+                // snapshot still published guarantees it stays alive.
+                const Snapshot* published = set_->published_.load();
+                if (published == snapshot) {
+                    return view(snapshot, slot_, set_->comparator_);
+                }
+                snapshot = published;
+            }
+        }
+
+    private:
+        friend class snapshot_set;
+
+        reader(const snapshot_set* set, ReaderSlot* slot) :
+                set_(set),
+                slot_(slot) {
+        }
+
+        const snapshot_set* set_;
+        ReaderSlot* slot_;
+    };
+
+    explicit snapshot_set(
+        size_type maxReaders = 64,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            comparator_(comparator),
+            allocator_(allocator),
+            working_(comparator, allocator),
+            maxReaders_(maxReaders),
+            slots_(new ReaderSlot[maxReaders]) {
+        published_.store(new Snapshot(allocator_));
+    }
+
+    snapshot_set(const snapshot_set&) = delete;
+    snapshot_set& operator=(const snapshot_set&) = delete;
+
+    ~snapshot_set() noexcept {
+        delete published_.load();
+        for (const Snapshot* snapshot : retired_) {
+            delete snapshot;
+        }
+    }
+
+    // Registers a reader. Throws std::length_error when maxReaders readers
+    // are registered already.
+    reader make_reader() const {
+        for (size_type i = 0; i < maxReaders_; ++i) {
+            bool claimed = false;
+            if (slots_[i].claimed.compare_exchange_strong(claimed, true)) {
+                return reader(this, &slots_[i]);
+            }
+        }
+        throw std::length_error("Too many readers of a snapshot_set.");
+    }
+
+    // Writer operations on the working tree. Changes become visible to
+    // readers with the next publish().
+    bool insert(const Key& key) {
+        return working_.insert(key).second;
+    }
+
+    bool insert(Key&& key) {
+        return working_.insert(std::move(key)).second;
+    }
+
+    size_type erase(const Key& key) {
+        return working_.erase(key);
+    }
+
+    bool contains(const Key& key) {
+        return working_.find(key) != working_.end();
+    }
+
+    size_type size() const noexcept {
+        return working_.size();
+    }
+
+    bool empty() const noexcept {
+        return working_.empty();
+    }
+
+    void clear() noexcept {
+        working_.clear();
+    }
+
+    // Publishes the working tree as the new snapshot and reclaims replaced
+    // snapshots no reader has pinned anymore.
+    void publish() {
+        std::unique_ptr<Snapshot> snapshot(
+            new Snapshot(working_.begin(), working_.end(), allocator_));
+        retired_.reserve(retired_.size() + 1);
+        retired_.push_back(published_.exchange(snapshot.release()));
+        reclaim();
+    }
+
+private:
+    void reclaim() noexcept {
+        auto isPinned = [this](const Snapshot* snapshot) {
+            for (size_type i = 0; i < maxReaders_; ++i) {
+                if (slots_[i].hazard.load() == snapshot) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        auto last = retired_.begin();
+        for (const Snapshot* snapshot : retired_) {
+            if (isPinned(snapshot)) {
+                *last++ = snapshot;
+            } else {
+                delete snapshot;
+            }
+        }
+        retired_.erase(last, retired_.end());
+    }
+
+    Compare comparator_;
+    KeyAllocator allocator_;
+    set<Key, Compare, Allocator, NullNodeUpdate, SplayPolicy> working_;
+    std::atomic<const Snapshot*> published_{nullptr};
+    // Replaced snapshots that were pinned when last checked.
+    std::vector<const Snapshot*> retired_;
+    size_type maxReaders_;
+    std::unique_ptr<ReaderSlot[]> slots_;
+};
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_SNAPSHOT_SET_H_
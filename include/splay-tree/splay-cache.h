@@ -0,0 +1,221 @@
+#ifndef SPLAY_TREE_SPLAY_CACHE_H_
+#define SPLAY_TREE_SPLAY_CACHE_H_
+
+#include "splay-tree.h"
+#include "key-of-value.h"
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace splay_tree {
+
+// A map holding at most capacity() elements. Every lookup and insertion
+// splays, so recently used keys stay near the root; inserting into a full
+// cache evicts the deepest element, which has gone unused the longest along
+// its path. That approximates least-recently-used eviction: the element used
+// last is never evicted, while unlike exact LRU an element can outlive one
+// used after it. Eviction is amortized O(log n).
+//
+// Each element costs the map node plus one word for its subtree height and,
+// unlike a hash map indexing a recency list, no further links.
+template <
+    typename Key,
+    typename T,
+    typename Compare = std::less<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, T>>
+>
+class splay_cache {
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key, T> value_type;
+    typedef Compare key_compare;
+    typedef Allocator allocator_type;
+
+private:
+    typedef typename Allocator::template rebind<value_type>::other ValueAllocator;
+
+    typedef SplayTree<
+        Key,
+        value_type,
+        Select1st,
+        Compare,
+        ValueAllocator,
+        SubtreeHeightNodeUpdate,
+        AlwaysSplay>
+        CacheImpl;
+
+public:
+    typedef typename CacheImpl::size_type size_type;
+    typedef typename CacheImpl::iterator iterator;
+    typedef typename CacheImpl::const_iterator const_iterator;
+
+    explicit splay_cache(
+        size_type capacity,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            cacheImpl_(comparator, ValueAllocator(allocator)),
+            capacity_(capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("A splay_cache needs a capacity of at least one.");
+        }
+    }
+
+    splay_cache(const splay_cache& rhs) = default;
+
+    splay_cache(splay_cache&& rhs) = default;
+
+    splay_cache& operator=(const splay_cache& rhs) = default;
+
+    splay_cache& operator=(splay_cache&& rhs) = default;
+
+    // Iteration visits the elements in key order and does not count as use.
+    iterator begin() noexcept {
+        return cacheImpl_.begin();
+    }
+
+    iterator end() noexcept {
+        return cacheImpl_.end();
+    }
+
+    const_iterator begin() const noexcept {
+        return cacheImpl_.cbegin();
+    }
+
+    const_iterator end() const noexcept {
+        return cacheImpl_.cend();
+    }
+
+    bool empty() const noexcept {
+        return cacheImpl_.empty();
+    }
+
+    size_type size() const noexcept {
+        return cacheImpl_.size();
+    }
+
+    size_type capacity() const noexcept {
+        return capacity_;
+    }
+
+    // Evicts elements until at most capacity remain.
+    void set_capacity(size_type capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("A splay_cache needs a capacity of at least one.");
+        }
+        capacity_ = capacity;
+        evictOverCapacity();
+    }
+
+    void clear() noexcept {
+        cacheImpl_.clear();
+    }
+
+    // Uses the element with the key, counting a hit, or counts a miss and
+    // returns end().
+    iterator find(const key_type& key) {
+        iterator it = cacheImpl_.find(key);
+        if (it != cacheImpl_.end()) {
+            ++hits_;
+        } else {
+            ++misses_;
+        }
+        return it;
+    }
+
+    // Inserts the value unless its key is present, in which case that
+    // element is used instead. Either way the element ends up at the root.
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return inserted(cacheImpl_.insertUnique(value));
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return inserted(cacheImpl_.insertUnique(std::move(value)));
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return inserted(cacheImpl_.emplaceUnique(std::forward<Args>(args)...));
+    }
+
+    // Inserts the mapped value under the key or assigns it to the element
+    // already there.
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& mapped) {
+        auto result = inserted(cacheImpl_.tryEmplaceUnique(
+            key, key, std::forward<M>(mapped)));
+        if (!result.second) {
+            result.first->second = std::forward<M>(mapped);
+        }
+        return result;
+    }
+
+    size_type erase(const key_type& key) {
+        return cacheImpl_.erase(key);
+    }
+
+    // Lookups by find() that found their key, lookups that did not, and
+    // elements evicted to make room since construction or the last reset.
+    size_type hits() const noexcept {
+        return hits_;
+    }
+
+    size_type misses() const noexcept {
+        return misses_;
+    }
+
+    size_type evictions() const noexcept {
+        return evictions_;
+    }
+
+    void reset_counters() noexcept {
+        hits_ = 0;
+        misses_ = 0;
+        evictions_ = 0;
+    }
+
+    void swap(splay_cache& rhs) noexcept(noexcept(
+            std::declval<CacheImpl&>().swap(std::declval<CacheImpl&>()))) {
+        cacheImpl_.swap(rhs.cacheImpl_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(hits_, rhs.hits_);
+        std::swap(misses_, rhs.misses_);
+        std::swap(evictions_, rhs.evictions_);
+    }
+
+private:
+    // The new element is the root, so as long as the cache holds more than
+    // one element it is never the deepest.
+    std::pair<iterator, bool> inserted(std::pair<iterator, bool> result) {
+        if (result.second) {
+            evictOverCapacity();
+        }
+        return result;
+    }
+
+    void evictOverCapacity() {
+        while (cacheImpl_.size() > capacity_) {
+            cacheImpl_.erase(cacheImpl_.deepest());
+            ++evictions_;
+        }
+    }
+
+    CacheImpl cacheImpl_;
+    size_type capacity_;
+    size_type hits_{0};
+    size_type misses_{0};
+    size_type evictions_{0};
+};
+
+template<typename Key, typename T, typename Compare, typename Allocator>
+void swap(
+        splay_cache<Key, T, Compare, Allocator>& lhs,
+        splay_cache<Key, T, Compare, Allocator>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+}
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_SPLAY_CACHE_H_
@@ -0,0 +1,120 @@
+#ifndef SPLAY_TREE_SPLAY_POLICY_H_
+#define SPLAY_TREE_SPLAY_POLICY_H_
+
+#include <type_traits>
+
+namespace splay_tree {
+
+// How far a node reached by an access is moved towards the root.
+enum class SplayDepth {
+    // Leave the tree as it is.
+    NONE,
+    // Semi-splay: every zig-zig step rotates only the parent, so the path to
+    // the node is roughly halved and the node ends up near, not at, the root.
+    SEMI,
+    // Splay the node to the root.
+    FULL
+};
+
+// A splay policy decides how the non-const lookups (find, count, bounds,
+// equal_range) and insertions restructure the tree, trading rotations against
+// adaptivity to the access pattern. onRead() is asked after every lookup and
+// onWrite() after every insertion. Erase, split and merge always splay, they
+// rely on it to restructure the tree. Const lookups never restructure.
+
+// Every access splays. This gives the usual amortized guarantees.
+struct AlwaysSplay {
+    SplayDepth onRead() noexcept {
+        return SplayDepth::FULL;
+    }
+
+    SplayDepth onWrite() noexcept {
+        return SplayDepth::FULL;
+    }
+};
+
+// Only insertions splay, lookups leave the tree untouched. Suits read-mostly
+// workloads without locality, where splaying on reads costs rotations without
+// paying off.
+struct SplayOnWrite {
+    SplayDepth onRead() noexcept {
+        return SplayDepth::NONE;
+    }
+
+    SplayDepth onWrite() noexcept {
+        return SplayDepth::FULL;
+    }
+};
+
+// Every access semi-splays, which needs about half the rotations of a full
+// splay while keeping frequently used nodes near the root.
+struct SemiSplay {
+    SplayDepth onRead() noexcept {
+        return SplayDepth::SEMI;
+    }
+
+    SplayDepth onWrite() noexcept {
+        return SplayDepth::SEMI;
+    }
+};
+
+// Only every Period-th access splays, in the spirit of randomized splaying
+// but deterministic, so that runs are reproducible.
+template<unsigned Period>
+class SplayEveryKth {
+    static_assert(Period > 0, "The splay period must be positive.");
+
+public:
+    SplayDepth onRead() noexcept {
+        return next();
+    }
+
+    SplayDepth onWrite() noexcept {
+        return next();
+    }
+
+private:
+    SplayDepth next() noexcept {
+        if (++accesses_ < Period) {
+            return SplayDepth::NONE;
+        }
+        accesses_ = 0;
+        return SplayDepth::FULL;
+    }
+
+    unsigned accesses_{0};
+};
+
+// Splays top-down (Sleator-Tarjan), during the descent itself: find,
+// lower_bound, upper_bound and insertions take a single pass from the root
+// instead of a descent followed by a climb back up through parent pointers.
+// The remaining operations splay bottom-up as with AlwaysSplay.
+struct TopDownSplay {
+    typedef std::true_type top_down;
+
+    SplayDepth onRead() noexcept {
+        return SplayDepth::FULL;
+    }
+
+    SplayDepth onWrite() noexcept {
+        return SplayDepth::FULL;
+    }
+};
+
+// A policy requests top-down splaying with a top_down typedef to
+// std::true_type.
+template<typename SplayPolicy, typename = void>
+struct IsTopDown : std::false_type {
+};
+
+template<typename SplayPolicy>
+struct IsTopDown<
+    SplayPolicy,
+    typename std::conditional<
+        true, void, typename SplayPolicy::top_down>::type> :
+    SplayPolicy::top_down {
+};
+
+} // namespace splay_tree
+
+#endif // SPLAY_TREE_SPLAY_POLICY_H_
@@ -1,21 +1,148 @@
 #ifndef SPLAY_TREE_SPLAY_TREE_H_
 #define SPLAY_TREE_SPLAY_TREE_H_
 
+#include "key-traits.h"
+#include "node-update.h"
+#include "splay-policy.h"
+
+#include <algorithm>
 #include <iterator>
 #include <type_traits>
 #include <cstddef>
 #include <cassert>
 #include <stdexcept>
 #include <memory>
+#include <new>
+#include <vector>
+
+// Define SPLAY_TREE_ENABLE_STATS to make every tree count the work done by
+// its splay operations. Without it the counters do not exist at all.
+#ifdef SPLAY_TREE_ENABLE_STATS
+#define SPLAY_TREE_COUNT(counter) (++stats_.counter)
+#define SPLAY_TREE_STATS(statement) statement
+#else
+#define SPLAY_TREE_COUNT(counter) ((void)0)
+#define SPLAY_TREE_STATS(statement)
+#endif
+
+// Define SPLAY_TREE_ENABLE_PREFETCH to make searches prefetch both children
+// of a node while its key is compared. With cheap keys this overlaps the miss
+// on the next level with the comparison, at the price of also loading the
+// child not taken.
+#if defined(SPLAY_TREE_ENABLE_PREFETCH) && defined(__GNUC__)
+#define SPLAY_TREE_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define SPLAY_TREE_PREFETCH(address) ((void)(address))
+#endif
+
+// Define SPLAY_TREE_DEBUG to give every tree validate(), which checks all of
+// its structural invariants in linear time.
 
 namespace splay_tree {
 
+// Tag selecting the constructors that build a tree from an already sorted
+// range in linear time.
+struct from_sorted_t {
+    explicit from_sorted_t() = default;
+};
+
+constexpr from_sorted_t from_sorted{};
+
+// True when Compare declares is_transparent, i.e. it compares keys with other
+// types, such as std::less<> does. K only makes the check depend on the type
+// looked up, so that it can be used for overload resolution.
+template<typename Compare, typename K, typename = void>
+struct IsTransparent : std::false_type {
+};
+
+template<typename Compare, typename K>
+struct IsTransparent<
+    Compare,
+    K,
+    typename std::conditional<
+        true, void, typename Compare::is_transparent>::type> :
+    std::true_type {
+};
+
+// Whether std::swap() of two objects can't throw. C++11 has no trait for it.
+template<typename T>
+struct IsNothrowSwappable :
+    std::integral_constant<
+        bool,
+        std::is_nothrow_move_constructible<T>::value &&
+            std::is_nothrow_move_assignable<T>::value> {
+};
+
+// Whether the allocator can set aside room for a number of objects up front,
+// as pool_allocator::reserve() does.
+template<typename Allocator, typename = void>
+struct HasReserve : std::false_type {
+};
+
+template<typename Allocator>
+struct HasReserve<
+    Allocator,
+    typename std::conditional<
+        true,
+        void,
+        decltype(std::declval<Allocator&>().reserve(size_t()))>::type> :
+    std::true_type {
+};
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+struct SplayTreeStats {
+    // Bucket i of the depth histogram counts the accesses at a depth d with
+    // 2^i <= d + 1 < 2^(i + 1), the last bucket also all deeper ones.
+    enum {
+        DEPTH_BUCKETS = 32
+    };
+
+    void recordAccess(size_t depth) noexcept {
+        ++accesses;
+        accessDepth += depth;
+        if (depth > maxDepth) {
+            maxDepth = depth;
+        }
+        size_t bucket = 0;
+        while (bucket + 1 < DEPTH_BUCKETS && (depth + 1) >> (bucket + 1)) {
+            ++bucket;
+        }
+        ++depthHistogram[bucket];
+    }
+
+    size_t splays{0};
+    size_t zigSteps{0};
+    size_t zigZigSteps{0};
+    size_t zigZagSteps{0};
+    size_t rotations{0};
+    // Calls into the comparator, by all operations.
+    size_t comparisons{0};
+    // Nodes reached by a restructuring access, with their depth before it.
+    size_t accesses{0};
+    size_t accessDepth{0};
+    size_t maxDepth{0};
+    size_t depthHistogram[DEPTH_BUCKETS]{};
+};
+#endif
+
+// The result of inserting a node handle into a container with unique keys:
+// the position of the element with its key, and the handle back when that
+// key was already present.
+template<typename Iterator, typename NodeType>
+struct InsertReturnType {
+    Iterator position;
+    bool inserted;
+    NodeType node;
+};
+
 template <
     typename Key,
     typename Value,
     typename KeyOfValue,
     typename Compare = std::less<Key>,
-    typename Allocator = std::allocator<Value>
+    typename Allocator = std::allocator<Value>,
+    typename NodeUpdate = NullNodeUpdate,
+    typename SplayPolicy = AlwaysSplay
 >
 class SplayTree {
 public:
@@ -30,15 +157,38 @@ public:
     typedef Allocator allocator_type;
 
 private:
+    template<typename K>
+    using EnableIfTransparent =
+        typename std::enable_if<IsTransparent<Compare, K>::value>::type;
+
+    struct HeaderTag {
+    };
+
+    typedef typename KeyTraitsOf<Compare>::type KeyTraits;
+
     // TODO Split this struct into a non-template base class and a derived class
     //      with a field containing the value.
-    struct SplayTreeNode {
+    // Deriving from the metadata and the key prefix lets empty ones take no
+    // space.
+    struct SplayTreeNode : NodeUpdate::Metadata, KeyPrefix<KeyTraits> {
         template<typename... Args>
         SplayTreeNode(Args&&... args) :
             value(std::forward<Args>(args)...) {
+            this->storePrefix(KeyOfValue()(value));
+        }
+
+        // The header has no value. It marks itself with its right child.
+        explicit SplayTreeNode(HeaderTag) :
+            rightChild(this) {
+        }
+
+        // The value is destroyed by destroyNode(), the header has none.
+        ~SplayTreeNode() {
         }
 
-        value_type value;
+        union {
+            value_type value;
+        };
         SplayTreeNode* parent{nullptr};
         SplayTreeNode* leftChild{nullptr};
         SplayTreeNode* rightChild{nullptr};
@@ -48,16 +198,18 @@ private:
         typename Allocator::template rebind<SplayTreeNode>::other
         NodeAllocator;
 
+    typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
     template<typename... Args>
     SplayTreeNode* createNode(Args&&... args) {
-        auto newNode = nodeAllocator_.allocate(1);
+        auto newNode = NodeAllocatorTraits::allocate(nodeAllocator_, 1);
         try {
-            std::allocator_traits<NodeAllocator>::construct(
+            NodeAllocatorTraits::construct(
                 nodeAllocator_,
                 newNode,
                 std::forward<Args>(args)...);
         } catch (...) {
-            nodeAllocator_.deallocate(newNode, 1);
+            NodeAllocatorTraits::deallocate(nodeAllocator_, newNode, 1);
             throw;
         }
 
@@ -65,15 +217,22 @@ private:
     }
 
     void destroyNode(SplayTreeNode* node) {
-        nodeAllocator_.destroy(node);
-        nodeAllocator_.deallocate(node, 1);
+        node->value.~value_type();
+        NodeAllocatorTraits::destroy(nodeAllocator_, node);
+        NodeAllocatorTraits::deallocate(nodeAllocator_, node, 1);
     }
 
     // Non-recursive implementation, because the height of the splay tree is not
-    // guaranteed to be O(log(n)) in the worst case.
-    void destroyTree(SplayTreeNode* root) noexcept {
+    // guaranteed to be O(log(n)) in the worst case. The subtree is unlinked
+    // from its parent, if any. Returns the number of destroyed nodes.
+    size_type destroyTree(SplayTreeNode* root) noexcept {
+        size_type destroyedNodes = 0;
+        if (!root) {
+            return destroyedNodes;
+        }
+        SplayTreeNode* const top = root->parent;
         auto currentNode = root;
-        while (currentNode) {
+        while (currentNode != top) {
             if (currentNode->leftChild) {
                 currentNode = currentNode->leftChild;
                 continue;
@@ -91,45 +250,179 @@ private:
                 }
             }
             destroyNode(currentNode);
+            ++destroyedNodes;
             currentNode = parent;
         }
+        return destroyedNodes;
     }
 
-    SplayTreeNode* copyTree(SplayTreeNode* root) {
-        SplayTreeNode* rootCopy;
-        try {
-            rootCopy = createNode(root->value);
-            if (root->leftChild) {
-                rootCopy->leftChild = copyTree(root->leftChild);
-                rootCopy->leftChild->parent = rootCopy;
+    // Nodes created from sorted input are first linked into a chain through
+    // their right children and then rebuilt into a balanced tree.
+    struct SortedChain {
+        SplayTreeNode* head{nullptr};
+        SplayTreeNode* tail{nullptr};
+        size_type length{0};
+    };
+
+    static void appendToChain(SortedChain& chain, SplayTreeNode* node) noexcept {
+        if (chain.tail) {
+            chain.tail->rightChild = node;
+            node->parent = chain.tail;
+        } else {
+            chain.head = node;
+        }
+        chain.tail = node;
+        ++chain.length;
+    }
+
+    // Consumes the first size nodes of the chain in order. The recursion depth
+    // is log2(size), since the resulting tree is balanced.
+    static SplayTreeNode* buildBalancedTree(
+            SplayTreeNode*& chain,
+            size_type size) noexcept {
+        if (size == 0) {
+            return nullptr;
+        }
+        const size_type leftSize = (size - 1) / 2;
+        SplayTreeNode* leftChild = buildBalancedTree(chain, leftSize);
+        SplayTreeNode* node = chain;
+        chain = chain->rightChild;
+
+        node->parent = nullptr;
+        node->leftChild = leftChild;
+        if (leftChild) {
+            leftChild->parent = node;
+        }
+        node->rightChild = buildBalancedTree(chain, size - 1 - leftSize);
+        if (node->rightChild) {
+            node->rightChild->parent = node;
+        }
+        NodeUpdate::update(*node);
+        return node;
+    }
+
+    // Straightens the tree into a chain through the right children by right
+    // rotations, in place. Only the right links of the chain are meaningful.
+    static SplayTreeNode* flattenToChain(SplayTreeNode* root) noexcept {
+        SplayTreeNode* head = root;
+        SplayTreeNode** link = &head;
+        SplayTreeNode* rest = root;
+        while (rest) {
+            if (rest->leftChild) {
+                SplayTreeNode* leftChild = rest->leftChild;
+                rest->leftChild = leftChild->rightChild;
+                leftChild->rightChild = rest;
+                rest = leftChild;
+                *link = leftChild;
+            } else {
+                link = &rest->rightChild;
+                rest = rest->rightChild;
             }
-            if (root->rightChild) {
-                rootCopy->rightChild = copyTree(root->rightChild);
-                rootCopy->rightChild->parent = rootCopy;
+        }
+        return head;
+    }
+
+    // Copies the subtree of size nodes, which may have a parent, into a
+    // balanced tree. The source is copied as it is, in preorder with an
+    // explicit stack, which reads it faster than an in-order walk would, and
+    // the copy is then rebuilt; the recursion depth is log2(size) however
+    // deep the source is.
+    SplayTreeNode* copyTree(SplayTreeNode* root, size_type size) {
+        SplayTreeNode* rootCopy = createNode(root->value);
+        try {
+            std::vector<std::pair<SplayTreeNode*, SplayTreeNode*>> pending;
+            pending.emplace_back(root, rootCopy);
+            while (!pending.empty()) {
+                SplayTreeNode* node = pending.back().first;
+                SplayTreeNode* nodeCopy = pending.back().second;
+                pending.pop_back();
+                if (node->rightChild) {
+                    nodeCopy->rightChild = createNode(node->rightChild->value);
+                    nodeCopy->rightChild->parent = nodeCopy;
+                    pending.emplace_back(node->rightChild, nodeCopy->rightChild);
+                }
+                if (node->leftChild) {
+                    nodeCopy->leftChild = createNode(node->leftChild->value);
+                    nodeCopy->leftChild->parent = nodeCopy;
+                    pending.emplace_back(node->leftChild, nodeCopy->leftChild);
+                }
             }
-            return rootCopy;
         } catch (...) {
             destroyTree(rootCopy);
             throw;
         }
+
+        SplayTreeNode* chain = flattenToChain(rootCopy);
+        return buildBalancedTree(chain, size);
+    }
+
+    // Lets an allocator that supports it lay out the next nodes in one block.
+    void reserveNodes(size_type count, std::true_type) {
+        nodeAllocator_.reserve(count);
     }
 
+    void reserveNodes(size_type, std::false_type) noexcept {
+    }
+
+    // Attaches the chain, whose keys must not precede the keys of the tree, to
+    // the right of the tree.
+    void attachChain(SortedChain& chain) noexcept;
+
+    // Inserts the longest prefix of the range that is sorted and follows the
+    // current maximum in O(1) per element, then returns the first element
+    // that breaks the order.
+    template<bool IsUnique, typename InputIterator>
+    InputIterator insertSortedPrefix(InputIterator first, InputIterator last);
+
     SplayTreeNode* getLeftMostNode() {
-        if (!root_) {
+        if (!root()) {
             return nullptr;
         }
-        auto currentNode = root_;
+        auto currentNode = root();
         while (currentNode->leftChild) {
             currentNode = currentNode->leftChild;
         }
         return currentNode;
     }
 
+    // Size of a subtree. Constant time when subtree sizes are tracked, linear
+    // otherwise.
+    static size_type countNodes(SplayTreeNode* root, std::true_type) noexcept {
+        return root ? root->subtreeSize : 0;
+    }
+
+    static size_type countNodes(SplayTreeNode* root, std::false_type) noexcept {
+        size_type count = 0;
+        auto countNode = [&count](const value_type&) {
+            ++count;
+        };
+        forEachInSubtree(root, countNode);
+        return count;
+    }
+
+    static SplayTreeNode* leftMostNodeOf(SplayTreeNode* root) noexcept {
+        if (root) {
+            while (root->leftChild) {
+                root = root->leftChild;
+            }
+        }
+        return root;
+    }
+
+    static SplayTreeNode* rightMostNodeOf(SplayTreeNode* root) noexcept {
+        if (root) {
+            while (root->rightChild) {
+                root = root->rightChild;
+            }
+        }
+        return root;
+    }
+
     SplayTreeNode* getRightMostNode() {
-        if (!root_) {
+        if (!root()) {
             return nullptr;
         }
-        auto currentNode = root_;
+        auto currentNode = root();
         while (currentNode->rightChild) {
             currentNode = currentNode->rightChild;
         }
@@ -139,30 +432,28 @@ private:
     template<bool IsConstIterator>
     class SplayTreeIterator {
     public:
-        typedef key_type value_type;
+        typedef Value value_type;
         typedef
             typename std::conditional<
                 IsConstIterator,
-                const key_type&,
-                key_type&>::type
-            reference; 
+                const value_type&,
+                value_type&>::type
+            reference;
         typedef
             typename std::conditional<
                 IsConstIterator,
-                const key_type*,
-                key_type*>::type
+                const value_type*,
+                value_type*>::type
             pointer;
         typedef ptrdiff_t difference_type;
         typedef std::bidirectional_iterator_tag iterator_category;
 
-        SplayTreeIterator(SplayTreeNode* node, SplayTreeNode* root) :
-            node_(node),
-            root_(root) {
+        explicit SplayTreeIterator(SplayTreeNode* node) :
+            node_(node) {
         }
 
         SplayTreeIterator(const SplayTreeIterator<false>& rhs) :
-            node_(rhs.node_),
-            root_(rhs.root_) {
+            node_(rhs.node_) {
         }
 
         bool operator==(const SplayTreeIterator& rhs) const {
@@ -185,7 +476,7 @@ private:
 
         SplayTreeIterator operator--(int) {
             const SplayTreeIterator old(*this);
-            ++(*this);
+            --(*this);
             return old;
         }
 
@@ -201,16 +492,104 @@ private:
         friend class SplayTree;
 
     private:
+        // The node, or the header of the tree for end().
         SplayTreeNode* node_;
-        // TODO Remove the root_ field. This can be done if the end() iterator
-        //      holds an auxiliary node containing special info, not nullptr.
-        SplayTreeNode* root_;
+    };
+
+    // Owns a node unlinked by extract() until it is inserted into a tree
+    // with an equal allocator. An empty handle holds no allocator either.
+    class NodeHandle {
+    public:
+        typedef Value value_type;
+        typedef Allocator allocator_type;
+
+        NodeHandle() noexcept {
+        }
+
+        NodeHandle(NodeHandle&& rhs) noexcept {
+            takeNodeOf(rhs);
+        }
+
+        NodeHandle& operator=(NodeHandle&& rhs) noexcept {
+            if (this != &rhs) {
+                reset();
+                takeNodeOf(rhs);
+            }
+            return *this;
+        }
+
+        ~NodeHandle() noexcept {
+            reset();
+        }
+
+        bool empty() const noexcept {
+            return !node_;
+        }
+
+        explicit operator bool() const noexcept {
+            return node_ != nullptr;
+        }
+
+        value_type& value() const noexcept {
+            return node_->value;
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(nodeAllocator_);
+        }
+
+        void swap(NodeHandle& rhs) noexcept {
+            NodeHandle temp(std::move(rhs));
+            rhs = std::move(*this);
+            *this = std::move(temp);
+        }
+
+    private:
+        friend class SplayTree;
+
+        NodeHandle(SplayTreeNode* node, const NodeAllocator& nodeAllocator) :
+                node_(node) {
+            new (&nodeAllocator_) NodeAllocator(nodeAllocator);
+        }
+
+        // Gives up the node, which is linked into a tree.
+        SplayTreeNode* release() noexcept {
+            SplayTreeNode* const node = node_;
+            nodeAllocator_.~NodeAllocator();
+            node_ = nullptr;
+            return node;
+        }
+
+        void takeNodeOf(NodeHandle& rhs) noexcept {
+            if (rhs.node_) {
+                new (&nodeAllocator_) NodeAllocator(std::move(rhs.nodeAllocator_));
+                node_ = rhs.release();
+            }
+        }
+
+        void reset() noexcept {
+            if (node_) {
+                node_->value.~value_type();
+                NodeAllocatorTraits::destroy(nodeAllocator_, node_);
+                NodeAllocatorTraits::deallocate(nodeAllocator_, node_, 1);
+                release();
+            }
+        }
+
+        SplayTreeNode* node_{nullptr};
+        // Constructed only while the handle owns a node.
+        union {
+            NodeAllocator nodeAllocator_;
+        };
     };
 
 public:
     typedef SplayTreeIterator<false> iterator;
     typedef SplayTreeIterator<true> const_iterator;
 
+    typedef NodeHandle node_type;
+    typedef InsertReturnType<iterator, node_type> insert_return_type;
+
     typedef std::reverse_iterator<iterator> reverse_iterator;
     typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
@@ -225,61 +604,107 @@ public:
             nodeAllocator_(allocator) {
     }
 
+    // The range must be sorted with respect to the comparator, strictly so
+    // when the tree is used with unique keys. Builds a balanced tree in linear
+    // time without comparing keys.
+    template<typename InputIterator>
+    SplayTree(
+        from_sorted_t,
+        InputIterator first,
+        InputIterator last,
+        const Compare& comparator = Compare(),
+        const Allocator& allocator = Allocator()) :
+            comparator_(comparator),
+            nodeAllocator_(allocator) {
+        SortedChain chain;
+        try {
+            for (; first != last; ++first) {
+                appendToChain(chain, createNode(*first));
+            }
+        } catch (...) {
+            destroyTree(chain.head);
+            throw;
+        }
+        attachChain(chain);
+    }
+
     SplayTree(const SplayTree& rhs) :
-        root_(copyTree(rhs.root_)),
-        leftMostNode_(getLeftMostNode()),
-        rightMostNode_(getRightMostNode()),
-        numberOfNodes_(rhs.numberOfNodes_),
-        comparator_(rhs.comparator_),
-        nodeAllocator_(rhs.nodeAllocator_) {
+            comparator_(rhs.comparator_),
+            splayPolicy_(rhs.splayPolicy_),
+            nodeAllocator_(
+                NodeAllocatorTraits::select_on_container_copy_construction(
+                    rhs.nodeAllocator_)) {
+        if (rhs.root()) {
+            numberOfNodes_ = rhs.size();
+            reserveNodes(numberOfNodes_, HasReserve<NodeAllocator>());
+            setRoot(copyTree(rhs.root(), numberOfNodes_));
+            leftMostNode_ = getLeftMostNode();
+            header_.parent = getRightMostNode();
+        }
     }
 
 private:
     SplayTree(
         SplayTreeNode* root,
+        SplayTreeNode* leftMostNode,
+        SplayTreeNode* rightMostNode,
+        size_type numberOfNodes,
         const Compare& comparator,
         const NodeAllocator& nodeAllocator) :
-            root_(root),
-            leftMostNode_(getLeftMostNode()),
-            rightMostNode_(getRightMostNode()),
-            numberOfNodes_(std::distance(cbegin(), cend())),
+            leftMostNode_(leftMostNode),
+            numberOfNodes_(numberOfNodes),
             comparator_(comparator),
             nodeAllocator_(nodeAllocator) {
+        setRoot(root);
+        header_.parent = rightMostNode;
     }
 
 public:
 
-    // TODO Make noexcept.
-    // TODO What if default constuctors of Compare and Allocator are time
-    //      consuming?
-    SplayTree(SplayTree&& rhs) :
-            SplayTree() {
-        swap(rhs);
+    // Steals the nodes, the comparator and the allocator of rhs, which is left
+    // empty.
+    SplayTree(SplayTree&& rhs) noexcept(
+            std::is_nothrow_move_constructible<Compare>::value &&
+            std::is_nothrow_move_constructible<SplayPolicy>::value) :
+            comparator_(std::move(rhs.comparator_)),
+            splayPolicy_(std::move(rhs.splayPolicy_)),
+            nodeAllocator_(std::move(rhs.nodeAllocator_)) {
+        takeNodesOf(rhs);
     }
 
+    // The copy is moved in, so the allocator follows the same rules as for a
+    // move assignment.
     SplayTree& operator=(const SplayTree& rhs) {
-        SplayTree temp(rhs);
-        swap(temp);
+        if (this != &rhs) {
+            *this = SplayTree(rhs);
+        }
         return *this;
     }
 
-    // TODO Make noexcept.
-    SplayTree& operator=(SplayTree&& rhs) {
-        clear();
-        swap(rhs);
+    // Constant time, unless the allocator doesn't propagate and differs from
+    // the one of rhs: then the values are moved into new nodes.
+    SplayTree& operator=(SplayTree&& rhs) noexcept(
+            NodeAllocatorTraits::propagate_on_container_move_assignment::value &&
+            std::is_nothrow_move_assignable<Compare>::value &&
+            std::is_nothrow_move_assignable<SplayPolicy>::value) {
+        if (this != &rhs) {
+            moveAssign(
+                rhs,
+                typename NodeAllocatorTraits::propagate_on_container_move_assignment());
+        }
         return *this;
     }
 
     ~SplayTree() noexcept {
-        destroyTree(root_);
+        destroyTree(root());
     }
 
     iterator begin() noexcept {
-        return iterator(leftMostNode_, root_);
+        return iteratorOf(leftMostNode_);
     }
 
     const_iterator begin() const noexcept {
-        return const_iterator(leftMostNode_, root_);
+        return iteratorOf(leftMostNode_);
     }
 
     const_iterator cbegin() const noexcept {
@@ -287,11 +712,11 @@ public:
     }
     
     iterator end() noexcept {
-        return {nullptr, root_};
+        return iterator(header());
     }
 
     const_iterator end() const noexcept {
-        return {nullptr, root_};
+        return const_iterator(header());
     }
 
     const_iterator cend() const noexcept {
@@ -323,7 +748,7 @@ public:
     }
 
     bool empty() const noexcept {
-        return !root_;
+        return !root();
     }
 
     size_type size() const noexcept {
@@ -331,26 +756,55 @@ public:
     }
 
     size_type max_size() const noexcept {
-        return nodeAllocator_.max_size();
+        return NodeAllocatorTraits::max_size(nodeAllocator_);
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(nodeAllocator_);
+    }
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+    const SplayTreeStats& stats() const noexcept {
+        return stats_;
     }
 
-    // TODO Make noexcept.
-    void swap(SplayTree& rhs) {
+    void resetStats() noexcept {
+        stats_ = SplayTreeStats();
+    }
+#endif
+
+#ifdef SPLAY_TREE_DEBUG
+    // Throws std::logic_error naming the first broken invariant: the links
+    // between parents and children, the order of the keys, the cached
+    // extremes and size, the metadata of subtree sizes and heights and the
+    // stored key prefixes.
+    void validate() const;
+#endif
+
+    // The allocators are swapped only if they propagate on swap, otherwise
+    // they must be equal.
+    void swap(SplayTree& rhs) noexcept(
+            IsNothrowSwappable<Compare>::value &&
+            IsNothrowSwappable<SplayPolicy>::value) {
         using std::swap;
-        swap(root_, rhs.root_);
+        // The headers stay in place, only their links are exchanged.
+        SplayTreeNode* const root = this->root();
+        setRoot(rhs.root());
+        rhs.setRoot(root);
         swap(leftMostNode_, rhs.leftMostNode_);
-        swap(rightMostNode_, rhs.rightMostNode_);
+        swap(header_.parent, rhs.header_.parent);
         swap(numberOfNodes_, rhs.numberOfNodes_);
         swap(comparator_, rhs.comparator_);
-        // TODO Check if everything is ok with swapping allocators.
-        swap(nodeAllocator_, rhs.nodeAllocator_);
+        swap(splayPolicy_, rhs.splayPolicy_);
+        swapAllocators(
+            rhs,
+            typename NodeAllocatorTraits::propagate_on_container_swap());
     }
 
     void clear() noexcept {
-        destroyTree(root_);
-        root_ = nullptr;
+        destroyTree(root());
         leftMostNode_ = nullptr;
-        rightMostNode_ = nullptr;
+        header_.parent = nullptr;
         numberOfNodes_ = 0;
     }
 
@@ -358,8 +812,11 @@ public:
     template<typename Arg>
     std::pair<iterator, bool> insertUnique(Arg&& value);
 
+    // Sorted input that follows the current maximum takes a linear-time path
+    // with no splaying.
     template<typename InputIterator>
     void insertUnique(InputIterator first, InputIterator last) {
+        first = insertSortedPrefix<true>(first, last);
         for (; first != last; ++first) {
             insertUnique(*first);
         }
@@ -370,6 +827,7 @@ public:
 
     template<typename InputIterator>
     void insertEqual(InputIterator first, InputIterator last) {
+        first = insertSortedPrefix<false>(first, last);
         for (; first != last; ++first) {
             insertEqual(*first);
         }
@@ -381,9 +839,30 @@ public:
     template<typename... Args>
     iterator emplaceEqual(Args&&... args);
 
+    // Constructs a value from args and inserts it only if no element has the
+    // given key, which must be the key of the constructed value. Unlike
+    // emplaceUnique(), nothing is allocated when the key is present.
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplaceUnique(const K& key, Args&&... args);
+
+    // Hinted insertions. A value that belongs directly before hint (or after
+    // the maximum when hint is end()) is linked there without a descent from
+    // the root, otherwise the hint is ignored.
+    template<typename Arg>
+    iterator insertUniqueWithHint(const_iterator hint, Arg&& value);
+
+    template<typename Arg>
+    iterator insertEqualWithHint(const_iterator hint, Arg&& value);
+
+    template<typename... Args>
+    iterator emplaceUniqueWithHint(const_iterator hint, Args&&... args);
+
+    template<typename... Args>
+    iterator emplaceEqualWithHint(const_iterator hint, Args&&... args);
+
     iterator erase(const_iterator position) {
         SplayTreeNode* node = position.node_;
-        iterator result(node, root_);
+        iterator result(node);
         ++result;
         innerErase(node);
         return result;
@@ -396,47 +875,103 @@ public:
         return result;
     }
 
-    // TODO Remove code dupcliation.
+    // A range longer than a few nodes is cut out with two splits and a join,
+    // and its nodes are destroyed in one pass: amortized logarithmic plus
+    // linear in the number of erased elements.
     iterator erase(const_iterator first, const_iterator last) {
-        while (first != last) {
-            first = erase(first);
-        }
-        return first;
+        return iteratorOf(innerEraseRange(
+            nullIfHeader(first.node_), nullIfHeader(last.node_)));
     }
 
     iterator erase(iterator first, iterator last) {
-        while (first != last) {
-            first = erase(first);
-        }
-        return first;
+        return iteratorOf(innerEraseRange(
+            nullIfHeader(first.node_), nullIfHeader(last.node_)));
     }
 
     size_type erase(const Key& key) {
-        auto range = equal_range(key);
-        const size_type oldSize = size();
-        erase(range.first, range.second);
-        return oldSize - size();
+        return eraseEqual(key);
+    }
+
+    template<
+        typename K,
+        typename = EnableIfTransparent<K>,
+        typename = typename std::enable_if<
+            !std::is_convertible<K, const_iterator>::value>::type
+    >
+    size_type erase(const K& key) {
+        return eraseEqual(key);
+    }
+
+    // Node handles. extract() unlinks an element without destroying it, the
+    // insertion of its handle relinks the node, also into another tree, with
+    // neither an allocation nor a move of the value.
+    node_type extract(const_iterator position) {
+        SplayTreeNode* node = position.node_;
+        unlinkNode(node);
+        return node_type(node, nodeAllocator_);
+    }
+
+    node_type extract(const Key& key) {
+        const const_iterator position = find(key);
+        return position == cend() ? node_type() : extract(position);
+    }
+
+    insert_return_type insertUnique(node_type&& node);
+
+    iterator insertEqual(node_type&& node);
+
+    // Moves the elements of source into this tree by relinking their nodes.
+    // Unlike for mergeUnique() the key ranges may overlap: spliceUnique()
+    // leaves the elements whose keys this tree has in source. The allocators
+    // must be equal.
+    void spliceUnique(SplayTree& source) {
+        innerSplice<true>(source);
+    }
+
+    void spliceEqual(SplayTree& source) {
+        innerSplice<false>(source);
     }
 
     // Split/merge operations.
-    // TODO Implement split.
+    // Split moves the elements starting from the position to the returned
+    // tree. It takes amortized logarithmic time only with
+    // SubtreeSizeNodeUpdate. Without subtree sizes, as with the default
+    // NullNodeUpdate, the smaller part is counted to keep size() exact, so a
+    // split near the middle of a tree of n elements takes time linear in n.
+    // Use SubtreeSizeNodeUpdate when large trees must split in logarithmic
+    // time.
     SplayTree split(iterator position) {
-        return innerSplit(position.node_);
+        return innerSplit(nullIfHeader(position.node_));
     }
 
     SplayTree split(const_iterator position) {
-        return innerSplit(position.node_);
+        return innerSplit(nullIfHeader(position.node_));
     }
 
     SplayTree split(const Key& key) {
         auto node = innerLowerBound(key);
-        if (!node || KeyOfValue()(node->value) != key) {
+        if (!node || !keysAreEqual(KeyOfValue()(node->value), key)) {
             throw std::runtime_error(
                 "Requested split with a key that is not present in the tree.");
         }
         return innerSplit(node);
     }
 
+    // Moves the elements with keys in [lowerKey, upperKey) to the returned
+    // tree. Sizes are counted as by split(): this takes amortized logarithmic
+    // time with SubtreeSizeNodeUpdate, otherwise also time linear in the
+    // smaller of the range and the rest.
+    SplayTree extractRange(const Key& lowerKey, const Key& upperKey) {
+        SplayTreeNode* first = innerLowerBound(lowerKey);
+        SplayTreeNode* last =
+            compare(upperKey, lowerKey) ? first : innerLowerBound(upperKey);
+        SplayTree range = detachRange(first, last);
+        if (range.root()) {
+            splitSizes(range, TracksSubtreeSize<NodeUpdate>());
+        }
+        return range;
+    }
+
     // Merge assumes that the tree given as a parameter has its minimum key
     // greater than the maximum key in the current tree (or greater or equal in
     // case of mergeEqual).
@@ -454,143 +989,808 @@ public:
         mergeEqual(std::move(temp));
     }
 
+    // Set algebra. The result replaces the contents of this tree and rhs is
+    // left empty; the nodes of the result are taken from both trees, the
+    // remaining ones are destroyed, nothing is allocated. Equal keys are
+    // paired off one by one, so with duplicates the result holds the greater
+    // (union), the smaller (intersection) or the difference of the two counts,
+    // as with std::set_union() and friends; elements of this tree are kept in
+    // preference to equal elements of rhs. The trees are cut into the runs
+    // that alternate between them by split and merge at the key where the
+    // other tree takes over, so the work follows the number of alternations
+    // rather than the size: about O(m log(n / m + 1)) amortized for sizes
+    // m <= n. If the comparator throws, both trees are left empty.
+    void unionWith(SplayTree&& rhs) {
+        combine<true, true, true>(std::move(rhs));
+    }
+
+    void unionWith(const SplayTree& rhs) {
+        auto temp = rhs;
+        unionWith(std::move(temp));
+    }
+
+    void intersectWith(SplayTree&& rhs) {
+        combine<false, false, true>(std::move(rhs));
+    }
+
+    void intersectWith(const SplayTree& rhs) {
+        auto temp = rhs;
+        intersectWith(std::move(temp));
+    }
+
+    void differenceWith(SplayTree&& rhs) {
+        combine<true, false, false>(std::move(rhs));
+    }
+
+    void differenceWith(const SplayTree& rhs) {
+        auto temp = rhs;
+        differenceWith(std::move(temp));
+    }
+
     // Find operations.
+    // The non-const lookups restructure the tree as the splay policy requests
+    // for reads. Unsuccessful lookups adjust the last node on the search path.
+    // With a transparent comparator the lookups also take any type comparable
+    // with the keys, so that no temporary Key has to be constructed.
     iterator find(const Key& key) {
-        auto node = innerFind(key);
-        if (node) {
-            node = splay(node);
-        }
-        return {node, root_};
+        return iteratorOf(accessFind(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator find(const K& key) {
+        return iteratorOf(accessFind(key));
     }
 
     const_iterator find(const Key& key) const {
-        return {innerFind(key), root_};
+        return iteratorOf(innerFind(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator find(const K& key) const {
+        return iteratorOf(innerFind(key));
+    }
+
+    size_type count(const Key& key) {
+        return accessCount(key);
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) {
+        return accessCount(key);
     }
 
-    size_type count(const Key& key);
+    size_type count(const Key& key) const {
+        return innerCount(key);
+    }
 
-    size_type count(const Key& key) const;
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type count(const K& key) const {
+        return innerCount(key);
+    }
 
     iterator lower_bound(const Key& key) {
-        return {innerLowerBound(key), root_};
+        return iteratorOf(accessLowerBound(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator lower_bound(const K& key) {
+        return iteratorOf(accessLowerBound(key));
     }
 
     const_iterator lower_bound(const Key& key) const {
-        return {innerLowerBound(key), root_};
+        return iteratorOf(innerLowerBound(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator lower_bound(const K& key) const {
+        return iteratorOf(innerLowerBound(key));
     }
 
     iterator upper_bound(const Key& key) {
-        return {innerUpperBound(key), root_};
+        return iteratorOf(accessUpperBound(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    iterator upper_bound(const K& key) {
+        return iteratorOf(accessUpperBound(key));
     }
 
     const_iterator upper_bound(const Key& key) const {
-        return {innerUpperBound(key), root_};
+        return iteratorOf(innerUpperBound(key));
+    }
+
+    template<typename K, typename = EnableIfTransparent<K>>
+    const_iterator upper_bound(const K& key) const {
+        return iteratorOf(innerUpperBound(key));
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        return accessEqualRange(key);
     }
 
-    std::pair<iterator, iterator> equal_range(const Key& key);
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return accessEqualRange(key);
+    }
 
     std::pair<const_iterator, const_iterator>
-    equal_range(const Key& key) const;
+    equal_range(const Key& key) const {
+        const EqualRange range = innerEqualRange(key);
+        return {iteratorOf(range.lowerBound), iteratorOf(range.upperBound)};
+    }
 
-private:
-    // Splay and rotations.
-    // TODO When SplayTreeNode struct is appropriately split, following
-    //      methods will no longer depend on keys, values and template
-    //      parameters and should be moved from here.
-    SplayTreeNode* splay(SplayTreeNode* node);
+    template<typename K, typename = EnableIfTransparent<K>>
+    std::pair<const_iterator, const_iterator>
+    equal_range(const K& key) const {
+        const EqualRange range = innerEqualRange(key);
+        return {iteratorOf(range.lowerBound), iteratorOf(range.upperBound)};
+    }
 
-    SplayTreeNode* zigStep(SplayTreeNode* node);
+    // Order statistics, available when NodeUpdate tracks subtree sizes.
+    // nth() returns the element with the given zero-based index, or end() if
+    // there is none. rank() returns the number of elements less than the key.
+    // The non-const versions adjust the last node they visit.
+    iterator nth(size_type index) {
+        auto node = innerNth(index);
+        splayAfterRead(node);
+        return iteratorOf(node);
+    }
 
-    SplayTreeNode* zigZigStep(SplayTreeNode* node);
+    const_iterator nth(size_type index) const {
+        return iteratorOf(innerNth(index));
+    }
 
-    SplayTreeNode* zigZagStep(SplayTreeNode* node);
+    size_type rank(const Key& key) {
+        return accessRank(key);
+    }
 
-    SplayTreeNode* leftRotation(SplayTreeNode* node);
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) {
+        return accessRank(key);
+    }
 
-    SplayTreeNode* rightRotation(SplayTreeNode* node);
+    size_type rank(const Key& key) const {
+        return innerRank(key).first;
+    }
 
-    // Helpers.
-    SplayTreeNode* innerLowerBound(const key_type& key) const;
+    template<typename K, typename = EnableIfTransparent<K>>
+    size_type rank(const K& key) const {
+        return innerRank(key).first;
+    }
 
-    SplayTreeNode* innerUpperBound(const key_type& key) const;
+    // The element farthest from the root, or end() if the tree is empty,
+    // available when NodeUpdate tracks subtree heights. The search takes time
+    // proportional to the height, which erasing the element, as it splays the
+    // element first, pays for in the amortized sense.
+    const_iterator deepest() const {
+        return iteratorOf(innerDeepest());
+    }
 
-    SplayTreeNode* findPlaceToInsertUnique(const key_type& key) const;
+    // Batch lookups: the results for the keys in [first, last) are written to
+    // out in the order of the keys. The keys are resolved in ascending order
+    // in a single sweep, every search continuing from the lower bound of the
+    // previous key instead of the root. Sorted keys are not sorted again.
+    // Unlike find() and count(), the batch lookups never restructure the tree.
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const;
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator countBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const;
+
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator containsBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const;
+
+    // A cursor for scans of close keys. seek() finds the lower bound of a key
+    // by climbing from the current position only as far as the key requires
+    // and descending from there, so it takes the length of the climb plus the
+    // descent, at most twice the depth of the tree. A finger that splays has
+    // the nodes it finds splayed as the splay policy requests, otherwise
+    // seeking leaves the tree as it is. Only a splaying finger gets the
+    // dynamic finger bound of splay trees, amortized O(log(d + 1)) for a seek
+    // d elements away from the previous one. Erasing the element of the
+    // finger invalidates it, as it does an iterator.
+    class Finger {
+    public:
+        iterator seek(const Key& key) {
+            return seekLowerBound(key);
+        }
 
-    SplayTreeNode* findPlaceToInsertEqual(const key_type& key) const;
+        template<typename K, typename = EnableIfTransparent<K>>
+        iterator seek(const K& key) {
+            return seekLowerBound(key);
+        }
 
-    template<typename Arg>
-    SplayTreeNode* innerInsert(
-        Arg&& value,
-        SplayTreeNode* placeToInsert,
-        SplayTreeNode* newNode = nullptr);
+        iterator position() const noexcept {
+            return tree_->iteratorOf(node_);
+        }
 
-    void innerErase(SplayTreeNode* node);
+    private:
+        friend class SplayTree;
 
-    SplayTree innerSplit(SplayTreeNode* node);
+        Finger(SplayTree* tree, SplayTreeNode* node, bool splays) noexcept :
+                tree_(tree),
+                node_(node),
+                splays_(splays) {
+        }
 
-    void innerMerge(SplayTree&& rhs);
+        template<typename K>
+        iterator seekLowerBound(const K& key) {
+            node_ = tree_->fingerSeek(node_, key);
+            if (splays_) {
+                tree_->splayAfterRead(node_ ? node_ : tree_->header_.parent);
+            }
+            return position();
+        }
 
-    SplayTreeNode* innerFind(const key_type& key) const;
+        SplayTree* tree_;
+        // Null at the end.
+        SplayTreeNode* node_;
+        bool splays_;
+    };
 
-    bool keysAreEqual(const Key& lhs, const Key& rhs) const {
-        return !comparator_(lhs, rhs) && !comparator_(rhs, lhs);
+    Finger finger(const_iterator position, bool splays = false) noexcept {
+        return Finger(this, nullIfHeader(position.node_), splays);
     }
 
-    SplayTreeNode* root_{nullptr};
-    SplayTreeNode* leftMostNode_{nullptr};
-    SplayTreeNode* rightMostNode_{nullptr};
-    size_type numberOfNodes_{0};
-    Compare comparator_;
-    NodeAllocator nodeAllocator_;
-};
+    Finger finger(bool splays = false) noexcept {
+        return Finger(this, leftMostNode_, splays);
+    }
 
-template<
-    typename Key,
-    typename Value,
-    typename KeyOfValue,
-    typename Compare,
-    typename Allocator
->
-template <bool IsConstIterator>
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::template SplayTreeIterator<IsConstIterator>&
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeIterator<IsConstIterator>::operator++() {
-    if (node_) {
-        SplayTreeNode* currentNode = node_;
+private:
+    // Implements the parallel bulk operations of parallel.h.
+    friend class ParallelOperations;
 
-        if (currentNode->rightChild) {
-            currentNode = currentNode->rightChild;
-            while (currentNode->leftChild) {
-                currentNode = currentNode->leftChild;
-            }
-            node_ = currentNode;
+    // Splay and rotations.
+    // TODO When SplayTreeNode struct is appropriately split, following
+    //      methods will no longer depend on keys, values and template
+    //      parameters and should be moved from here.
+    SplayTreeNode* splay(SplayTreeNode* node);
+
+    void semiSplay(SplayTreeNode* node);
+
+    // Restructure after an access as the splay policy requests. The node may
+    // be null.
+    void splayAfterRead(SplayTreeNode* node) {
+        if (node) {
+            SPLAY_TREE_STATS(stats_.recordAccess(depthOf(node)));
+            adjust(node, splayPolicy_.onRead());
+        }
+    }
+
+    void splayAfterWrite(SplayTreeNode* node) {
+        SPLAY_TREE_STATS(stats_.recordAccess(depthOf(node)));
+        const SplayDepth depth = splayPolicy_.onWrite();
+        if (depth == SplayDepth::NONE) {
+            updatePath(node, header(), HasNodeUpdate());
         } else {
-            while (currentNode->parent &&
-                    currentNode->parent->rightChild == currentNode) {
-                currentNode = currentNode->parent;
-            }
-            node_ = currentNode->parent;
+            adjust(node, depth);
         }
     }
 
-    return *this;
-}
+    void adjust(SplayTreeNode* node, SplayDepth depth);
+
+    // Refreshes the node update metadata from the node up to, but not
+    // including, top. Used where children change without a rotation, such as
+    // insertions not followed by a splay.
+    static void updatePath(
+            SplayTreeNode* node,
+            SplayTreeNode* top,
+            std::true_type) noexcept {
+        for (; node != top; node = node->parent) {
+            NodeUpdate::update(*node);
+        }
+    }
+
+    static void updatePath(SplayTreeNode*, SplayTreeNode*, std::false_type) noexcept {
+    }
+
+    typedef std::integral_constant<
+        bool, !std::is_same<NodeUpdate, NullNodeUpdate>::value> HasNodeUpdate;
+
+    // Top-down splaying. The direction tells on which side of a node the
+    // searched position lies, STOP ends the search at the node.
+    enum class Direction {
+        LEFT,
+        RIGHT,
+        STOP
+    };
+
+    // Splays the node at which the search guided by direction ends and
+    // returns the last other node at which the search went left, i.e. the
+    // smallest node greater than the position when the search ends on its
+    // right. The tree must not be empty.
+    template<typename DirectionOf>
+    SplayTreeNode* topDownSplay(DirectionOf directionOf);
+
+    // Links newNode as the new root, with the current root, which must be a
+    // neighbour of the new node in the in-order sequence, as one of its
+    // children.
+    void insertAsRoot(SplayTreeNode* newNode) noexcept;
+
+    // The non-const lookups: each returns the same node as its const
+    // counterpart and restructures the tree as the splay policy requests.
+    template<typename K>
+    SplayTreeNode* accessLowerBound(const K& key);
+
+    template<typename K>
+    SplayTreeNode* accessUpperBound(const K& key);
+
+    // Return the node below which the key is inserted, or the node holding
+    // the key. A top-down splay makes it the root, so that the key can be
+    // inserted there; bottom-up only a node holding the key is splayed. A key
+    // greater than the maximum is appended below it without a descent.
+    template<typename K>
+    SplayTreeNode* accessPlaceToInsertUnique(const K& key);
+
+    SplayTreeNode* accessPlaceToInsertEqual(const key_type& key);
+
+    SplayTreeNode* zigStep(SplayTreeNode* node);
+
+    SplayTreeNode* zigZigStep(SplayTreeNode* node);
+
+    SplayTreeNode* zigZagStep(SplayTreeNode* node);
+
+    SplayTreeNode* leftRotation(SplayTreeNode* node);
+
+    SplayTreeNode* rightRotation(SplayTreeNode* node);
+
+    // Helpers.
+    template<typename K>
+    SplayTreeNode* innerLowerBound(const K& key) const;
+
+    template<typename K>
+    SplayTreeNode* innerUpperBound(const K& key) const;
+
+    // Returns the lower bound of the key, given the lower bound finger of a
+    // key not greater than it. The search climbs from the finger only as far
+    // as needed and descends from there: the climb plus the descent, bounded
+    // by twice the depth of the tree.
+    template<typename K>
+    SplayTreeNode* fingerLowerBound(SplayTreeNode* finger, const K& key) const;
+
+    // Returns the lower bound of the key, searched from the finger in either
+    // direction. A null finger stands for end().
+    template<typename K>
+    SplayTreeNode* fingerSeek(SplayTreeNode* finger, const K& key) const;
+
+    // The lower bounds of the keys in [first, last) in the order of the keys,
+    // found by fingerLowerBound() in ascending order of the keys.
+    template<typename ForwardIterator>
+    std::vector<SplayTreeNode*> batchLowerBounds(
+        ForwardIterator first,
+        ForwardIterator last) const;
+
+    template<typename K>
+    SplayTreeNode* findPlaceToInsertUnique(const K& key) const;
+
+    SplayTreeNode* findPlaceToInsertEqual(const key_type& key) const;
+
+    // Returns the node below which a key that belongs directly before hint
+    // (the header stands for end()) is linked, or null when the key does not
+    // belong there.
+    template<bool IsUnique, typename K>
+    SplayTreeNode* findPlaceToInsertBefore(SplayTreeNode* hint, const K& key) const;
+
+    // Links newNode below placeToInsert as found by findPlaceToInsertBefore()
+    // and splays it as the splay policy requests.
+    void insertBefore(
+        SplayTreeNode* newNode,
+        SplayTreeNode* placeToInsert,
+        SplayTreeNode* hint) noexcept;
+
+    void attachLeaf(
+        SplayTreeNode* newNode,
+        SplayTreeNode* parent,
+        bool asLeftChild) noexcept;
+
+    template<typename Arg>
+    SplayTreeNode* innerInsert(
+        Arg&& value,
+        SplayTreeNode* placeToInsert,
+        SplayTreeNode* newNode = nullptr);
+
+    void innerErase(SplayTreeNode* node);
+
+    // Unlinks the node from the tree, leaving it a leaf with its metadata
+    // reset.
+    void unlinkNode(SplayTreeNode* node);
+
+    template<bool IsUnique>
+    void innerSplice(SplayTree& source);
+
+    SplayTree innerSplit(SplayTreeNode* node);
+
+    // Moves the part of numberOfNodes_ that belongs to right, a tree split
+    // off this one, over to it. Without subtree sizes both parts are walked
+    // in step until the smaller one ends, so only that one is counted.
+    void splitSizes(SplayTree& right, std::true_type) noexcept {
+        right.numberOfNodes_ = right.root()->subtreeSize;
+        numberOfNodes_ -= right.numberOfNodes_;
+    }
+
+    void splitSizes(SplayTree& right, std::false_type) noexcept {
+        const_iterator leftIt = cbegin();
+        const_iterator rightIt = right.cbegin();
+        size_type steps = 0;
+        while (leftIt != cend() && rightIt != right.cend()) {
+            ++leftIt;
+            ++rightIt;
+            ++steps;
+        }
+        right.numberOfNodes_ = rightIt == right.cend() ? steps : numberOfNodes_ - steps;
+        numberOfNodes_ -= right.numberOfNodes_;
+    }
+
+    void innerMerge(SplayTree&& rhs);
+
+    // Moves the nodes of rhs into this tree, which must be empty, leaving rhs
+    // empty.
+    void takeNodesOf(SplayTree& rhs) noexcept {
+        setRoot(rhs.root());
+        leftMostNode_ = rhs.leftMostNode_;
+        header_.parent = rhs.header_.parent;
+        numberOfNodes_ = rhs.numberOfNodes_;
+        rhs.setRoot(nullptr);
+        rhs.leftMostNode_ = nullptr;
+        rhs.header_.parent = nullptr;
+        rhs.numberOfNodes_ = 0;
+    }
+
+    void moveAssign(SplayTree& rhs, std::true_type) noexcept(
+            std::is_nothrow_move_assignable<Compare>::value &&
+            std::is_nothrow_move_assignable<SplayPolicy>::value) {
+        clear();
+        comparator_ = std::move(rhs.comparator_);
+        splayPolicy_ = std::move(rhs.splayPolicy_);
+        nodeAllocator_ = std::move(rhs.nodeAllocator_);
+        takeNodesOf(rhs);
+    }
+
+    void moveAssign(SplayTree& rhs, std::false_type);
+
+    void swapAllocators(SplayTree& rhs, std::true_type) noexcept {
+        using std::swap;
+        swap(nodeAllocator_, rhs.nodeAllocator_);
+    }
+
+    void swapAllocators(SplayTree& rhs, std::false_type) noexcept {
+        assert(nodeAllocator_ == rhs.nodeAllocator_);
+        (void)rhs;
+    }
+
+    // Moves the elements before the node, or all of them when the node is
+    // null, to the returned tree. Unlike innerSplit() this takes no count of
+    // the moved nodes: the node counts of both trees are left to the caller.
+    SplayTree detachPrefix(SplayTreeNode* node);
+
+    // Moves the elements of [first, last), a null node standing for the end,
+    // to the returned tree and joins the rest back together. Like
+    // detachPrefix() it leaves the node counts to the caller.
+    SplayTree detachRange(SplayTreeNode* first, SplayTreeNode* last);
+
+    // Ranges of at most this many nodes, such as every equal range of a tree
+    // with unique keys, are erased node by node: a splay and a join per node
+    // is cheaper for them than the two splits of detachRange().
+    enum {
+        SHORT_RANGE_NODES = 4
+    };
+
+    // Returns last.
+    SplayTreeNode* innerEraseRange(SplayTreeNode* first, SplayTreeNode* last);
+
+    // Appends the elements of source that precede bound to this tree if Keep
+    // is set, or destroys them. Returns the number of destroyed nodes.
+    template<bool Keep, typename K>
+    size_type moveRunBefore(SplayTree& source, const K& bound);
+
+    // Destroys the nodes of the tree, returning their number. The tree is left
+    // empty.
+    size_type discard(SplayTree& tree) noexcept;
+
+    // The set algebra: the three flags select which elements of the union of
+    // both trees are kept, those only in this tree, those only in rhs and
+    // those in both.
+    template<bool KeepLeftOnly, bool KeepRightOnly, bool KeepCommon>
+    void combine(SplayTree&& rhs);
+
+    // Visits the nodes of the subtree in order. The subtree may have a parent.
+    template<typename Function>
+    static void forEachInSubtree(SplayTreeNode* root, Function& function);
+
+    template<typename K>
+    SplayTreeNode* innerFind(const K& key) const;
+
+    // Returns the lower and upper bound of the key found in a single descent:
+    // both bounds share the search path down to the first node equal to the
+    // key, below which the two searches continue in its subtrees. The middle
+    // node is that first equal node, or null when the key is not present.
+    struct EqualRange {
+        SplayTreeNode* lowerBound;
+        SplayTreeNode* equalNode;
+        SplayTreeNode* upperBound;
+    };
+
+    template<typename K>
+    EqualRange innerEqualRange(const K& key) const;
+
+    template<typename K>
+    std::pair<iterator, iterator> accessEqualRange(const K& key);
+
+    template<typename K>
+    size_type innerCount(const K& key) const;
+
+    template<typename K>
+    size_type accessCount(const K& key);
+
+    template<typename K>
+    SplayTreeNode* accessFind(const K& key);
+
+    template<typename K>
+    size_type eraseEqual(const K& key);
+
+    template<typename K>
+    size_type accessRank(const K& key);
+
+    // Counts the elements equal to the key in the subtree of equalNode. With
+    // subtree sizes this is logarithmic, otherwise linear in the count.
+    template<typename K>
+    size_type countEqual(
+        const EqualRange& range,
+        const K& key,
+        std::true_type) const;
+
+    template<typename K>
+    size_type countEqual(
+        const EqualRange& range,
+        const K& key,
+        std::false_type) const;
+
+    SplayTreeNode* innerNth(size_type index) const;
+
+    SplayTreeNode* innerDeepest() const;
+
+    // Returns the number of elements less than the key together with the last
+    // node on the search path.
+    template<typename K>
+    std::pair<size_type, SplayTreeNode*> innerRank(const K& key) const;
+
+    static void prefetchChildren(const SplayTreeNode* node) noexcept {
+        SPLAY_TREE_PREFETCH(node->leftChild);
+        SPLAY_TREE_PREFETCH(node->rightChild);
+    }
+
+    static size_type leftSubtreeSize(const SplayTreeNode* node) noexcept {
+        return node->leftChild ? node->leftChild->subtreeSize : 0;
+    }
+
+    template<typename K>
+    bool keysAreEqual(const Key& lhs, const K& rhs) const {
+        return !compare(lhs, rhs) && !compare(rhs, lhs);
+    }
+
+    // Whether searches for a K compare key prefixes, which they can only do
+    // for keys of the tree's own type.
+    template<typename K>
+    struct ComparesPrefix :
+        std::integral_constant<
+            bool,
+            !std::is_void<KeyTraits>::value && std::is_same<K, Key>::value> {
+    };
+
+    // The key searched for by a descent, with its prefix computed once.
+    template<typename K, bool = ComparesPrefix<K>::value>
+    struct Probe {
+        explicit Probe(const K& key) noexcept : key(key) {
+        }
+
+        const K& key;
+    };
+
+    template<typename K>
+    struct Probe<K, true> {
+        explicit Probe(const K& key) noexcept :
+            key(key),
+            prefix(KeyTraits::prefix(key)) {
+        }
+
+        const K& key;
+        typename KeyTraits::prefix_type prefix;
+    };
+
+    // Whether the node's key precedes the probed one, or the other way round.
+    // Prefixes decide unless they are equal.
+    template<typename K>
+    bool precedes(const SplayTreeNode* node, const Probe<K, false>& probe) const {
+        return compare(KeyOfValue()(node->value), probe.key);
+    }
+
+    template<typename K>
+    bool precedes(const Probe<K, false>& probe, const SplayTreeNode* node) const {
+        return compare(probe.key, KeyOfValue()(node->value));
+    }
+
+    template<typename K>
+    bool precedes(const SplayTreeNode* node, const Probe<K, true>& probe) const {
+        if (node->keyPrefix < probe.prefix) {
+            return true;
+        }
+        if (probe.prefix < node->keyPrefix) {
+            return false;
+        }
+        return compare(KeyOfValue()(node->value), probe.key);
+    }
+
+    template<typename K>
+    bool precedes(const Probe<K, true>& probe, const SplayTreeNode* node) const {
+        if (probe.prefix < node->keyPrefix) {
+            return true;
+        }
+        if (node->keyPrefix < probe.prefix) {
+            return false;
+        }
+        return compare(probe.key, KeyOfValue()(node->value));
+    }
+
+#ifdef SPLAY_TREE_DEBUG
+    // Checks of a node's metadata by validate(), given its children are valid.
+    static bool hasValidSize(const SplayTreeNode*, std::false_type) noexcept {
+        return true;
+    }
+
+    static bool hasValidSize(const SplayTreeNode* node, std::true_type) noexcept {
+        return node->subtreeSize == 1 +
+            (node->leftChild ? node->leftChild->subtreeSize : 0) +
+            (node->rightChild ? node->rightChild->subtreeSize : 0);
+    }
+
+    static bool hasValidHeight(const SplayTreeNode*, std::false_type) noexcept {
+        return true;
+    }
+
+    static bool hasValidHeight(const SplayTreeNode* node, std::true_type) noexcept {
+        const size_t leftHeight =
+            node->leftChild ? node->leftChild->subtreeHeight : 0;
+        const size_t rightHeight =
+            node->rightChild ? node->rightChild->subtreeHeight : 0;
+        return node->subtreeHeight == 1 + std::max(leftHeight, rightHeight);
+    }
+
+    template<typename K>
+    static bool hasValidPrefix(const SplayTreeNode*, const Probe<K, false>&) noexcept {
+        return true;
+    }
+
+    template<typename K>
+    static bool hasValidPrefix(
+            const SplayTreeNode* node,
+            const Probe<K, true>& probe) noexcept {
+        return !(node->keyPrefix < probe.prefix) && !(probe.prefix < node->keyPrefix);
+    }
+#endif
+
+    // Whether an element with the key lhs may directly precede one with the
+    // key rhs.
+    template<bool IsUnique, typename K1, typename K2>
+    bool mayPrecede(const K1& lhs, const K2& rhs) const {
+        return IsUnique ? compare(lhs, rhs) : !compare(rhs, lhs);
+    }
+
+    template<typename K1, typename K2>
+    bool compare(const K1& lhs, const K2& rhs) const {
+        SPLAY_TREE_COUNT(comparisons);
+        return comparator_(lhs, rhs);
+    }
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+    size_type depthOf(const SplayTreeNode* node) const noexcept {
+        size_type depth = 0;
+        for (; node->parent != header(); node = node->parent) {
+            ++depth;
+        }
+        return depth;
+    }
+#endif
+
+    SplayTreeNode* header() const noexcept {
+        return const_cast<SplayTreeNode*>(&header_);
+    }
+
+    SplayTreeNode* root() const noexcept {
+        return header_.leftChild;
+    }
+
+    void setRoot(SplayTreeNode* node) noexcept {
+        header_.leftChild = node;
+        if (node) {
+            node->parent = header();
+        }
+    }
+
+    // Internally a null node stands for end(), the header only appears in
+    // iterators.
+    SplayTreeNode* nullIfHeader(SplayTreeNode* node) const noexcept {
+        return node == header() ? nullptr : node;
+    }
+
+    iterator iteratorOf(SplayTreeNode* node) noexcept {
+        return iterator(node ? node : header());
+    }
+
+    const_iterator iteratorOf(SplayTreeNode* node) const noexcept {
+        return const_iterator(node ? node : header());
+    }
+
+    // The header is the end() node. Its left child is the root, whose parent
+    // it is, and its parent is the rightmost node, null in an empty tree.
+    SplayTreeNode header_{HeaderTag()};
+    SplayTreeNode* leftMostNode_{nullptr};
+    size_type numberOfNodes_{0};
+    Compare comparator_;
+    SplayPolicy splayPolicy_;
+    NodeAllocator nodeAllocator_;
+#ifdef SPLAY_TREE_ENABLE_STATS
+    // Const lookups compare too.
+    mutable SplayTreeStats stats_;
+#endif
+};
 
 template<
     typename Key,
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 template <bool IsConstIterator>
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::template SplayTreeIterator<IsConstIterator>&
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeIterator<IsConstIterator>::operator--() {
-    if (!node_) {
-        SplayTreeNode* currentNode = root_;
-        while (currentNode && currentNode->rightChild) {
-            currentNode = currentNode->rightChild;
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::template SplayTreeIterator<IsConstIterator>&
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeIterator<IsConstIterator>::operator++() {
+    SplayTreeNode* currentNode = node_;
+
+    if (currentNode->rightChild) {
+        currentNode = currentNode->rightChild;
+        while (currentNode->leftChild) {
+            currentNode = currentNode->leftChild;
         }
         node_ = currentNode;
+    } else {
+        // The root is the left child of the header, so the climb from the
+        // maximum ends there.
+        while (currentNode->parent &&
+                currentNode->parent->rightChild == currentNode) {
+            currentNode = currentNode->parent;
+        }
+        node_ = currentNode->parent;
+    }
+
+    return *this;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template <bool IsConstIterator>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::template SplayTreeIterator<IsConstIterator>&
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeIterator<IsConstIterator>::operator--() {
+    if (node_->rightChild == node_) {
+        // The header keeps the maximum as its parent.
+        node_ = node_->parent;
     } else {
         SplayTreeNode* currentNode = node_;
 
@@ -616,13 +1816,15 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator==(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return lhs.size() == rhs.size() &&
-        std::equal(lhs.cbegin, lhs.cend(), rhs.cbegin());
+        std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin());
 }
 
 template<
@@ -630,11 +1832,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator!=(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return !(lhs == rhs);
 }
 
@@ -643,13 +1847,15 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator<(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return std::lexicographical_compare(
-        lhs.cbegin,
+        lhs.cbegin(),
         lhs.cend(),
         rhs.cbegin(),
         rhs.cend());
@@ -660,11 +1866,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator>(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return rhs < lhs;
 }
 
@@ -673,11 +1881,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator>=(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return !(lhs < rhs);
 }
 
@@ -686,11 +1896,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline bool operator<=(
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        const SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     return rhs >= lhs;
 }
 
@@ -699,11 +1911,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 inline void swap(
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& lhs,
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>& rhs) {
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& lhs,
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs) {
     lhs.swap(rhs);
 }
 
@@ -712,19 +1926,21 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 template<typename Arg>
-std::pair<typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator, bool>
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::insertUnique(Arg&& value) {
-    Key key = KeyOfValue()(value);
-    SplayTreeNode* placeToInsert = findPlaceToInsertUnique(key);
+std::pair<typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator, bool>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertUnique(Arg&& value) {
+    const auto& key = KeyOfValue()(value);
+    SplayTreeNode* placeToInsert = accessPlaceToInsertUnique(key);
 
     if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
-        return {iterator(placeToInsert, root_), false};
+        return {iteratorOf(placeToInsert), false};
     } else {
         auto newNode = innerInsert(std::forward<Arg>(value), placeToInsert);
-        return {iterator(newNode, root_), true};
+        return {iteratorOf(newNode), true};
     }
 }
 
@@ -733,16 +1949,18 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 template<typename Arg>
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::insertEqual(Arg&& value) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertEqual(Arg&& value) {
     const auto& key = KeyOfValue()(value);
-    SplayTreeNode* placeToInsert = findPlaceToInsertEqual(key);
+    SplayTreeNode* placeToInsert = accessPlaceToInsertEqual(key);
 
     auto newNode = innerInsert(std::forward<Arg>(value), placeToInsert);
-    return iterator(newNode, root_);
+    return iteratorOf(newNode);
 }
 
 template<
@@ -750,27 +1968,29 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 template<typename... Args>
 std::pair<
-    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator,
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator,
     bool
-> SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::emplaceUnique(Args&&... args) {
+> SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::emplaceUnique(Args&&... args) {
     SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
     try {
         const auto& key = KeyOfValue()(newNode->value);
-        SplayTreeNode* placeToInsert = findPlaceToInsertUnique(key);
+        SplayTreeNode* placeToInsert = accessPlaceToInsertUnique(key);
 
         if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
             destroyNode(newNode);
-            return {iterator(placeToInsert, root_), false};
+            return {iteratorOf(placeToInsert), false};
         } else {
             newNode = innerInsert(
                 newNode->value,
                 placeToInsert,
                 newNode);
-            return {iterator(newNode, root_), true};
+            return {iteratorOf(newNode), true};
         }
     } catch (...) {
         destroyNode(newNode);
@@ -783,25 +2003,24 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-template<typename... Args>
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::emplaceEqual(Args&&... args) {
-    SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
-    try {
-        const auto& key = KeyOfValue()(newNode->value);
-        SplayTreeNode* placeToInsert = findPlaceToInsertEqual(key);
-
-        auto newNode = innerInsert(
-            newNode->value,
-            placeToInsert,
-            newNode);
-        return iterator(newNode, root_);
-    } catch (...) {
-        destroyNode(newNode);
-        throw;
+template<typename K, typename... Args>
+std::pair<
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator,
+    bool
+> SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::tryEmplaceUnique(
+        const K& key,
+        Args&&... args) {
+    SplayTreeNode* placeToInsert = accessPlaceToInsertUnique(key);
+    if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+        return {iteratorOf(placeToInsert), false};
     }
+    SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
+    newNode = innerInsert(newNode->value, placeToInsert, newNode);
+    return {iteratorOf(newNode), true};
 }
 
 template<
@@ -809,17 +2028,23 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-void SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::mergeUnique(
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>&& rhs) {
-    if (!comparator_(
-            KeyOfValue()(rightMostNode_->value),
-            KeyOfValue()(rhs.leftMostNode_->value))) {
-        throw std::runtime_error(
-            "Trying to merge two splay trees with no key separation property.");
+template<typename Arg>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertUniqueWithHint(
+        const_iterator hint,
+        Arg&& value) {
+    const auto& key = KeyOfValue()(value);
+    SplayTreeNode* placeToInsert = findPlaceToInsertBefore<true>(hint.node_, key);
+    if (!placeToInsert) {
+        return insertUnique(std::forward<Arg>(value)).first;
     }
-    innerMerge(std::move(rhs));
+    SplayTreeNode* newNode = createNode(std::forward<Arg>(value));
+    insertBefore(newNode, placeToInsert, hint.node_);
+    return iteratorOf(newNode);
 }
 
 template<
@@ -827,17 +2052,23 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-void SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::mergeEqual(
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>&& rhs) {
-    if (comparator_(
-            KeyOfValue()(rhs.leftMostNode_->value),
-            KeyOfValue()(rightMostNode_->value))) {
-        throw std::runtime_error(
-            "Trying to merge two splay trees with no key separation property.");
+template<typename Arg>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertEqualWithHint(
+        const_iterator hint,
+        Arg&& value) {
+    const auto& key = KeyOfValue()(value);
+    SplayTreeNode* placeToInsert = findPlaceToInsertBefore<false>(hint.node_, key);
+    if (!placeToInsert) {
+        return insertEqual(std::forward<Arg>(value));
     }
-    innerMerge(std::move(rhs));
+    SplayTreeNode* newNode = createNode(std::forward<Arg>(value));
+    insertBefore(newNode, placeToInsert, hint.node_);
+    return iteratorOf(newNode);
 }
 
 template<
@@ -845,27 +2076,36 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::size_type
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::count(
-        const Key& key) {
-    auto range = equal_range(key);
-    return std::distance(range.first, range.second);
-}
+template<typename... Args>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::emplaceUniqueWithHint(
+        const_iterator hint,
+        Args&&... args) {
+    SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
+    try {
+        const auto& key = KeyOfValue()(newNode->value);
+        SplayTreeNode* placeToInsert =
+            findPlaceToInsertBefore<true>(hint.node_, key);
+        if (placeToInsert) {
+            insertBefore(newNode, placeToInsert, hint.node_);
+            return iteratorOf(newNode);
+        }
 
-template<
-    typename Key,
-    typename Value,
-    typename KeyOfValue,
-    typename Compare,
-    typename Allocator
->
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::size_type
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::count(
-        const Key& key) const {
-    auto range = equal_range(key);
-    return std::distance(range.first, range.second);
+        placeToInsert = accessPlaceToInsertUnique(key);
+        if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+            destroyNode(newNode);
+            return iteratorOf(placeToInsert);
+        }
+        newNode = innerInsert(newNode->value, placeToInsert, newNode);
+        return iteratorOf(newNode);
+    } catch (...) {
+        destroyNode(newNode);
+        throw;
+    }
 }
 
 template<
@@ -873,16 +2113,32 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
->
-std::pair<
-    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator,
-    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::iterator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::equal_range(
-        const Key& key) {
-    // TODO Implement more efficiently.
-    return {lower_bound(key), upper_bound(key)};
+template<typename... Args>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::emplaceEqualWithHint(
+        const_iterator hint,
+        Args&&... args) {
+    SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
+    try {
+        const auto& key = KeyOfValue()(newNode->value);
+        SplayTreeNode* placeToInsert =
+            findPlaceToInsertBefore<false>(hint.node_, key);
+        if (placeToInsert) {
+            insertBefore(newNode, placeToInsert, hint.node_);
+            return iteratorOf(newNode);
+        }
+
+        placeToInsert = accessPlaceToInsertEqual(key);
+        newNode = innerInsert(newNode->value, placeToInsert, newNode);
+        return iteratorOf(newNode);
+    } catch (...) {
+        destroyNode(newNode);
+        throw;
+    }
 }
 
 template<
@@ -890,52 +2146,638 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
->
-std::pair<
-    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::const_iterator,
-    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::const_iterator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::equal_range(
-        const Key& key) const {
-    return {lower_bound(key), upper_bound(key)};
-}
-
+template<typename... Args>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::emplaceEqual(Args&&... args) {
+    SplayTreeNode* newNode = createNode(std::forward<Args>(args)...);
+    try {
+        const auto& key = KeyOfValue()(newNode->value);
+        SplayTreeNode* placeToInsert = accessPlaceToInsertEqual(key);
+
+        newNode = innerInsert(
+            newNode->value,
+            placeToInsert,
+            newNode);
+        return iteratorOf(newNode);
+    } catch (...) {
+        destroyNode(newNode);
+        throw;
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::attachChain(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SortedChain& chain) noexcept {
+    if (!chain.head) {
+        return;
+    }
+    SplayTreeNode* leftMostNode = chain.head;
+    SplayTreeNode* rightMostNode = chain.tail;
+    const size_type length = chain.length;
+    SplayTreeNode* subtree = buildBalancedTree(chain.head, length);
+    chain = SortedChain();
+
+    if (!root()) {
+        setRoot(subtree);
+        leftMostNode_ = leftMostNode;
+    } else {
+        SplayTreeNode* root = splay(header_.parent);
+        assert(!root->rightChild);
+        root->rightChild = subtree;
+        subtree->parent = root;
+        NodeUpdate::update(*root);
+    }
+    header_.parent = rightMostNode;
+    numberOfNodes_ += length;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<bool IsUnique, typename InputIterator>
+InputIterator SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertSortedPrefix(
+        InputIterator first,
+        InputIterator last) {
+    SortedChain chain;
+    try {
+        for (; first != last; ++first) {
+            auto&& value = *first;
+            const SplayTreeNode* previousNode = chain.tail ? chain.tail : header_.parent;
+            if (previousNode) {
+                const auto& key = KeyOfValue()(value);
+                const auto& previousKey = KeyOfValue()(previousNode->value);
+                if (compare(key, previousKey)) {
+                    break;
+                }
+                if (IsUnique && !compare(previousKey, key)) {
+                    // A duplicate of the largest key so far.
+                    continue;
+                }
+            }
+            appendToChain(
+                chain,
+                createNode(std::forward<decltype(value)>(value)));
+        }
+    } catch (...) {
+        attachChain(chain);
+        throw;
+    }
+    attachChain(chain);
+    return first;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::mergeUnique(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&& rhs) {
+    if (root() && rhs.root() && !compare(
+            KeyOfValue()(header_.parent->value),
+            KeyOfValue()(rhs.leftMostNode_->value))) {
+        throw std::runtime_error(
+            "Trying to merge two splay trees with no key separation property.");
+    }
+    innerMerge(std::move(rhs));
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::mergeEqual(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&& rhs) {
+    if (root() && rhs.root() && compare(
+            KeyOfValue()(rhs.leftMostNode_->value),
+            KeyOfValue()(header_.parent->value))) {
+        throw std::runtime_error(
+            "Trying to merge two splay trees with no key separation property.");
+    }
+    innerMerge(std::move(rhs));
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessCount(
+        const K& key) {
+    const EqualRange range = innerEqualRange(key);
+    if (!range.equalNode) {
+        return 0;
+    }
+    const size_type result =
+        countEqual(range, key, TracksSubtreeSize<NodeUpdate>());
+    splayAfterRead(range.equalNode);
+    return result;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerCount(
+        const K& key) const {
+    const EqualRange range = innerEqualRange(key);
+    if (!range.equalNode) {
+        return 0;
+    }
+    return countEqual(range, key, TracksSubtreeSize<NodeUpdate>());
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+std::pair<
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator,
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessEqualRange(
+        const K& key) {
+    const EqualRange range = innerEqualRange(key);
+    splayAfterRead(range.lowerBound ? range.lowerBound : header_.parent);
+    return {iteratorOf(range.lowerBound), iteratorOf(range.upperBound)};
+}
+
 template<
     typename Key,
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::splay(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
-    while (node != root_) {
-        if (node->parent == root_) {
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessFind(
+        const K& key) {
+    SplayTreeNode* placeToInsert = accessPlaceToInsertUnique(key);
+    if (placeToInsert &&
+            keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+        return placeToInsert;
+    }
+    if (!IsTopDown<SplayPolicy>::value) {
+        splayAfterRead(placeToInsert);
+    }
+    return nullptr;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::eraseEqual(
+        const K& key) {
+    auto range = accessEqualRange(key);
+    const size_type oldSize = size();
+    erase(range.first, range.second);
+    return oldSize - size();
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessRank(
+        const K& key) {
+    auto result = innerRank(key);
+    splayAfterRead(result.second);
+    return result.first;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::splay(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    SPLAY_TREE_COUNT(splays);
+    while (node->parent != header()) {
+        if (node->parent->parent == header()) {
+            SPLAY_TREE_COUNT(zigSteps);
             node = zigStep(node);
-            assert(!node->parent);
-            root_ = node;
         } else {
             SplayTreeNode* parent = node->parent;
             SplayTreeNode* grandParent = parent->parent;
 
             if ((grandParent->leftChild == parent) == (parent->leftChild == node)) {
+                SPLAY_TREE_COUNT(zigZigSteps);
                 node = zigZigStep(node);
             } else {
+                SPLAY_TREE_COUNT(zigZagSteps);
+                node = zigZagStep(node);
+            }
+        }
+    }
+
+    // Rotations preserve the in-order sequence, so the extreme nodes stay
+    // valid and need no update here. The rotation at the top relinks the
+    // header to the new root.
+    return node;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::semiSplay(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    SPLAY_TREE_COUNT(splays);
+    while (node->parent != header()) {
+        if (node->parent->parent == header()) {
+            SPLAY_TREE_COUNT(zigSteps);
+            node = zigStep(node);
+        } else {
+            SplayTreeNode* parent = node->parent;
+            SplayTreeNode* grandParent = parent->parent;
+
+            // A zig-zig step only rotates the parent and continues from it,
+            // a zig-zag step is the same as in splay.
+            if ((grandParent->leftChild == parent) == (parent->leftChild == node)) {
+                SPLAY_TREE_COUNT(zigZigSteps);
+                node = zigStep(parent);
+            } else {
+                SPLAY_TREE_COUNT(zigZagSteps);
                 node = zigZagStep(node);
             }
-            if (!node->parent) {
-                root_ = node;
+        }
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::adjust(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node,
+        SplayDepth depth) {
+    switch (depth) {
+        case SplayDepth::NONE:
+            break;
+        case SplayDepth::SEMI:
+            semiSplay(node);
+            break;
+        case SplayDepth::FULL:
+            splay(node);
+            break;
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename DirectionOf>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::topDownSplay(DirectionOf directionOf) {
+    SPLAY_TREE_COUNT(splays);
+    // Nodes passed on the way are collected in a left tree, whose right spine
+    // grows downwards from leftTreeRoot to leftTreeMax, and a right tree,
+    // whose left spine grows from rightTreeRoot to rightTreeMin.
+    SplayTreeNode* leftTreeRoot = nullptr;
+    SplayTreeNode* leftTreeMax = nullptr;
+    SplayTreeNode* rightTreeRoot = nullptr;
+    SplayTreeNode* rightTreeMin = nullptr;
+
+    SplayTreeNode* node = root();
+    SPLAY_TREE_STATS(size_type depth = 0);
+    Direction direction = directionOf(KeyOfValue()(node->value));
+    while (direction != Direction::STOP) {
+        if (direction == Direction::LEFT) {
+            SplayTreeNode* child = node->leftChild;
+            if (!child) {
+                break;
+            }
+            SPLAY_TREE_STATS(++depth);
+            direction = directionOf(KeyOfValue()(child->value));
+            if (direction == Direction::LEFT) {
+                // Zig-zig: rotate right before linking.
+                SPLAY_TREE_COUNT(rotations);
+                node->leftChild = child->rightChild;
+                if (node->leftChild) {
+                    node->leftChild->parent = node;
+                }
+                child->rightChild = node;
+                node->parent = child;
+                NodeUpdate::update(*node);
+                node = child;
+                child = node->leftChild;
+                if (!child) {
+                    break;
+                }
+                SPLAY_TREE_STATS(++depth);
+                direction = directionOf(KeyOfValue()(child->value));
+            }
+            if (rightTreeMin) {
+                rightTreeMin->leftChild = node;
+                node->parent = rightTreeMin;
+            } else {
+                rightTreeRoot = node;
+            }
+            rightTreeMin = node;
+            node = child;
+        } else {
+            SplayTreeNode* child = node->rightChild;
+            if (!child) {
+                break;
+            }
+            SPLAY_TREE_STATS(++depth);
+            direction = directionOf(KeyOfValue()(child->value));
+            if (direction == Direction::RIGHT) {
+                // Zig-zig: rotate left before linking.
+                SPLAY_TREE_COUNT(rotations);
+                node->rightChild = child->leftChild;
+                if (node->rightChild) {
+                    node->rightChild->parent = node;
+                }
+                child->leftChild = node;
+                node->parent = child;
+                NodeUpdate::update(*node);
+                node = child;
+                child = node->rightChild;
+                if (!child) {
+                    break;
+                }
+                SPLAY_TREE_STATS(++depth);
+                direction = directionOf(KeyOfValue()(child->value));
+            }
+            if (leftTreeMax) {
+                leftTreeMax->rightChild = node;
+                node->parent = leftTreeMax;
+            } else {
+                leftTreeRoot = node;
             }
+            leftTreeMax = node;
+            node = child;
+        }
+    }
+
+    SPLAY_TREE_STATS(stats_.recordAccess(depth));
+
+    // Reassemble: the subtrees of the final node go to the inner ends of the
+    // spines, and the left and right trees become its children.
+    if (leftTreeRoot) {
+        leftTreeMax->rightChild = node->leftChild;
+        if (node->leftChild) {
+            node->leftChild->parent = leftTreeMax;
         }
+        node->leftChild = leftTreeRoot;
+        leftTreeRoot->parent = node;
+        updatePath(leftTreeMax, node, HasNodeUpdate());
+    }
+    if (rightTreeRoot) {
+        rightTreeMin->leftChild = node->rightChild;
+        if (node->rightChild) {
+            node->rightChild->parent = rightTreeMin;
+        }
+        node->rightChild = rightTreeRoot;
+        rightTreeRoot->parent = node;
+        updatePath(rightTreeMin, node, HasNodeUpdate());
+    }
+    NodeUpdate::update(*node);
+    setRoot(node);
+    return rightTreeMin;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertAsRoot(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* newNode) noexcept {
+    SplayTreeNode* oldRoot = root();
+    if (compare(KeyOfValue()(newNode->value), KeyOfValue()(oldRoot->value))) {
+        newNode->leftChild = oldRoot->leftChild;
+        newNode->rightChild = oldRoot;
+        oldRoot->leftChild = nullptr;
+    } else {
+        newNode->rightChild = oldRoot->rightChild;
+        newNode->leftChild = oldRoot;
+        oldRoot->rightChild = nullptr;
     }
+    if (newNode->leftChild) {
+        newNode->leftChild->parent = newNode;
+    } else {
+        leftMostNode_ = newNode;
+    }
+    if (newNode->rightChild) {
+        newNode->rightChild->parent = newNode;
+    } else {
+        header_.parent = newNode;
+    }
+    NodeUpdate::update(*oldRoot);
+    NodeUpdate::update(*newNode);
+    setRoot(newNode);
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessLowerBound(
+        const K& key) {
+    if (!IsTopDown<SplayPolicy>::value) {
+        auto node = innerLowerBound(key);
+        splayAfterRead(node ? node : header_.parent);
+        return node;
+    }
+    if (!root()) {
+        return nullptr;
+    }
+    SplayTreeNode* greaterNode = topDownSplay([&](const Key& nodeKey) {
+        return compare(nodeKey, key) ? Direction::RIGHT : Direction::LEFT;
+    });
+    return compare(KeyOfValue()(root()->value), key) ? greaterNode : root();
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessUpperBound(
+        const K& key) {
+    if (!IsTopDown<SplayPolicy>::value) {
+        auto node = innerUpperBound(key);
+        splayAfterRead(node ? node : header_.parent);
+        return node;
+    }
+    if (!root()) {
+        return nullptr;
+    }
+    SplayTreeNode* greaterNode = topDownSplay([&](const Key& nodeKey) {
+        return compare(key, nodeKey) ? Direction::LEFT : Direction::RIGHT;
+    });
+    return compare(key, KeyOfValue()(root()->value)) ? root() : greaterNode;
+}
 
-    // TODO Or maybe maintain those nodes during rotations?
-    leftMostNode_ = getLeftMostNode();
-    rightMostNode_ = getRightMostNode();
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessPlaceToInsertUnique(
+        const K& key) {
+    if (header_.parent &&
+            compare(KeyOfValue()(header_.parent->value), key)) {
+        return header_.parent;
+    }
+    if (!IsTopDown<SplayPolicy>::value) {
+        SplayTreeNode* placeToInsert = findPlaceToInsertUnique(key);
+        if (placeToInsert &&
+                keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+            splayAfterRead(placeToInsert);
+        }
+        return placeToInsert;
+    }
+    if (root()) {
+        topDownSplay([&](const Key& nodeKey) {
+            if (compare(key, nodeKey)) {
+                return Direction::LEFT;
+            } else if (compare(nodeKey, key)) {
+                return Direction::RIGHT;
+            } else {
+                return Direction::STOP;
+            }
+        });
+    }
+    return root();
+}
 
-    return root_;
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::accessPlaceToInsertEqual(
+        const Key& key) {
+    if (header_.parent &&
+            !compare(key, KeyOfValue()(header_.parent->value))) {
+        return header_.parent;
+    }
+    if (!IsTopDown<SplayPolicy>::value) {
+        return findPlaceToInsertEqual(key);
+    }
+    if (root()) {
+        topDownSplay([&](const Key& nodeKey) {
+            return compare(key, nodeKey) ? Direction::LEFT : Direction::RIGHT;
+        });
+    }
+    return root();
 }
 
 template<
@@ -943,11 +2785,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::zigStep(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::zigStep(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
     if (node->parent->leftChild == node) {
         return rightRotation(node);
     } else {
@@ -960,11 +2804,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::zigZigStep(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::zigZigStep(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
     SplayTreeNode* parent = node->parent;
     if (parent->leftChild == node) {
         parent = rightRotation(parent);
@@ -982,11 +2828,13 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::zigZagStep(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::zigZagStep(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
     SplayTreeNode* parent = node->parent;
     if (parent->leftChild == node) {
         node = rightRotation(node);
@@ -1002,11 +2850,14 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::leftRotation(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::leftRotation(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    SPLAY_TREE_COUNT(rotations);
     SplayTreeNode* parent = node->parent;
     assert(parent);
     assert(parent->rightChild == node);
@@ -1028,6 +2879,9 @@ SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::leftRotation(
     }
     parent->parent = node;
 
+    NodeUpdate::update(*parent);
+    NodeUpdate::update(*node);
+
     return node;
 }
 
@@ -1036,11 +2890,14 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::rightRotation(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::rightRotation(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    SPLAY_TREE_COUNT(rotations);
     SplayTreeNode* parent = node->parent;
     assert(parent);
     assert(parent->leftChild == node);
@@ -1062,6 +2919,9 @@ SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::rightRotation(
     }
     parent->parent = node;
 
+    NodeUpdate::update(*parent);
+    NodeUpdate::update(*node);
+
     return node;
 }
 
@@ -1070,15 +2930,20 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerLowerBound(
-        const Key& key) const {
-    SplayTreeNode* currentNode = root_;
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerLowerBound(
+        const K& key) const {
+    const Probe<K> probe(key);
+    SplayTreeNode* currentNode = root();
     SplayTreeNode* lowerBound = nullptr;
     while (currentNode) {
-        if (!comparator_(KeyOfValue()(currentNode->value), key)) {
+        prefetchChildren(currentNode);
+        if (!precedes(currentNode, probe)) {
             lowerBound = currentNode;
             currentNode = currentNode->leftChild;
         } else {
@@ -1093,22 +2958,24 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerUpperBound(
-        const Key& key) const {
-    SplayTreeNode* currentNode = root_;
-    SplayTreeNode* upperBound = nullptr;
-    while (currentNode) {
-        if (comparator_(key, KeyOfValue()(currentNode->value))) {
-            upperBound = currentNode;
-            currentNode = currentNode->leftChild;
-        } else {
-            currentNode = currentNode->rightChild;
+template<typename ForwardIterator, typename OutputIterator>
+OutputIterator SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::findBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+    for (SplayTreeNode* node : batchLowerBounds(first, last)) {
+        if (node && !keysAreEqual(KeyOfValue()(node->value), *first)) {
+            node = nullptr;
         }
+        *out = iteratorOf(node);
+        ++out;
+        ++first;
     }
-    return upperBound;
+    return out;
 }
 
 template<
@@ -1116,23 +2983,253 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::findPlaceToInsertUnique(
-        const Key& key) const {
-    SplayTreeNode* currentNode = root_;
+template<typename ForwardIterator, typename OutputIterator>
+OutputIterator SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::countBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+    for (SplayTreeNode* node : batchLowerBounds(first, last)) {
+        size_type count = 0;
+        for (const_iterator position = iteratorOf(node);
+                position != end() && keysAreEqual(KeyOfValue()(*position), *first);
+                ++position) {
+            ++count;
+        }
+        *out = count;
+        ++out;
+        ++first;
+    }
+    return out;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename ForwardIterator, typename OutputIterator>
+OutputIterator SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::containsBatch(
+        ForwardIterator first,
+        ForwardIterator last,
+        OutputIterator out) const {
+    for (SplayTreeNode* node : batchLowerBounds(first, last)) {
+        *out = node && keysAreEqual(KeyOfValue()(node->value), *first);
+        ++out;
+        ++first;
+    }
+    return out;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::fingerLowerBound(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* finger,
+        const K& key) const {
+    if (!finger || !compare(KeyOfValue()(finger->value), key)) {
+        return finger;
+    }
+
+    // Climb while the subtree of the current node lies entirely before the
+    // key, i.e. until an ancestor holding it in its left subtree does not.
+    SplayTreeNode* currentNode = finger;
+    SplayTreeNode* lowerBound = nullptr;
+    while (currentNode->parent != header()) {
+        SplayTreeNode* parent = currentNode->parent;
+        if (parent->leftChild == currentNode &&
+                !compare(KeyOfValue()(parent->value), key)) {
+            lowerBound = parent;
+            break;
+        }
+        currentNode = parent;
+    }
+
+    // The current node precedes the key, so the lower bound is below its
+    // right child, if not the ancestor found above.
+    currentNode = currentNode->rightChild;
     while (currentNode) {
-        const auto& currentNodeKey = KeyOfValue()(currentNode->value);
-        if (keysAreEqual(currentNodeKey, key)) {
-            return currentNode;
+        if (!compare(KeyOfValue()(currentNode->value), key)) {
+            lowerBound = currentNode;
+            currentNode = currentNode->leftChild;
+        } else {
+            currentNode = currentNode->rightChild;
+        }
+    }
+    return lowerBound;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::fingerSeek(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* finger,
+        const K& key) const {
+    // From the end the search starts at the maximum.
+    if (!finger) {
+        finger = header_.parent;
+        if (!finger) {
+            return nullptr;
+        }
+    }
+    if (compare(KeyOfValue()(finger->value), key)) {
+        return fingerLowerBound(finger, key);
+    }
+
+    // The mirror image of fingerLowerBound(): climb until an ancestor holding
+    // the current node in its right subtree precedes the key. The lower bound
+    // is in the subtree of the current node then, which holds the finger.
+    SplayTreeNode* currentNode = finger;
+    while (currentNode->parent != header()) {
+        SplayTreeNode* parent = currentNode->parent;
+        if (parent->rightChild == currentNode &&
+                compare(KeyOfValue()(parent->value), key)) {
+            break;
+        }
+        currentNode = parent;
+    }
+
+    SplayTreeNode* lowerBound = nullptr;
+    while (currentNode) {
+        if (!compare(KeyOfValue()(currentNode->value), key)) {
+            lowerBound = currentNode;
+            currentNode = currentNode->leftChild;
+        } else {
+            currentNode = currentNode->rightChild;
+        }
+    }
+    return lowerBound;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename ForwardIterator>
+std::vector<typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::batchLowerBounds(
+        ForwardIterator first,
+        ForwardIterator last) const {
+    typedef typename std::iterator_traits<ForwardIterator>::value_type ProbeKey;
+    std::vector<SplayTreeNode*> lowerBounds(std::distance(first, last));
+    // The smallest node is the lower bound of any key preceding all others.
+    SplayTreeNode* finger = leftMostNode_;
+
+    const bool isSorted = std::is_sorted(
+        first,
+        last,
+        [this](const ProbeKey& lhs, const ProbeKey& rhs) {
+            return compare(lhs, rhs);
+        });
+    if (isSorted) {
+        for (auto& lowerBound : lowerBounds) {
+            finger = fingerLowerBound(finger, *first);
+            lowerBound = finger;
+            ++first;
+        }
+        return lowerBounds;
+    }
+
+    typedef std::pair<ForwardIterator, size_type> Probe;
+    std::vector<Probe> probes;
+    probes.reserve(lowerBounds.size());
+    for (size_type index = 0; first != last; ++first, ++index) {
+        probes.emplace_back(first, index);
+    }
+    std::sort(
+        probes.begin(),
+        probes.end(),
+        [this](const Probe& lhs, const Probe& rhs) {
+            return compare(*lhs.first, *rhs.first);
+        });
+    for (const Probe& probe : probes) {
+        finger = fingerLowerBound(finger, *probe.first);
+        lowerBounds[probe.second] = finger;
+    }
+    return lowerBounds;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerUpperBound(
+        const K& key) const {
+    const Probe<K> probe(key);
+    SplayTreeNode* currentNode = root();
+    SplayTreeNode* upperBound = nullptr;
+    while (currentNode) {
+        prefetchChildren(currentNode);
+        if (precedes(probe, currentNode)) {
+            upperBound = currentNode;
+            currentNode = currentNode->leftChild;
+        } else {
+            currentNode = currentNode->rightChild;
         }
-        if (comparator_(key, currentNodeKey)) {
+    }
+    return upperBound;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::findPlaceToInsertUnique(
+        const K& key) const {
+    const Probe<K> probe(key);
+    SplayTreeNode* currentNode = root();
+    while (currentNode) {
+        prefetchChildren(currentNode);
+        if (precedes(probe, currentNode)) {
             if (!currentNode->leftChild) {
                 return currentNode;
             } else {
                 currentNode = currentNode->leftChild;
             }
+        } else if (!precedes(currentNode, probe)) {
+            return currentNode;
         } else {
             if (!currentNode->rightChild) {
                 return currentNode;
@@ -1149,15 +3246,18 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::findPlaceToInsertEqual(
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::findPlaceToInsertEqual(
         const Key& key) const {
-    SplayTreeNode* currentNode = root_;
+    const Probe<Key> probe(key);
+    SplayTreeNode* currentNode = root();
     while (currentNode) {
-        const auto& currentNodeKey = KeyOfValue()(currentNode->value);
-        if (comparator_(key, currentNodeKey)) {
+        prefetchChildren(currentNode);
+        if (precedes(probe, currentNode)) {
             if (!currentNode->leftChild) {
                 return currentNode;
             } else {
@@ -1179,15 +3279,17 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
 template<typename Arg>
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerInsert(
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerInsert(
         Arg&& value,
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
             placeToInsert,
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
             newNode) {
     if (!newNode) {
         newNode = createNode(std::forward<Arg>(value));
@@ -1195,27 +3297,19 @@ SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerInsert(
 
     if (!placeToInsert) {
         // That means the tree is empty.
-        root_ = newNode;
-        leftMostNode_ = root_;
-        rightMostNode_ = root_;
+        setRoot(newNode);
+        leftMostNode_ = newNode;
+        header_.parent = newNode;
+    } else if (IsTopDown<SplayPolicy>::value && placeToInsert == root()) {
+        insertAsRoot(newNode);
     } else {
-        const auto& key = KeyOfValue()(newNode->value);
-        newNode->parent = placeToInsert;
-        if (comparator_(key, KeyOfValue()(placeToInsert->value))) {
-            assert(!placeToInsert->leftChild);
-            placeToInsert->leftChild = newNode;
-            if (placeToInsert == leftMostNode_) {
-                leftMostNode_ = newNode;
-            }
-        } else {
-            assert(!placeToInsert->rightChild);
-            placeToInsert->rightChild = newNode;
-            if (placeToInsert == rightMostNode_) {
-                rightMostNode_ = newNode;
-            }
-        }
-
-        newNode = splay(newNode);
+        attachLeaf(
+            newNode,
+            placeToInsert,
+            compare(
+                KeyOfValue()(newNode->value),
+                KeyOfValue()(placeToInsert->value)));
+        splayAfterWrite(newNode);
     }
 
     ++numberOfNodes_;
@@ -1228,79 +3322,141 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-void SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerErase(
-        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
-    if (node->leftChild && node->rightChild) {
-        SplayTreeNode* nodeToExchange = node->rightChild;
-        while (nodeToExchange->leftChild) {
-            nodeToExchange = nodeToExchange->leftChild;
-        }
+template<bool IsUnique, typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::findPlaceToInsertBefore(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* hint,
+        const K& key) const {
+    if (!root()) {
+        return nullptr;
+    }
 
-        nodeToExchange->leftChild = node->leftChild;
-        node->leftChild->parent = nodeToExchange;
-        node->leftChild = nullptr;
+    const bool isEnd = hint == header();
+    if (!isEnd && !mayPrecede<IsUnique>(key, KeyOfValue()(hint->value))) {
+        return nullptr;
+    }
+    // Stepping back from the header reaches the maximum in O(1).
+    SplayTreeNode* previousNode = hint == leftMostNode_ ?
+        nullptr : (--iterator(hint)).node_;
+    if (previousNode &&
+            !mayPrecede<IsUnique>(KeyOfValue()(previousNode->value), key)) {
+        return nullptr;
+    }
+    // Either hint has no left child or the previous node, the maximum of its
+    // left subtree, has no right child.
+    return !isEnd && !hint->leftChild ? hint : previousNode;
+}
 
-        auto nodeParent = node->parent;
-        if (nodeToExchange->parent->leftChild == nodeToExchange) {
-            nodeToExchange->parent->leftChild = node;
-            node->parent = nodeToExchange->parent;
-            std::swap(nodeToExchange->rightChild, node->rightChild);
-            if (node->rightChild) {
-                node->rightChild->parent = node;
-            }
-            nodeToExchange->rightChild->parent = nodeToExchange;
-        } else {
-            node->rightChild = nodeToExchange->rightChild;
-            if (node->rightChild) {
-                node->rightChild->parent = node;
-            }
-            nodeToExchange->rightChild = node;
-            node->parent = nodeToExchange;
-        }
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertBefore(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* newNode,
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* placeToInsert,
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* hint) noexcept {
+    attachLeaf(newNode, placeToInsert, placeToInsert == hint);
+    splayAfterWrite(newNode);
+    ++numberOfNodes_;
+}
 
-        if (nodeParent) {
-            if (nodeParent->leftChild == node) {
-                nodeParent->leftChild = nodeToExchange;
-            } else {
-                nodeParent->rightChild = nodeToExchange;
-            }
-        } else {
-            root_ = nodeToExchange;
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::attachLeaf(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* newNode,
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* parent,
+        bool asLeftChild) noexcept {
+    newNode->parent = parent;
+    if (asLeftChild) {
+        assert(!parent->leftChild);
+        parent->leftChild = newNode;
+        if (parent == leftMostNode_) {
+            leftMostNode_ = newNode;
+        }
+    } else {
+        assert(!parent->rightChild);
+        parent->rightChild = newNode;
+        if (parent == header_.parent) {
+            header_.parent = newNode;
         }
-        nodeToExchange->parent = nodeParent;
     }
+}
 
-    if (!node->parent) {
-        if (node->leftChild) {
-            root_ = node->leftChild;
-        } else {
-            root_ = node->rightChild;
-        }
-        if (root_) {
-            root_->parent = nullptr;
-        }
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::unlinkNode(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    // The extreme nodes are updated from their in-order neighbours before the
+    // node is unlinked, so no walk from the root is needed afterwards.
+    if (node == header_.parent) {
+        header_.parent = node == leftMostNode_ ?
+            nullptr : (--iterator(node)).node_;
+    }
+    if (node == leftMostNode_) {
+        leftMostNode_ = nullIfHeader((++iterator(node)).node_);
+    }
+
+    // Splay-then-join: the node is splayed to the root and replaced by the
+    // join of its subtrees, whose left one gets its maximum splayed to the
+    // top so the right one can hang off it.
+    splay(node);
+    SplayTreeNode* const leftRoot = node->leftChild;
+    SplayTreeNode* const rightRoot = node->rightChild;
+    if (!leftRoot) {
+        setRoot(rightRoot);
     } else {
-        auto parent = node->parent;
-        auto child = node->leftChild ? node->leftChild : node->rightChild;
-        if (parent->leftChild == node) {
-            parent->leftChild = child;
-        } else {
-            parent->rightChild = child;
+        setRoot(leftRoot);
+        if (rightRoot) {
+            SplayTreeNode* const maximum = splay(rightMostNodeOf(leftRoot));
+            maximum->rightChild = rightRoot;
+            rightRoot->parent = maximum;
+            NodeUpdate::update(*maximum);
         }
-        if (child) {
-            child->parent = parent;
-        }
-        splay(parent);
     }
 
-    // TODO Update leftMostNode and rightMostNode during erase.
-    leftMostNode_ = getLeftMostNode();
-    rightMostNode_ = getRightMostNode();
+    node->parent = nullptr;
+    node->leftChild = nullptr;
+    node->rightChild = nullptr;
+    NodeUpdate::update(*node);
+    --numberOfNodes_;
+}
 
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerErase(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    unlinkNode(node);
     destroyNode(node);
-    --numberOfNodes_;
 }
 
 template<
@@ -1308,25 +3464,166 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insert_return_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertUnique(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::node_type&& node) {
+    if (node.empty()) {
+        return {end(), false, node_type()};
+    }
+    assert(node.nodeAllocator_ == nodeAllocator_);
+    // The key may have been changed through the handle.
+    node.node_->storePrefix(KeyOfValue()(node.node_->value));
+    const auto& key = KeyOfValue()(node.node_->value);
+    SplayTreeNode* placeToInsert = accessPlaceToInsertUnique(key);
+
+    if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+        return {iteratorOf(placeToInsert), false, std::move(node)};
+    }
+    // The handle keeps the node if the comparator throws.
+    innerInsert(node.node_->value, placeToInsert, node.node_);
+    return {iteratorOf(node.release()), true, node_type()};
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::iterator
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::insertEqual(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::node_type&& node) {
+    if (node.empty()) {
+        return end();
+    }
+    assert(node.nodeAllocator_ == nodeAllocator_);
+    node.node_->storePrefix(KeyOfValue()(node.node_->value));
+    SplayTreeNode* placeToInsert =
+        accessPlaceToInsertEqual(KeyOfValue()(node.node_->value));
+    innerInsert(node.node_->value, placeToInsert, node.node_);
+    return iteratorOf(node.release());
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<bool IsUnique>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerSplice(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& source) {
+    if (&source == this) {
+        return;
+    }
+    assert(source.nodeAllocator_ == nodeAllocator_);
+    // Source is walked in order, so a run of keys past the maximum of this
+    // tree is appended without descents.
+    SplayTreeNode* node = source.leftMostNode_;
+    while (node) {
+        SplayTreeNode* const next = source.nullIfHeader((++iterator(node)).node_);
+        const auto& key = KeyOfValue()(node->value);
+        SplayTreeNode* placeToInsert = IsUnique ?
+            accessPlaceToInsertUnique(key) : accessPlaceToInsertEqual(key);
+        if (!IsUnique || !placeToInsert ||
+                !keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
+            source.unlinkNode(node);
+            try {
+                innerInsert(node->value, placeToInsert, node);
+            } catch (...) {
+                destroyNode(node);
+                throw;
+            }
+        }
+        node = next;
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerSplit(
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode* node) {
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerSplit(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    // Every path returns this one object, so it is built in place and the
+    // nodes never link to the header of a local that is moved from.
+    SplayTree right(nullptr, nullptr, nullptr, 0, comparator_, nodeAllocator_);
+    if (!node) {
+        return right;
+    }
     splay(node);
 
-    auto leftRoot = root_->leftChild;
-    root_->leftChild = nullptr;
-    leftRoot->parent = nullptr;
-    auto rightRoot = root_->rightChild;
-    root_->rightChild = nullptr;
-    rightRoot->parent = nullptr;
+    // The node becomes the root of the right part.
+    SplayTreeNode* leftRoot = node->leftChild;
+    node->leftChild = nullptr;
+    NodeUpdate::update(*node);
+    right.setRoot(node);
+    right.leftMostNode_ = node;
+    right.header_.parent = header_.parent;
+
+    setRoot(leftRoot);
+    if (leftRoot) {
+        // Splaying the new maximum pays for the walk down to it.
+        header_.parent = splay(rightMostNodeOf(leftRoot));
+    } else {
+        leftMostNode_ = nullptr;
+        header_.parent = nullptr;
+    }
+    splitSizes(right, TracksSubtreeSize<NodeUpdate>());
 
-    // TODO Doesn't look nice and invokes unnecessary copies/moves,
-    //      should be rewritten.
-    *this = SplayTree(leftRoot, comparator_, nodeAllocator_);
+    return right;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::moveAssign(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& rhs,
+        std::false_type) {
+    clear();
+    comparator_ = std::move(rhs.comparator_);
+    splayPolicy_ = std::move(rhs.splayPolicy_);
+    if (nodeAllocator_ == rhs.nodeAllocator_) {
+        takeNodesOf(rhs);
+        return;
+    }
 
-    return {rightRoot, comparator_, nodeAllocator_};
+    // This allocator can't free the nodes of rhs.
+    SortedChain chain;
+    try {
+        for (SplayTreeNode* node = rhs.leftMostNode_;
+                node;
+                node = rhs.nullIfHeader((++iterator(node)).node_)) {
+            appendToChain(chain, createNode(std::move(node->value)));
+        }
+    } catch (...) {
+        destroyTree(chain.head);
+        throw;
+    }
+    attachChain(chain);
+    rhs.clear();
 }
 
 template<
@@ -1334,21 +3631,32 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-void SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerMerge(
-        SplayTree<Key, Value, KeyOfValue, Compare, Allocator>&& rhs) {
-    splay(rightMostNode_);
-    assert(!root_->rightChild);
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerMerge(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&& rhs) {
+    if (!rhs.root()) {
+        return;
+    }
+    if (!root()) {
+        setRoot(rhs.root());
+        leftMostNode_ = rhs.leftMostNode_;
+    } else {
+        SplayTreeNode* root = splay(header_.parent);
+        assert(!root->rightChild);
 
-    root_->rightChild = rhs.root_;
-    root_->rightChild->parent = root_;
-    rightMostNode_ = rhs.rightMostNode_;
+        root->rightChild = rhs.root();
+        root->rightChild->parent = root;
+        NodeUpdate::update(*root);
+    }
+    header_.parent = rhs.header_.parent;
     numberOfNodes_ += rhs.numberOfNodes_;
 
-    rhs.root_ = nullptr;
+    rhs.setRoot(nullptr);
     rhs.leftMostNode_ = nullptr;
-    rhs.rightMostNode_ = nullptr;
+    rhs.header_.parent = nullptr;
     rhs.numberOfNodes_ = 0;
 }
 
@@ -1357,11 +3665,242 @@ template<
     typename Value,
     typename KeyOfValue,
     typename Compare,
-    typename Allocator
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
 >
-typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::SplayTreeNode*
-SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerFind(
-        const Key& key) const {
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::detachPrefix(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* node) {
+    SplayTree prefix(nullptr, nullptr, nullptr, 0, comparator_, nodeAllocator_);
+    if (!node) {
+        prefix.setRoot(root());
+        prefix.leftMostNode_ = leftMostNode_;
+        prefix.header_.parent = header_.parent;
+        setRoot(nullptr);
+        leftMostNode_ = nullptr;
+        header_.parent = nullptr;
+        return prefix;
+    }
+
+    splay(node);
+    SplayTreeNode* prefixRoot = node->leftChild;
+    if (prefixRoot) {
+        node->leftChild = nullptr;
+        NodeUpdate::update(*node);
+        prefix.setRoot(prefixRoot);
+        prefix.leftMostNode_ = leftMostNode_;
+        prefix.header_.parent = rightMostNodeOf(prefixRoot);
+        leftMostNode_ = node;
+    }
+    return prefix;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::detachRange(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* first,
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* last) {
+    SplayTree range(nullptr, nullptr, nullptr, 0, comparator_, nodeAllocator_);
+    if (first == last) {
+        return range;
+    }
+
+    // The node count of this tree still covers the whole range.
+    const size_type numberOfNodes = numberOfNodes_;
+    SplayTree prefix = detachPrefix(first);
+    SplayTree detached = detachPrefix(last);
+    range.takeNodesOf(detached);
+
+    // The prefix takes the suffix and hands the result back.
+    prefix.innerMerge(std::move(*this));
+    takeNodesOf(prefix);
+    numberOfNodes_ = numberOfNodes;
+    return range;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerEraseRange(
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* first,
+        typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode* last) {
+    SplayTreeNode* bound = first;
+    for (int i = 0; i < SHORT_RANGE_NODES && bound != last; ++i) {
+        bound = nullIfHeader((++iterator(bound)).node_);
+    }
+    if (bound == last) {
+        while (first != last) {
+            SplayTreeNode* const next = nullIfHeader((++iterator(first)).node_);
+            innerErase(first);
+            first = next;
+        }
+        return last;
+    }
+
+    SplayTree range = detachRange(first, last);
+    numberOfNodes_ -= discard(range);
+    return last;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<bool Keep, typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::moveRunBefore(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& source,
+        const K& bound) {
+    SplayTree run = source.detachPrefix(source.innerLowerBound(bound));
+    if (!Keep) {
+        return discard(run);
+    }
+    innerMerge(std::move(run));
+    return 0;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::discard(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>& tree) noexcept {
+    const size_type destroyedNodes = tree.destroyTree(tree.root());
+    tree.leftMostNode_ = nullptr;
+    tree.header_.parent = nullptr;
+    tree.numberOfNodes_ = 0;
+    return destroyedNodes;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<bool KeepLeftOnly, bool KeepRightOnly, bool KeepCommon>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::combine(
+        SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>&& rhs) {
+    // The runs are detached without counting their nodes, the size of the
+    // result follows from the number of destroyed ones.
+    const size_type totalSize = size() + rhs.size();
+    size_type destroyedNodes = 0;
+    SplayTree result(nullptr, nullptr, nullptr, 0, comparator_, nodeAllocator_);
+    try {
+        while (root() && rhs.root()) {
+            const auto& leftMinimum = KeyOfValue()(leftMostNode_->value);
+            const auto& rightMinimum = KeyOfValue()(rhs.leftMostNode_->value);
+            if (compare(leftMinimum, rightMinimum)) {
+                destroyedNodes +=
+                    result.moveRunBefore<KeepLeftOnly>(*this, rightMinimum);
+            } else if (compare(rightMinimum, leftMinimum)) {
+                destroyedNodes +=
+                    result.moveRunBefore<KeepRightOnly>(rhs, leftMinimum);
+            } else {
+                // A pair of equal elements: the one of this tree represents
+                // both.
+                SplayTree leftElement = detachPrefix(
+                    nullIfHeader((++iterator(leftMostNode_)).node_));
+                SplayTree rightElement = rhs.detachPrefix(
+                    rhs.nullIfHeader((++iterator(rhs.leftMostNode_)).node_));
+                destroyedNodes += discard(rightElement);
+                if (KeepCommon) {
+                    result.innerMerge(std::move(leftElement));
+                } else {
+                    destroyedNodes += discard(leftElement);
+                }
+            }
+        }
+    } catch (...) {
+        clear();
+        rhs.clear();
+        throw;
+    }
+
+    if (KeepLeftOnly) {
+        result.innerMerge(std::move(*this));
+    } else {
+        destroyedNodes += discard(*this);
+    }
+    if (KeepRightOnly) {
+        result.innerMerge(std::move(rhs));
+    } else {
+        destroyedNodes += discard(rhs);
+    }
+
+    takeNodesOf(result);
+    numberOfNodes_ = totalSize - destroyedNodes;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename Function>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::forEachInSubtree(
+        SplayTreeNode* root,
+        Function& function) {
+    if (!root) {
+        return;
+    }
+    // Iteration would continue past the subtree, so it stops at its maximum.
+    const SplayTreeNode* last = rightMostNodeOf(root);
+    for (const_iterator it(leftMostNodeOf(root)); ; ++it) {
+        function(*it);
+        if (it.node_ == last) {
+            break;
+        }
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerFind(
+        const K& key) const {
     SplayTreeNode* placeToInsert = findPlaceToInsertUnique(key);
     if (placeToInsert && keysAreEqual(KeyOfValue()(placeToInsert->value), key)) {
         return placeToInsert;
@@ -1370,6 +3909,284 @@ SplayTree<Key, Value, KeyOfValue, Compare, Allocator>::innerFind(
     }
 }
 
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerNth(
+        size_type index) const {
+    static_assert(
+        TracksSubtreeSize<NodeUpdate>::value,
+        "nth() requires a node update tracking subtree sizes, "
+        "e.g. SubtreeSizeNodeUpdate.");
+    if (index >= size()) {
+        return nullptr;
+    }
+    SplayTreeNode* currentNode = root();
+    while (true) {
+        const size_type leftSize = leftSubtreeSize(currentNode);
+        if (index < leftSize) {
+            currentNode = currentNode->leftChild;
+        } else if (index == leftSize) {
+            return currentNode;
+        } else {
+            index -= leftSize + 1;
+            currentNode = currentNode->rightChild;
+        }
+    }
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerDeepest() const {
+    static_assert(
+        TracksSubtreeHeight<NodeUpdate>::value,
+        "deepest() requires a node update tracking subtree heights, "
+        "e.g. SubtreeHeightNodeUpdate.");
+    SplayTreeNode* currentNode = root();
+    while (currentNode) {
+        const size_t leftHeight =
+            currentNode->leftChild ? currentNode->leftChild->subtreeHeight : 0;
+        const size_t rightHeight =
+            currentNode->rightChild ? currentNode->rightChild->subtreeHeight : 0;
+        if (leftHeight == 0 && rightHeight == 0) {
+            break;
+        }
+        currentNode = leftHeight < rightHeight ?
+            currentNode->rightChild : currentNode->leftChild;
+    }
+    return currentNode;
+}
+
+#ifdef SPLAY_TREE_DEBUG
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+void SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::validate() const {
+    auto check = [](bool holds, const char* invariant) {
+        if (!holds) {
+            throw std::logic_error(invariant);
+        }
+    };
+    check(header_.rightChild == header(), "The header does not mark itself.");
+    check(!root() || root()->parent == header(), "The root's parent is not the header.");
+    check(leftMostNode_ == leftMostNodeOf(root()), "The cached minimum is wrong.");
+    check(
+        header_.parent == rightMostNodeOf(root()),
+        "The header's parent is not the maximum.");
+
+    // Depth-first, with the nearest ancestors the subtree lies right and left
+    // of. Paths can be as long as the tree, so there is no recursion.
+    struct Frame {
+        const SplayTreeNode* node;
+        const SplayTreeNode* lowerBound;
+        const SplayTreeNode* upperBound;
+    };
+    std::vector<Frame> frames;
+    if (root()) {
+        frames.push_back({root(), nullptr, nullptr});
+    }
+    size_type count = 0;
+    while (!frames.empty()) {
+        const Frame frame = frames.back();
+        frames.pop_back();
+        const SplayTreeNode* node = frame.node;
+        const auto& key = KeyOfValue()(node->value);
+        ++count;
+        check(
+            !frame.lowerBound || !compare(key, KeyOfValue()(frame.lowerBound->value)),
+            "A key is less than one of a node it is right of.");
+        check(
+            !frame.upperBound || !compare(KeyOfValue()(frame.upperBound->value), key),
+            "A key is greater than one of a node it is left of.");
+        check(
+            !node->leftChild || node->leftChild->parent == node,
+            "A left child does not link back to its parent.");
+        check(
+            !node->rightChild || node->rightChild->parent == node,
+            "A right child does not link back to its parent.");
+        check(
+            hasValidSize(node, TracksSubtreeSize<NodeUpdate>()),
+            "A subtree size is wrong.");
+        check(
+            hasValidHeight(node, TracksSubtreeHeight<NodeUpdate>()),
+            "A subtree height is wrong.");
+        check(hasValidPrefix(node, Probe<Key>(key)), "A key prefix is stale.");
+        if (node->leftChild) {
+            frames.push_back({node->leftChild, frame.lowerBound, node});
+        }
+        if (node->rightChild) {
+            frames.push_back({node->rightChild, node, frame.upperBound});
+        }
+    }
+    check(numberOfNodes_ == count, "The cached size is wrong.");
+}
+#endif
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+std::pair<
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type,
+    typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::SplayTreeNode*
+>
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerRank(
+        const K& key) const {
+    static_assert(
+        TracksSubtreeSize<NodeUpdate>::value,
+        "rank() requires a node update tracking subtree sizes, "
+        "e.g. SubtreeSizeNodeUpdate.");
+    size_type rank = 0;
+    SplayTreeNode* lastNode = nullptr;
+    SplayTreeNode* currentNode = root();
+    while (currentNode) {
+        lastNode = currentNode;
+        if (compare(KeyOfValue()(currentNode->value), key)) {
+            rank += leftSubtreeSize(currentNode) + 1;
+            currentNode = currentNode->rightChild;
+        } else {
+            currentNode = currentNode->leftChild;
+        }
+    }
+    return {rank, lastNode};
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::EqualRange
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::innerEqualRange(
+        const K& key) const {
+    SplayTreeNode* currentNode = root();
+    SplayTreeNode* upperBound = nullptr;
+    while (currentNode) {
+        if (compare(KeyOfValue()(currentNode->value), key)) {
+            currentNode = currentNode->rightChild;
+        } else if (compare(key, KeyOfValue()(currentNode->value))) {
+            upperBound = currentNode;
+            currentNode = currentNode->leftChild;
+        } else {
+            break;
+        }
+    }
+    if (!currentNode) {
+        return {upperBound, nullptr, upperBound};
+    }
+
+    // Every node in the left subtree of the equal node is not greater than
+    // the key and every node in the right subtree is not less than it.
+    SplayTreeNode* lowerBound = currentNode;
+    for (SplayTreeNode* node = currentNode->leftChild; node;) {
+        if (compare(KeyOfValue()(node->value), key)) {
+            node = node->rightChild;
+        } else {
+            lowerBound = node;
+            node = node->leftChild;
+        }
+    }
+    for (SplayTreeNode* node = currentNode->rightChild; node;) {
+        if (compare(key, KeyOfValue()(node->value))) {
+            upperBound = node;
+            node = node->leftChild;
+        } else {
+            node = node->rightChild;
+        }
+    }
+    return {lowerBound, currentNode, upperBound};
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::countEqual(
+        const EqualRange& range,
+        const K& key,
+        std::true_type) const {
+    size_type result = 1;
+    for (SplayTreeNode* node = range.equalNode->leftChild; node;) {
+        if (compare(KeyOfValue()(node->value), key)) {
+            node = node->rightChild;
+        } else {
+            result += 1 + (node->rightChild ? node->rightChild->subtreeSize : 0);
+            node = node->leftChild;
+        }
+    }
+    for (SplayTreeNode* node = range.equalNode->rightChild; node;) {
+        if (compare(key, KeyOfValue()(node->value))) {
+            node = node->leftChild;
+        } else {
+            result += 1 + leftSubtreeSize(node);
+            node = node->rightChild;
+        }
+    }
+    return result;
+}
+
+template<
+    typename Key,
+    typename Value,
+    typename KeyOfValue,
+    typename Compare,
+    typename Allocator,
+    typename NodeUpdate,
+    typename SplayPolicy
+>
+template<typename K>
+typename SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::size_type
+SplayTree<Key, Value, KeyOfValue, Compare, Allocator, NodeUpdate, SplayPolicy>::countEqual(
+        const EqualRange& range,
+        const K&,
+        std::false_type) const {
+    return std::distance(
+        iteratorOf(range.lowerBound),
+        iteratorOf(range.upperBound));
+}
+
 } // namespace splay_tree
 
+#undef SPLAY_TREE_COUNT
+#undef SPLAY_TREE_STATS
+
 #endif // SPLAY_TREE_SPLAY_TREE_H_
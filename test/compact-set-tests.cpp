@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "splay-tree/compact-set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace splay_tree;
+
+TEST(compact_set_test, insertFindErase) {
+    compact_set<uint32_t> set{5, 1, 9, 3, 7};
+    EXPECT_EQ(5, set.size());
+    EXPECT_FALSE(set.insert(3).second);
+    EXPECT_TRUE(set.insert(4).second);
+    EXPECT_EQ(6, set.size());
+
+    EXPECT_EQ(9, *set.find(9));
+    EXPECT_EQ(set.end(), set.find(2));
+    EXPECT_EQ(4, *set.lower_bound(4));
+    EXPECT_EQ(5, *set.upper_bound(4));
+    EXPECT_EQ(set.end(), set.upper_bound(9));
+    EXPECT_EQ(1, *set.lower_bound(0));
+
+    const auto& constSet = set;
+    EXPECT_EQ(7, *constSet.find(7));
+    EXPECT_EQ(7, *constSet.lower_bound(6));
+    EXPECT_EQ(constSet.end(), constSet.upper_bound(10));
+
+    EXPECT_EQ(1, set.erase(1));
+    EXPECT_EQ(0, set.erase(1));
+    EXPECT_EQ(5, *set.erase(set.find(4)));
+
+    const std::vector<uint32_t> expected{3, 5, 7, 9};
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), set.begin()));
+    EXPECT_TRUE(std::equal(expected.rbegin(), expected.rend(), set.rbegin()));
+    EXPECT_EQ(expected.size(), std::distance(set.begin(), set.end()));
+}
+
+TEST(compact_set_test, iteratorsSurviveSplaying) {
+    compact_set<int> set;
+    for (int i = 0; i < 100; ++i) {
+        set.insert(i);
+    }
+    auto it = set.find(50);
+    ++it;
+    EXPECT_EQ(51, *it);
+
+    // Every lookup restructures the tree, the iterator still finds its
+    // neighbours.
+    set.find(0);
+    set.lower_bound(99);
+    set.insert(1000);
+    set.erase(52);
+    ++it;
+    EXPECT_EQ(53, *it);
+    --it;
+    --it;
+    EXPECT_EQ(50, *it);
+
+    auto last = set.end();
+    --last;
+    EXPECT_EQ(1000, *last);
+}
+
+TEST(compact_set_test, iteratesAfterAscendingInserts) {
+    // Ascending inserts leave a path as long as the set, which iterators must
+    // walk in amortized constant time per step: searching for every
+    // neighbour from the root would take minutes here.
+    const uint32_t size = 200000;
+    compact_set<uint32_t> set;
+    for (uint32_t i = 0; i < size; ++i) {
+        set.insert(i);
+    }
+
+    uint32_t expected = 0;
+    for (uint32_t key : set) {
+        ASSERT_EQ(expected, key);
+        ++expected;
+    }
+    EXPECT_EQ(size, expected);
+
+    for (auto it = set.rbegin(); it != set.rend(); ++it) {
+        ASSERT_EQ(expected - 1, *it);
+        --expected;
+    }
+    EXPECT_EQ(0, expected);
+
+    EXPECT_EQ(set.end(), set.rbegin().base());
+    EXPECT_EQ(set.begin(), set.rend().base());
+    EXPECT_EQ(0, *--set.rend());
+}
+
+TEST(compact_set_test, constructionFromSorted) {
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(3 * i);
+    }
+    compact_set<int> set(from_sorted, keys.begin(), keys.end());
+    EXPECT_EQ(keys.size(), set.size());
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), set.begin()));
+    EXPECT_EQ(300, *set.find(300));
+    EXPECT_TRUE(set.insert(301).second);
+    EXPECT_EQ(303, *std::next(set.find(301)));
+    EXPECT_TRUE(set == compact_set<int>(set));
+}
+
+TEST(compact_set_test, reusesErasedNodes) {
+    compact_set<int> set;
+    set.reserve(64);
+    for (int i = 0; i < 64; ++i) {
+        set.insert(i);
+    }
+    for (int i = 0; i < 64; i += 2) {
+        set.erase(i);
+    }
+    for (int i = 100; i < 132; ++i) {
+        set.insert(i);
+    }
+    EXPECT_EQ(64, set.size());
+    EXPECT_EQ(64, set.capacity());
+}
+
+TEST(compact_set_test, stressTestWithSet) {
+    compact_set<int> compactSet;
+    std::set<int> stlSet;
+
+    std::mt19937 mt(29);
+    std::uniform_int_distribution<int> randomInt(-500, 500);
+    for (int i = 0; i < 20000; ++i) {
+        const int key = randomInt(mt);
+        switch (mt() % 5) {
+            case 0:
+                EXPECT_EQ(stlSet.insert(key).second, compactSet.insert(key).second);
+                break;
+            case 1:
+                EXPECT_EQ(stlSet.erase(key), compactSet.erase(key));
+                break;
+            case 2:
+                EXPECT_EQ(stlSet.count(key), compactSet.count(key));
+                break;
+            case 3:
+                {
+                    auto expected = stlSet.lower_bound(key);
+                    auto actual = compactSet.lower_bound(key);
+                    EXPECT_EQ(expected == stlSet.end(), actual == compactSet.end());
+                    if (expected != stlSet.end() && actual != compactSet.end()) {
+                        EXPECT_EQ(*expected, *actual);
+                    }
+                }
+                break;
+            case 4:
+                {
+                    auto expected = stlSet.upper_bound(key);
+                    auto actual = compactSet.upper_bound(key);
+                    EXPECT_EQ(expected == stlSet.end(), actual == compactSet.end());
+                    if (expected != stlSet.end() && actual != compactSet.end()) {
+                        EXPECT_EQ(*expected, *actual);
+                    }
+                }
+                break;
+        }
+        EXPECT_EQ(stlSet.size(), compactSet.size());
+    }
+    EXPECT_TRUE(std::equal(stlSet.begin(), stlSet.end(), compactSet.begin()));
+    EXPECT_TRUE(std::equal(stlSet.rbegin(), stlSet.rend(), compactSet.rbegin()));
+}
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+#include "splay-tree/concurrent-set.h"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace splay_tree;
+
+TEST(concurrent_set_test, hashPartitioned) {
+    concurrent_set<int> set(8);
+    EXPECT_EQ(8, set.shard_count());
+    EXPECT_TRUE(set.empty());
+    for (int key = 0; key < 100; ++key) {
+        EXPECT_TRUE(set.insert(key));
+    }
+    EXPECT_FALSE(set.insert(42));
+    EXPECT_EQ(100, set.size());
+    EXPECT_TRUE(set.contains(99));
+    EXPECT_EQ(0, set.count(100));
+    EXPECT_EQ(1, set.erase(50));
+    EXPECT_EQ(0, set.erase(50));
+    EXPECT_FALSE(set.contains(50));
+
+    std::set<int> visited;
+    set.for_each([&](int key) {
+        visited.insert(key);
+    });
+    EXPECT_EQ(99, visited.size());
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_THROW(concurrent_set<int>(0), std::invalid_argument);
+}
+
+TEST(concurrent_set_test, rangePartitionedIteratesInOrder) {
+    const std::vector<int> boundaries{-10, 0, 10, 20};
+    concurrent_set<int> set(range_partitioned, boundaries.begin(), boundaries.end());
+    EXPECT_EQ(5, set.shard_count());
+    for (int key : {25, -20, 0, 15, -10, 9, 20, 3, -1, 100}) {
+        set.insert(key);
+    }
+
+    std::vector<int> visited;
+    set.for_each([&](int key) {
+        visited.push_back(key);
+    });
+    const std::vector<int> expected{-20, -10, -1, 0, 3, 9, 15, 20, 25, 100};
+    EXPECT_EQ(expected, visited);
+}
+
+TEST(concurrent_set_test, concurrentInsertionsAndErasures) {
+    concurrent_set<int> set(16);
+    const int threadCount = 8;
+    const int keysPerThread = 2000;
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < threadCount; ++thread) {
+        threads.emplace_back([&set, thread]() {
+            const int first = thread * keysPerThread;
+            for (int key = first; key < first + keysPerThread; ++key) {
+                set.insert(key);
+                set.contains(key - 1);
+            }
+            // Every thread erases the odd keys of its neighbour, which may
+            // still be inserting them.
+            const int neighbour = ((thread + 1) % threadCount) * keysPerThread;
+            for (int key = neighbour + 1; key < neighbour + keysPerThread; key += 2) {
+                while (!set.erase(key)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(threadCount * keysPerThread / 2, set.size());
+    for (int key = 0; key < threadCount * keysPerThread; ++key) {
+        EXPECT_EQ(key % 2 == 0, set.contains(key));
+    }
+}
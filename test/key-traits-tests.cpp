@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "splay-tree/key-traits.h"
+#include "splay-tree/multiset.h"
+#include "splay-tree/set.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace splay_tree;
+
+namespace {
+
+// Strings that often share their first eight bytes, some shorter than that or
+// with zero bytes, so that prefixes tie in every way.
+std::vector<std::string> makeKeys(size_t count) {
+    std::mt19937 generator(count);
+    std::uniform_int_distribution<int> length(0, 12);
+    std::uniform_int_distribution<int> byte(0, 3);
+    std::vector<std::string> keys(count);
+    for (auto& key : keys) {
+        key.resize(length(generator));
+        for (auto& c : key) {
+            c = "\0ab\xff"[byte(generator)];
+        }
+    }
+    return keys;
+}
+
+} // namespace
+
+TEST(key_traits_test, stringPrefixesAgreeWithLess) {
+    const auto keys = makeKeys(2000);
+    for (size_t i = 0; i + 1 < keys.size(); ++i) {
+        const auto lhs = StringKeyTraits::prefix(keys[i]);
+        const auto rhs = StringKeyTraits::prefix(keys[i + 1]);
+        if (lhs < rhs) {
+            EXPECT_LT(keys[i], keys[i + 1]);
+        } else if (rhs < lhs) {
+            EXPECT_LT(keys[i + 1], keys[i]);
+        }
+    }
+    EXPECT_EQ(StringKeyTraits::prefix("abcdefgh"), StringKeyTraits::prefix("abcdefghij"));
+    EXPECT_LT(StringKeyTraits::prefix("abc"), StringKeyTraits::prefix("abd"));
+}
+
+TEST(key_traits_test, setWithPrefixes) {
+    const auto keys = makeKeys(5000);
+    set<std::string, StringPrefixLess> set;
+    std::set<std::string> expected;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const auto& key = keys[i];
+        if (i % 3 == 2) {
+            EXPECT_EQ(expected.erase(key), set.erase(key));
+        } else {
+            EXPECT_EQ(expected.insert(key).second, set.insert(key).second);
+        }
+        const auto lowerBound = expected.lower_bound(keys[keys.size() - 1 - i]);
+        const auto it = set.lower_bound(keys[keys.size() - 1 - i]);
+        ASSERT_EQ(lowerBound == expected.end(), it == set.end());
+        if (it != set.end()) {
+            EXPECT_EQ(*lowerBound, *it);
+        }
+    }
+    EXPECT_EQ(expected.size(), set.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), set.begin()));
+    for (const auto& key : keys) {
+        EXPECT_EQ(expected.count(key), set.count(key));
+        const auto upperBound = expected.upper_bound(key);
+        const auto it = set.upper_bound(key);
+        ASSERT_EQ(upperBound == expected.end(), it == set.end());
+        if (it != set.end()) {
+            EXPECT_EQ(*upperBound, *it);
+        }
+    }
+}
+
+TEST(key_traits_test, multisetWithPrefixes) {
+    const auto keys = makeKeys(3000);
+    multiset<std::string, StringPrefixLess> multiset(keys.begin(), keys.end());
+    std::multiset<std::string> expected(keys.begin(), keys.end());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), multiset.begin()));
+    for (const auto& key : keys) {
+        EXPECT_EQ(expected.count(key), multiset.count(key));
+    }
+}
+
+TEST(key_traits_test, reinsertedNodesTakeTheirNewPrefix) {
+    set<std::string, StringPrefixLess> set{"aaaaaaaa1", "bbbbbbbb", "cccccccc"};
+    auto node = set.extract("aaaaaaaa1");
+    node.value() = "dddddddd";
+    EXPECT_TRUE(set.insert(std::move(node)).inserted);
+    EXPECT_EQ(set.end(), set.find("aaaaaaaa1"));
+    EXPECT_EQ("dddddddd", *set.find("dddddddd"));
+    EXPECT_EQ("dddddddd", *set.upper_bound("cccccccc"));
+}
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+TEST(key_traits_test, prefixesSaveComparisons) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 1000; ++i) {
+        keys.push_back(std::to_string(1000000 + i * 7919 % 1000));
+    }
+    set<std::string> plain;
+    set<std::string, StringPrefixLess> prefixed;
+    for (const auto& key : keys) {
+        plain.insert(key);
+        prefixed.insert(key);
+        plain.lower_bound(key);
+        prefixed.lower_bound(key);
+    }
+    EXPECT_TRUE(std::equal(plain.begin(), plain.end(), prefixed.begin()));
+    EXPECT_LT(prefixed.stats().comparisons * 2, plain.stats().comparisons);
+}
+#endif
@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+#include "splay-tree/map.h"
+#include "splay-tree/multimap.h"
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace splay_tree;
+
+namespace {
+
+struct CountedValue {
+    static int constructions;
+
+    CountedValue() :
+        value(0) {
+        ++constructions;
+    }
+
+    explicit CountedValue(int value) :
+        value(value) {
+        ++constructions;
+    }
+
+    int value;
+};
+
+int CountedValue::constructions = 0;
+
+} // namespace
+
+TEST(map_test, subscriptOperator) {
+    map<std::string, int> wordCounts;
+    for (const char* word : {"b", "a", "b", "c", "b", "a"}) {
+        ++wordCounts[word];
+    }
+    EXPECT_EQ(3, wordCounts.size());
+    EXPECT_EQ(2, wordCounts["a"]);
+    EXPECT_EQ(3, wordCounts["b"]);
+    EXPECT_EQ(1, wordCounts["c"]);
+    EXPECT_EQ(0, wordCounts["d"]);
+    EXPECT_EQ(4, wordCounts.size());
+
+    auto it = wordCounts.begin();
+    EXPECT_EQ("a", it->first);
+    it->second = 10;
+    EXPECT_EQ(10, wordCounts.at("a"));
+    --it;
+    it++;
+    it--;
+    EXPECT_EQ(wordCounts.end(), std::next(it));
+    EXPECT_EQ("d", it->first);
+}
+
+TEST(map_test, tryEmplaceConstructsOnlyMissing) {
+    map<int, CountedValue> values;
+    CountedValue::constructions = 0;
+
+    EXPECT_TRUE(values.try_emplace(1, 10).second);
+    EXPECT_EQ(1, CountedValue::constructions);
+    auto result = values.try_emplace(1, 20);
+    EXPECT_FALSE(result.second);
+    EXPECT_EQ(10, result.first->second.value);
+    EXPECT_EQ(1, CountedValue::constructions);
+
+    values[1];
+    EXPECT_EQ(1, CountedValue::constructions);
+    values[2];
+    EXPECT_EQ(2, CountedValue::constructions);
+
+    // emplace() constructs the element before looking for the key.
+    EXPECT_FALSE(values.emplace(2, CountedValue(30)).second);
+    EXPECT_EQ(0, values[2].value);
+}
+
+TEST(map_test, tryEmplaceLeavesMovedKeyIfPresent) {
+    map<std::string, int> values{{"key", 1}};
+    std::string key = "key";
+    EXPECT_FALSE(values.try_emplace(std::move(key), 2).second);
+    EXPECT_EQ("key", key);
+    EXPECT_EQ(1, values["key"]);
+}
+
+TEST(map_test, insertOrAssign) {
+    map<int, std::string> values;
+    EXPECT_TRUE(values.insert_or_assign(1, "one").second);
+    auto result = values.insert_or_assign(1, "uno");
+    EXPECT_FALSE(result.second);
+    EXPECT_EQ("uno", result.first->second);
+    EXPECT_EQ(1, values.size());
+}
+
+TEST(map_test, atThrowsOnMissingKey) {
+    map<int, int> values{{1, 2}, {3, 4}};
+    const auto& constValues = values;
+    EXPECT_EQ(4, constValues.at(3));
+    EXPECT_THROW(values.at(2), std::out_of_range);
+    EXPECT_THROW(constValues.at(2), std::out_of_range);
+}
+
+TEST(multimap_test, equalKeys) {
+    multimap<int, std::string> values{{2, "b"}, {1, "a"}, {2, "c"}};
+    values.insert({2, "d"});
+    values.emplace(3, "e");
+    EXPECT_EQ(5, values.size());
+    EXPECT_EQ(3, values.count(2));
+
+    auto range = values.equal_range(2);
+    std::string mapped;
+    for (auto it = range.first; it != range.second; ++it) {
+        mapped += it->second;
+    }
+    EXPECT_EQ("bcd", mapped);
+
+    EXPECT_EQ(3, values.erase(2));
+    EXPECT_EQ(2, values.size());
+    EXPECT_EQ("e", values.find(3)->second);
+}
+
+TEST(multimap_test, extractRange) {
+    multimap<int, std::string> values{
+        {1, "a"}, {2, "b"}, {2, "c"}, {3, "d"}, {4, "e"}};
+    auto extracted = values.extract_range(2, 4);
+    EXPECT_EQ(3, extracted.size());
+    EXPECT_EQ(2, values.size());
+    EXPECT_EQ("bcd", extracted.begin()->second + (++extracted.begin())->second +
+        (--extracted.end())->second);
+    EXPECT_EQ(1, values.begin()->first);
+    EXPECT_EQ(4, (--values.end())->first);
+
+    map<int, std::string> empty{{1, "a"}};
+    EXPECT_EQ(0, empty.extract_range(2, 5).size());
+    EXPECT_EQ(0, empty.extract_range(1, 0).size());
+    EXPECT_EQ(1, empty.size());
+}
+
+TEST(map_test, movesAreNoexcept) {
+    typedef map<int, std::string> Map;
+    static_assert(std::is_nothrow_move_constructible<Map>::value, "");
+    static_assert(std::is_nothrow_move_assignable<Map>::value, "");
+    static_assert(noexcept(swap(std::declval<Map&>(), std::declval<Map&>())), "");
+
+    std::vector<Map> shards(1);
+    shards[0][1] = "a";
+    const std::string* address = &shards[0].begin()->second;
+    shards.resize(shards.capacity() + 1);
+    EXPECT_EQ(address, &shards[0].begin()->second);
+}
+
+TEST(map_test, stressTestWithMap) {
+    map<int, int> splayMap;
+    std::map<int, int> stlMap;
+
+    std::mt19937 mt(11);
+    std::uniform_int_distribution<int> randomInt(-300, 300);
+    for (int i = 0; i < 20000; ++i) {
+        const int key = randomInt(mt);
+        switch (mt() % 5) {
+            case 0:
+                EXPECT_EQ(
+                    stlMap.insert({key, i}).second,
+                    splayMap.insert({key, i}).second);
+                break;
+            case 1:
+                EXPECT_EQ(stlMap.erase(key), splayMap.erase(key));
+                break;
+            case 2:
+                stlMap[key] += i;
+                splayMap[key] += i;
+                break;
+            case 3:
+                {
+                    auto expected = stlMap.lower_bound(key);
+                    auto actual = splayMap.lower_bound(key);
+                    EXPECT_EQ(expected == stlMap.end(), actual == splayMap.end());
+                    if (expected != stlMap.end() && actual != splayMap.end()) {
+                        EXPECT_EQ(*expected, *actual);
+                    }
+                }
+                break;
+            case 4:
+                {
+                    auto expected = stlMap.find(key);
+                    auto actual = splayMap.find(key);
+                    EXPECT_EQ(expected == stlMap.end(), actual == splayMap.end());
+                    if (expected != stlMap.end() && actual != splayMap.end()) {
+                        EXPECT_EQ(expected->second, actual->second);
+                    }
+                }
+                break;
+        }
+        EXPECT_EQ(stlMap.size(), splayMap.size());
+    }
+    EXPECT_TRUE(std::equal(stlMap.begin(), stlMap.end(), splayMap.begin()));
+    EXPECT_TRUE(std::equal(stlMap.rbegin(), stlMap.rend(), splayMap.rbegin()));
+}
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "splay-tree/mapped-set.h"
+#include "splay-tree/multiset.h"
+#include "splay-tree/set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace splay_tree;
+
+namespace {
+
+std::string snapshotPath(const char* name) {
+    return testing::TempDir() + name;
+}
+
+} // namespace
+
+TEST(mapped_set_test, writeAndOpen) {
+    set<uint64_t> keys;
+    for (uint64_t key = 0; key < 1000; ++key) {
+        keys.insert(key * 7 % 1000 * 2);
+    }
+    const std::string path = snapshotPath("mapped-set-test.snapshot");
+    mapped_set<uint64_t>::write(keys, path);
+
+    auto snapshot = mapped_set<uint64_t>::open(path);
+    EXPECT_EQ(1000, snapshot.size());
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), snapshot.begin()));
+    EXPECT_EQ(1998, *snapshot.rbegin());
+    for (uint64_t key = 0; key < 2002; ++key) {
+        EXPECT_EQ(key % 2 == 0 && key < 2000, snapshot.contains(key));
+        const auto lowerBound = snapshot.lower_bound(key);
+        const auto expected = keys.lower_bound(key);
+        if (expected == keys.end()) {
+            EXPECT_EQ(snapshot.end(), lowerBound);
+        } else {
+            EXPECT_EQ(*expected, *lowerBound);
+        }
+    }
+    EXPECT_EQ(snapshot.end(), snapshot.upper_bound(1998));
+    EXPECT_EQ(snapshot.end(), snapshot.find(1));
+
+    // Promotion builds a mutable set without comparisons.
+    set<uint64_t> promoted(from_sorted, snapshot.begin(), snapshot.end());
+    EXPECT_EQ(keys.size(), promoted.size());
+    promoted.insert(1);
+    EXPECT_TRUE(promoted.find(1) != promoted.end());
+    EXPECT_FALSE(snapshot.contains(1));
+
+    auto moved = std::move(snapshot);
+    EXPECT_TRUE(snapshot.empty());
+    EXPECT_EQ(0, *moved.begin());
+}
+
+TEST(mapped_set_test, duplicatesAndEmpty) {
+    multiset<int> keys{3, 1, 3, 2, 3};
+    const std::string path = snapshotPath("mapped-multiset-test.snapshot");
+    mapped_set<int>::write(keys, path);
+    auto snapshot = mapped_set<int>::open(path);
+    EXPECT_EQ(5, snapshot.size());
+    EXPECT_EQ(3, snapshot.count(3));
+    EXPECT_EQ(0, snapshot.count(4));
+    EXPECT_EQ(2, std::distance(snapshot.begin(), snapshot.lower_bound(3)));
+
+    const std::string emptyPath = snapshotPath("mapped-empty-test.snapshot");
+    mapped_set<int>::write(set<int>(), emptyPath);
+    auto empty = mapped_set<int>::open(emptyPath);
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.end(), empty.find(0));
+    EXPECT_EQ(empty.begin(), empty.end());
+}
+
+TEST(mapped_set_test, rejectsOtherData) {
+    const std::string path = snapshotPath("mapped-set-test.snapshot");
+    mapped_set<uint64_t>::write(set<uint64_t>{1, 2, 3}, path);
+    EXPECT_THROW(mapped_set<uint32_t>::open(path), std::runtime_error);
+    EXPECT_THROW(mapped_set<uint64_t>::open(path + ".missing"), std::runtime_error);
+
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::vector<uint64_t> aligned(bytes.size() / sizeof(uint64_t));
+    std::copy(bytes.begin(), bytes.end(), reinterpret_cast<char*>(aligned.data()));
+    mapped_set<uint64_t> inMemory(aligned.data(), bytes.size());
+    EXPECT_TRUE(inMemory.contains(2));
+    EXPECT_THROW(
+        mapped_set<uint64_t>(aligned.data(), bytes.size() - 1),
+        std::runtime_error);
+    reinterpret_cast<char*>(aligned.data())[0] = 'X';
+    EXPECT_THROW(
+        mapped_set<uint64_t>(aligned.data(), bytes.size()),
+        std::runtime_error);
+}
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "splay-tree/pool-allocator.h"
+#include "splay-tree/set.h"
+#include "splay-tree/multiset.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace splay_tree;
+
+TEST(pool_allocator_test, reusesFreedObjects) {
+    pool_allocator<int> allocator;
+    int* first = allocator.allocate(1);
+    int* second = allocator.allocate(1);
+    EXPECT_NE(first, second);
+    EXPECT_LE(2, allocator.capacity());
+
+    allocator.deallocate(first, 1);
+    int* third = allocator.allocate(1);
+    EXPECT_EQ(first, third);
+
+    int* array = allocator.allocate(10);
+    allocator.deallocate(array, 10);
+
+    allocator.deallocate(second, 1);
+    allocator.deallocate(third, 1);
+    EXPECT_EQ(64, allocator.capacity());
+}
+
+TEST(pool_allocator_test, keepsTheFirstSlabWhenEmpty) {
+    pool_allocator<int> allocator;
+    std::vector<int*> objects;
+    for (int i = 0; i < 1000; ++i) {
+        objects.push_back(allocator.allocate(1));
+    }
+    EXPECT_LE(1000, allocator.capacity());
+    for (int* object : objects) {
+        allocator.deallocate(object, 1);
+    }
+
+    // Only the first slab is left, and it is reused from its start.
+    EXPECT_EQ(64, allocator.capacity());
+    for (int i = 0; i < 100; ++i) {
+        int* object = allocator.allocate(1);
+        EXPECT_EQ(objects.front(), object);
+        allocator.deallocate(object, 1);
+    }
+    EXPECT_EQ(64, allocator.capacity());
+}
+
+TEST(pool_allocator_test, copiesAndRebindsShareThePool) {
+    pool_allocator<int> allocator;
+    pool_allocator<int> copy(allocator);
+    pool_allocator<double> rebound(allocator);
+    EXPECT_TRUE(allocator == copy);
+    EXPECT_TRUE(allocator == rebound);
+    EXPECT_TRUE(pool_allocator<int>(rebound) == allocator);
+    EXPECT_TRUE(allocator != pool_allocator<int>());
+
+    int* object = allocator.allocate(1);
+    EXPECT_LE(1, copy.capacity());
+    copy.deallocate(object, 1);
+
+    EXPECT_TRUE(allocator != allocator.select_on_container_copy_construction());
+}
+
+TEST(pool_allocator_test, setReleasesSlabsOnClear) {
+    typedef set<int, std::less<int>, pool_allocator<int>> PoolSet;
+    pool_allocator<int> allocator;
+    PoolSet set(std::less<int>(), allocator);
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(i * 7 % 1000);
+    }
+    EXPECT_EQ(1000, set.size());
+
+    PoolSet copy(set);
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), copy.begin()));
+
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_EQ(1000, copy.size());
+    copy.insert(1000);
+    EXPECT_EQ(1001, copy.size());
+}
+
+TEST(pool_allocator_test, reserveIsContiguous) {
+    pool_allocator<long> allocator;
+    allocator.reserve(1000);
+    EXPECT_LE(1000, allocator.capacity());
+    long* first = allocator.allocate(1);
+    long* previous = first;
+    for (int i = 1; i < 1000; ++i) {
+        long* object = allocator.allocate(1);
+        EXPECT_EQ(previous + 1, object);
+        previous = object;
+    }
+    EXPECT_EQ(1000, allocator.capacity());
+}
+
+TEST(pool_allocator_test, copiedSetIsContiguous) {
+    typedef set<int, std::less<int>, pool_allocator<int>> PoolSet;
+    PoolSet set;
+    for (int i = 0; i < 5000; ++i) {
+        set.insert(i * 7 % 5000);
+    }
+
+    // The copy allocates its nodes from one reserved block.
+    const PoolSet copy(set);
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), copy.begin()));
+    std::vector<const char*> addresses;
+    for (const int& key : copy) {
+        addresses.push_back(reinterpret_cast<const char*>(&key));
+    }
+    std::sort(addresses.begin(), addresses.end());
+    const ptrdiff_t stride = addresses[1] - addresses[0];
+    EXPECT_LT(0, stride);
+    for (size_t i = 1; i < addresses.size(); ++i) {
+        EXPECT_EQ(stride, addresses[i] - addresses[i - 1]);
+    }
+}
+
+TEST(pool_allocator_test, stressTestWithSet) {
+    typedef multiset<std::string, std::less<std::string>, pool_allocator<std::string>>
+        PoolMultiSet;
+    PoolMultiSet splayTreeMultiSet;
+    std::multiset<std::string> stlMultiSet;
+
+    std::mt19937 mt(7);
+    std::uniform_int_distribution<int> randomInt(0, 300);
+    for (int i = 0; i < 20000; ++i) {
+        const std::string key = std::to_string(randomInt(mt));
+        if (randomInt(mt) % 3) {
+            splayTreeMultiSet.insert(key);
+            stlMultiSet.insert(key);
+        } else {
+            EXPECT_EQ(stlMultiSet.erase(key), splayTreeMultiSet.erase(key));
+        }
+    }
+    ASSERT_EQ(stlMultiSet.size(), splayTreeMultiSet.size());
+    EXPECT_TRUE(std::equal(
+        stlMultiSet.begin(),
+        stlMultiSet.end(),
+        splayTreeMultiSet.begin()));
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "splay-tree/snapshot-set.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace splay_tree;
+
+TEST(snapshot_set_test, publishMakesChangesVisible) {
+    snapshot_set<int> set;
+    auto reader = set.make_reader();
+    for (int key : {5, 1, 3}) {
+        set.insert(key);
+    }
+    EXPECT_TRUE(set.contains(3));
+    EXPECT_TRUE(reader.acquire().empty());
+
+    set.publish();
+    {
+        auto view = reader.acquire();
+        EXPECT_EQ(3, view.size());
+        EXPECT_TRUE(view.contains(5));
+        EXPECT_FALSE(view.contains(4));
+        EXPECT_EQ(5, *view.lower_bound(4));
+        EXPECT_EQ(view.end(), view.upper_bound(5));
+        EXPECT_EQ(1, *view.begin());
+
+        // The pinned view is unaffected by later publications.
+        set.erase(1);
+        set.insert(7);
+        set.publish();
+        set.publish();
+        const std::vector<int> expected{1, 3, 5};
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), view.begin()));
+    }
+    auto view = reader.acquire();
+    const std::vector<int> expected{3, 5, 7};
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), view.begin()));
+}
+
+TEST(snapshot_set_test, readerSlots) {
+    snapshot_set<int> set(2);
+    auto first = set.make_reader();
+    {
+        auto second = set.make_reader();
+        EXPECT_THROW(set.make_reader(), std::length_error);
+    }
+    auto third = set.make_reader();
+    set.insert(1);
+    set.publish();
+    EXPECT_TRUE(third.acquire().contains(1));
+}
+
+TEST(snapshot_set_test, concurrentReaders) {
+    snapshot_set<int> set;
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+
+    std::vector<std::thread> readers;
+    for (int thread = 0; thread < 4; ++thread) {
+        readers.emplace_back([&]() {
+            auto reader = set.make_reader();
+            size_t lastSize = 0;
+            while (!done.load()) {
+                // The writer publishes the keys 0 to n - 1 for a growing n.
+                auto view = reader.acquire();
+                const size_t size = view.size();
+                if (size < lastSize || (size > 0 && (
+                        !view.contains(0) ||
+                        !view.contains(static_cast<int>(size) - 1) ||
+                        view.contains(static_cast<int>(size))))) {
+                    ++failures;
+                }
+                lastSize = size;
+            }
+        });
+    }
+
+    for (int key = 0; key < 2000; ++key) {
+        set.insert(key);
+        set.contains(key / 2);
+        if (key % 10 == 0) {
+            set.publish();
+        }
+    }
+    set.publish();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(0, failures.load());
+    EXPECT_EQ(2000, set.make_reader().acquire().size());
+}
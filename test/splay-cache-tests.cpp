@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "splay-tree/splay-cache.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace splay_tree;
+
+TEST(splay_cache_test, countsHitsAndMisses) {
+    splay_cache<int, std::string> cache(4);
+    EXPECT_TRUE(cache.insert({1, "one"}).second);
+    EXPECT_TRUE(cache.emplace(2, "two").second);
+    EXPECT_FALSE(cache.insert({1, "uno"}).second);
+    EXPECT_EQ("one", cache.find(1)->second);
+    EXPECT_EQ(cache.end(), cache.find(3));
+    EXPECT_EQ(1, cache.hits());
+    EXPECT_EQ(1, cache.misses());
+
+    EXPECT_FALSE(cache.insert_or_assign(2, "dos").second);
+    EXPECT_EQ("dos", cache.find(2)->second);
+    EXPECT_TRUE(cache.insert_or_assign(3, "tres").second);
+    EXPECT_EQ(3, cache.size());
+    EXPECT_EQ(1, cache.erase(3));
+    EXPECT_EQ(0, cache.evictions());
+
+    cache.reset_counters();
+    EXPECT_EQ(0, cache.hits());
+    EXPECT_EQ(0, cache.misses());
+    typedef splay_cache<int, int> IntCache;
+    EXPECT_THROW(IntCache(0), std::invalid_argument);
+}
+
+TEST(splay_cache_test, evictsDeepestAndKeepsLastUsed) {
+    splay_cache<int, int> cache(8);
+    for (int key = 0; key < 8; ++key) {
+        cache.insert({key, key});
+    }
+    // Ascending insertions leave a path down to the first key.
+    EXPECT_TRUE(cache.insert({8, 8}).second);
+    EXPECT_EQ(8, cache.size());
+    EXPECT_EQ(1, cache.evictions());
+    EXPECT_EQ(cache.end(), cache.find(0));
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> keys(0, 63);
+    for (int i = 0; i < 10000; ++i) {
+        const int key = keys(generator);
+        if (cache.find(key) == cache.end()) {
+            cache.insert({key, key});
+        }
+        ASSERT_LE(cache.size(), cache.capacity());
+        ASSERT_NE(cache.end(), cache.find(key));
+    }
+    EXPECT_EQ(cache.misses(), cache.evictions());
+
+    cache.set_capacity(3);
+    EXPECT_EQ(3, cache.size());
+    int previous = -1;
+    for (const auto& element : cache) {
+        EXPECT_LT(previous, element.first);
+        EXPECT_EQ(element.first, element.second);
+        previous = element.first;
+    }
+}
+
+TEST(splay_cache_test, hotKeysStay) {
+    splay_cache<int, int> cache(32);
+    for (int i = 0; i < 100000; ++i) {
+        cache.insert({i % 4, 0});
+        cache.insert({1000 + i, 0});
+    }
+    for (int key = 0; key < 4; ++key) {
+        EXPECT_NE(cache.end(), cache.find(key));
+    }
+    EXPECT_EQ(32, cache.size());
+}
@@ -1,11 +1,66 @@
 #include "gtest/gtest.h"
 #include "splay-tree/splay-tree.h"
 #include "splay-tree/key-of-value.h"
+#include "splay-tree/parallel.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
 #include <string>
+#include <vector>
 
 using namespace splay_tree;
 
+namespace {
+
+// A stateful allocator that stays with its container on moves and swaps.
+template<typename T>
+struct TaggedAllocator {
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind {
+        typedef TaggedAllocator<U> other;
+    };
+
+    explicit TaggedAllocator(int tag = 0) :
+        tag(tag) {
+    }
+
+    template<typename U>
+    TaggedAllocator(const TaggedAllocator<U>& rhs) :
+        tag(rhs.tag) {
+    }
+
+    T* allocate(size_t n) {
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* pointer, size_t n) {
+        std::allocator<T>().deallocate(pointer, n);
+    }
+
+    int tag;
+};
+
+template<typename T, typename U>
+bool operator==(const TaggedAllocator<T>& lhs, const TaggedAllocator<U>& rhs) {
+    return lhs.tag == rhs.tag;
+}
+
+template<typename T, typename U>
+bool operator!=(const TaggedAllocator<T>& lhs, const TaggedAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
+
+} // namespace
+
 TEST(splay_tree_test, insertUnique) {
     SplayTree<int, int, Identity> set;
     auto val1 = set.insertUnique(1);
@@ -102,17 +157,101 @@ TEST(splay_tree_test, split) {
         }
     }
 
-    std::vector<int> set2Excepted{4, 5};
-    EXPECT_EQ(2, set1.size());
+    std::vector<int> set2Excepted{4, 4, 5};
+    EXPECT_EQ(3, set2.size());
     {
         auto itSet = set2.cbegin();
         auto itVec = set2Excepted.cbegin();
-        for (; itSet != set1.cend(); ++itSet, ++itVec) {
+        for (; itSet != set2.cend(); ++itSet, ++itVec) {
             EXPECT_EQ(*itVec, *itSet);
         }
     }
 }
 
+template<typename Tree>
+void checkSizesAfterSplit() {
+    Tree left;
+    for (int i = 0; i < 100; ++i) {
+        left.insertUnique(i);
+    }
+
+    // Both parts are changed before their sizes are asked for.
+    auto right = left.split(40);
+    left.erase(7);
+    left.insertUnique(100);
+    right.erase(right.begin());
+    right.erase(99);
+    EXPECT_EQ(40, left.size());
+    EXPECT_EQ(58, right.size());
+    EXPECT_EQ(100, *--left.end());
+    EXPECT_EQ(41, *right.begin());
+
+    auto last = right.split(90);
+    right.erase(50);
+    left.erase(100);
+    left.mergeUnique(std::move(right));
+    EXPECT_EQ(87, left.size());
+    EXPECT_EQ(9, last.size());
+    int expected = 0;
+    for (int key : left) {
+        expected += expected == 7 || expected == 40 || expected == 50;
+        EXPECT_EQ(expected++, key);
+    }
+    EXPECT_EQ(90, expected);
+}
+
+TEST(splay_tree_test, sizesAfterSplit) {
+    checkSizesAfterSplit<SplayTree<int, int, Identity>>();
+    checkSizesAfterSplit<SplayTree<int, int, Identity, std::less<int>,
+        std::allocator<int>, SubtreeSizeNodeUpdate>>();
+}
+
+template<typename Tree>
+void checkRangeErase() {
+    Tree tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insertUnique(i);
+    }
+
+    // A prefix, a middle part and a suffix.
+    auto it = tree.erase(tree.begin(), tree.find(10));
+    EXPECT_EQ(10, *it);
+    it = tree.erase(tree.find(40), tree.find(60));
+    EXPECT_EQ(60, *it);
+    it = tree.erase(tree.find(90), tree.end());
+    EXPECT_EQ(tree.end(), it);
+    EXPECT_EQ(it, tree.erase(it, it));
+    EXPECT_EQ(60, tree.size());
+    EXPECT_EQ(10, *tree.begin());
+    EXPECT_EQ(89, *--tree.end());
+
+    auto extracted = tree.extractRange(20, 65);
+    EXPECT_EQ(25, extracted.size());
+    EXPECT_EQ(35, tree.size());
+    EXPECT_EQ(20, *extracted.begin());
+    EXPECT_EQ(64, *--extracted.end());
+    EXPECT_EQ(0, tree.extractRange(20, 65).size());
+    EXPECT_EQ(0, tree.extractRange(80, 70).size());
+
+    int expected = 10;
+    for (int key : tree) {
+        expected = expected == 20 ? 65 : expected;
+        EXPECT_EQ(expected++, key);
+    }
+    EXPECT_EQ(90, expected);
+
+    tree.erase(tree.begin(), tree.end());
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0, tree.size());
+    EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(splay_tree_test, rangeErase) {
+    checkRangeErase<SplayTree<int, int, Identity>>();
+    checkRangeErase<SplayTree<int, int, Identity, std::less<int>,
+        std::allocator<int>, SubtreeSizeNodeUpdate>>();
+}
+
 TEST(splay_tree_test, mergeUnique) {
     SplayTree<int, int, Identity> set1;
     set1.insertUnique(1);
@@ -140,7 +279,7 @@ TEST(splay_tree_test, mergeUnique) {
     {
         auto itSet = set2.cbegin();
         auto itVec = preservedSet2.cbegin();
-        for (; itSet != set1.cend(); ++itSet, ++itVec) {
+        for (; itSet != set2.cend(); ++itSet, ++itVec) {
             EXPECT_EQ(*itVec, *itSet);
         }
     }
@@ -169,3 +308,713 @@ TEST(splay_tree_test, mergeEqual) {
         }
     }
 }
+
+TEST(splay_tree_test, constructionFromSorted) {
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(2 * i);
+    }
+    SplayTree<int, int, Identity> set(from_sorted, keys.begin(), keys.end());
+    EXPECT_EQ(keys.size(), set.size());
+    EXPECT_EQ(0, *set.begin());
+    EXPECT_EQ(1998, *set.rbegin());
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), set.cbegin()));
+    EXPECT_EQ(1, set.count(500));
+    EXPECT_EQ(0, set.count(501));
+
+    SplayTree<int, int, Identity> emptySet(from_sorted, keys.end(), keys.end());
+    EXPECT_TRUE(emptySet.empty());
+    EXPECT_EQ(emptySet.end(), emptySet.begin());
+}
+
+TEST(splay_tree_test, insertSortedRange) {
+    SplayTree<int, int, Identity> set;
+    set.insertUnique(5);
+
+    // The sorted prefix {6, 7, 7, 9} is appended, duplicates are skipped and
+    // the rest of the range is inserted one by one.
+    std::vector<int> keys{6, 7, 7, 9, 1, 9, 8};
+    set.insertUnique(keys.begin(), keys.end());
+
+    std::vector<int> expected{1, 5, 6, 7, 8, 9};
+    EXPECT_EQ(expected.size(), set.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), set.cbegin()));
+    EXPECT_EQ(1, *set.begin());
+    EXPECT_EQ(9, *set.rbegin());
+
+    SplayTree<int, int, Identity> multiset;
+    multiset.insertEqual(keys.begin(), keys.end());
+    multiset.insertEqual(keys.begin(), keys.end());
+    std::vector<int> expectedMultiset{1, 1, 6, 6, 7, 7, 7, 7, 8, 8, 9, 9, 9, 9};
+    EXPECT_EQ(expectedMultiset.size(), multiset.size());
+    EXPECT_TRUE(std::equal(
+        expectedMultiset.begin(),
+        expectedMultiset.end(),
+        multiset.cbegin()));
+    EXPECT_EQ(4, multiset.count(7));
+}
+
+TEST(splay_tree_test, orderStatistics) {
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        SubtreeSizeNodeUpdate> set;
+    for (int key : {50, 10, 40, 20, 30}) {
+        set.insertUnique(key);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(10 * (i + 1), *set.nth(i));
+    }
+    EXPECT_EQ(set.end(), set.nth(5));
+    const auto& constSet = set;
+    EXPECT_EQ(30, *constSet.nth(2));
+
+    EXPECT_EQ(0, set.rank(5));
+    EXPECT_EQ(0, set.rank(10));
+    EXPECT_EQ(1, set.rank(11));
+    EXPECT_EQ(4, constSet.rank(50));
+    EXPECT_EQ(5, set.rank(51));
+
+    set.erase(30);
+    EXPECT_EQ(40, *set.nth(2));
+    EXPECT_EQ(2, set.rank(40));
+
+    auto right = set.split(20);
+    EXPECT_EQ(1, set.size());
+    EXPECT_EQ(3, right.size());
+    EXPECT_EQ(10, *set.nth(0));
+    EXPECT_EQ(50, *right.nth(2));
+
+    set.mergeUnique(std::move(right));
+    EXPECT_EQ(4, set.size());
+    EXPECT_EQ(20, *set.nth(1));
+    EXPECT_EQ(3, set.rank(50));
+}
+
+namespace {
+
+size_t allocatedObjectSize = 0;
+
+template<typename T>
+struct SizeRecordingAllocator : std::allocator<T> {
+    template<typename U>
+    struct rebind {
+        typedef SizeRecordingAllocator<U> other;
+    };
+
+    SizeRecordingAllocator() = default;
+
+    template<typename U>
+    SizeRecordingAllocator(const SizeRecordingAllocator<U>&) {
+    }
+
+    T* allocate(size_t n) {
+        allocatedObjectSize = sizeof(T);
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+struct PlainNode {
+    int value;
+    void* parent;
+    void* leftChild;
+    void* rightChild;
+};
+
+} // namespace
+
+TEST(splay_tree_test, nodeUpdateMemoryCost) {
+    SplayTree<int, int, Identity, std::less<int>, SizeRecordingAllocator<int>> set;
+    set.insertUnique(1);
+    EXPECT_EQ(sizeof(PlainNode), allocatedObjectSize);
+
+    SplayTree<int, int, Identity, std::less<int>, SizeRecordingAllocator<int>,
+        SubtreeSizeNodeUpdate> sizedSet;
+    sizedSet.insertUnique(1);
+    EXPECT_EQ(sizeof(PlainNode) + sizeof(size_t), allocatedObjectSize);
+}
+
+TEST(splay_tree_test, equalRangeWithDuplicates) {
+    SplayTree<int, int, Identity> multiset;
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        SubtreeSizeNodeUpdate> sizedMultiset;
+    const std::vector<int> keys{5, 1, 5, 3, 5, 5, 7, 3, 9, 5};
+    for (int key : keys) {
+        multiset.insertEqual(key);
+        sizedMultiset.insertEqual(key);
+    }
+
+    for (int key = 0; key <= 10; ++key) {
+        const size_t expected = std::count(keys.begin(), keys.end(), key);
+        EXPECT_EQ(expected, multiset.count(key));
+        EXPECT_EQ(expected, sizedMultiset.count(key));
+
+        auto range = multiset.equal_range(key);
+        EXPECT_EQ(multiset.lower_bound(key), range.first);
+        EXPECT_EQ(multiset.upper_bound(key), range.second);
+        EXPECT_EQ(expected, std::distance(range.first, range.second));
+
+        const auto& constSizedMultiset = sizedMultiset;
+        auto constRange = constSizedMultiset.equal_range(key);
+        EXPECT_EQ(constSizedMultiset.lower_bound(key), constRange.first);
+        EXPECT_EQ(constSizedMultiset.upper_bound(key), constRange.second);
+        EXPECT_EQ(expected, constSizedMultiset.count(key));
+    }
+}
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+TEST(splay_tree_test, splayPolicies) {
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        NullNodeUpdate, SplayOnWrite> splayOnWrite;
+    SplayTree<int, int, Identity> alwaysSplay;
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        NullNodeUpdate, SplayEveryKth<2>> everySecond;
+    for (int i = 0; i < 100; ++i) {
+        splayOnWrite.insertUnique(i);
+        alwaysSplay.insertUnique(i);
+        everySecond.insertUnique(i);
+    }
+
+    // Sequential insertions leave the smallest key at the bottom of a path.
+    const size_t splayOnWriteRotations = splayOnWrite.stats().rotations;
+    EXPECT_EQ(0, *splayOnWrite.lower_bound(0));
+    EXPECT_EQ(0, *splayOnWrite.find(0));
+    EXPECT_EQ(1, splayOnWrite.count(0));
+    EXPECT_EQ(splayOnWriteRotations, splayOnWrite.stats().rotations);
+
+    const size_t alwaysSplayRotations = alwaysSplay.stats().rotations;
+    EXPECT_EQ(0, *alwaysSplay.lower_bound(0));
+    EXPECT_LT(alwaysSplayRotations, alwaysSplay.stats().rotations);
+
+    const size_t everySecondSplays = everySecond.stats().splays;
+    everySecond.find(0);
+    everySecond.find(50);
+    everySecond.find(25);
+    everySecond.find(75);
+    EXPECT_EQ(everySecondSplays + 2, everySecond.stats().splays);
+}
+#endif
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+TEST(splay_tree_test, shapeStatistics) {
+    SplayTree<int, int, Identity> tree;
+    for (int i = 0; i < 64; ++i) {
+        tree.insertUnique(i);
+    }
+    // Ascending insertions splay every new maximum with a single zig step.
+    EXPECT_EQ(63, tree.stats().zigSteps);
+    EXPECT_EQ(0, tree.stats().zigZigSteps);
+    // The first insertion into the empty tree is no access.
+    EXPECT_EQ(63, tree.stats().accesses);
+    EXPECT_EQ(1, tree.stats().maxDepth);
+
+    tree.resetStats();
+    EXPECT_EQ(0, tree.stats().rotations);
+    EXPECT_EQ(0, tree.stats().comparisons);
+
+    // The minimum is at the bottom of the path, 63 levels deep.
+    tree.find(0);
+    const SplayTreeStats& stats = tree.stats();
+    EXPECT_EQ(1, stats.accesses);
+    EXPECT_EQ(63, stats.maxDepth);
+    EXPECT_EQ(63, stats.accessDepth);
+    EXPECT_EQ(1, stats.depthHistogram[6]);
+    EXPECT_EQ(63, stats.rotations);
+    EXPECT_EQ(31, stats.zigZigSteps);
+    EXPECT_EQ(1, stats.zigSteps);
+    EXPECT_LE(64, stats.comparisons);
+
+    // Lookups without restructuring count comparisons only.
+    const auto& constTree = tree;
+    const size_t comparisons = stats.comparisons;
+    constTree.find(40);
+    EXPECT_LT(comparisons, stats.comparisons);
+    EXPECT_EQ(1, stats.accesses);
+}
+#endif
+
+TEST(splay_tree_test, insertWithHint) {
+    SplayTree<int, int, Identity> set;
+    auto it = set.insertUniqueWithHint(set.end(), 10);
+    it = set.insertUniqueWithHint(it, 5);
+    EXPECT_EQ(5, *it);
+    set.insertUniqueWithHint(set.end(), 20);
+    set.insertUniqueWithHint(set.find(20), 15);
+    // Wrong hints are ignored, as are duplicates.
+    set.insertUniqueWithHint(set.begin(), 30);
+    EXPECT_EQ(15, *set.insertUniqueWithHint(set.end(), 15));
+    EXPECT_EQ(7, *set.emplaceUniqueWithHint(set.find(10), 7));
+    EXPECT_EQ(6, set.size());
+    const std::vector<int> expected{5, 7, 10, 15, 20, 30};
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), set.begin()));
+
+    SplayTree<std::string, std::string, Identity> multiset;
+    for (const char* key : {"a", "b", "b", "c"}) {
+        multiset.insertEqual(std::string(key));
+    }
+    auto firstB = multiset.find("b");
+    EXPECT_EQ(firstB, std::next(multiset.insertEqualWithHint(firstB, std::string("b"))));
+    EXPECT_EQ("b", *multiset.emplaceEqualWithHint(multiset.end(), "b"));
+    EXPECT_EQ("c", *multiset.rbegin());
+    EXPECT_EQ(6, multiset.size());
+    EXPECT_EQ(4, multiset.count("b"));
+}
+
+#ifdef SPLAY_TREE_ENABLE_STATS
+TEST(splay_tree_test, appendIsCheap) {
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        NullNodeUpdate, SplayOnWrite> plainInsert;
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        NullNodeUpdate, SplayOnWrite> hintedInsert;
+    for (int i = 0; i < 1000; ++i) {
+        plainInsert.insertUnique(i);
+        hintedInsert.insertUniqueWithHint(hintedInsert.end(), i);
+    }
+    // Every key lands below the maximum, which is the root: one rotation.
+    EXPECT_EQ(999, plainInsert.stats().rotations);
+    EXPECT_EQ(999, hintedInsert.stats().rotations);
+
+    // Hints next to the previous insertion work on the splayed root.
+    SplayTree<int, int, Identity> descending;
+    auto hint = descending.insertUniqueWithHint(descending.end(), 1000);
+    for (int i = 999; i >= 0; --i) {
+        hint = descending.insertUniqueWithHint(hint, i);
+    }
+    EXPECT_EQ(1000, descending.stats().rotations);
+    EXPECT_EQ(0, *descending.begin());
+}
+#endif
+
+TEST(splay_tree_test, batchLookups) {
+    SplayTree<int, int, Identity> tree;
+    const std::vector<int> probes{9, 1, 4, 4, 12, 0, 6};
+    std::vector<bool> contained;
+    tree.containsBatch(probes.begin(), probes.end(), std::back_inserter(contained));
+    EXPECT_EQ(std::vector<bool>(probes.size(), false), contained);
+
+    for (int key : {6, 2, 4, 8, 4, 10, 0}) {
+        tree.insertEqual(key);
+    }
+    contained.clear();
+    tree.containsBatch(probes.begin(), probes.end(), std::back_inserter(contained));
+    const std::vector<bool> expectedContained{
+        false, false, true, true, false, true, true};
+    EXPECT_EQ(expectedContained, contained);
+
+    std::vector<size_t> counts;
+    tree.countBatch(probes.begin(), probes.end(), std::back_inserter(counts));
+    const std::vector<size_t> expectedCounts{0, 0, 2, 2, 0, 1, 1};
+    EXPECT_EQ(expectedCounts, counts);
+
+    std::vector<int> sortedProbes(probes);
+    std::sort(sortedProbes.begin(), sortedProbes.end());
+    std::vector<SplayTree<int, int, Identity>::const_iterator> found;
+    tree.findBatch(sortedProbes.begin(), sortedProbes.end(), std::back_inserter(found));
+    ASSERT_EQ(sortedProbes.size(), found.size());
+    // Duplicates are found at their first occurrence.
+    for (size_t i = 0; i < found.size(); ++i) {
+        const auto& constTree = tree;
+        const auto expected = constTree.count(sortedProbes[i]) ?
+            constTree.lower_bound(sortedProbes[i]) : constTree.end();
+        EXPECT_EQ(expected, found[i]);
+    }
+}
+
+namespace {
+
+typedef SplayTree<int, int, Identity> IntTree;
+
+IntTree makeTree(const std::vector<int>& keys) {
+    IntTree tree;
+    tree.insertUnique(keys.begin(), keys.end());
+    return tree;
+}
+
+} // namespace
+
+TEST(splay_tree_test, setAlgebra) {
+    const std::vector<int> leftKeys{1, 3, 5, 7, 9, 11};
+    const std::vector<int> rightKeys{2, 3, 4, 9, 10, 20};
+
+    IntTree left = makeTree(leftKeys);
+    IntTree right = makeTree(rightKeys);
+    std::set<const int*> nodes;
+    for (const int& key : left) {
+        nodes.insert(&key);
+    }
+    for (const int& key : right) {
+        nodes.insert(&key);
+    }
+    left.unionWith(std::move(right));
+    EXPECT_TRUE(right.empty());
+    const std::vector<int> expectedUnion{1, 2, 3, 4, 5, 7, 9, 10, 11, 20};
+    EXPECT_EQ(expectedUnion.size(), left.size());
+    EXPECT_TRUE(std::equal(expectedUnion.begin(), expectedUnion.end(), left.begin()));
+    // The result is made of the original nodes.
+    for (const int& key : left) {
+        EXPECT_EQ(1, nodes.count(&key));
+    }
+
+    IntTree intersection = makeTree(leftKeys);
+    intersection.intersectWith(makeTree(rightKeys));
+    const std::vector<int> expectedIntersection{3, 9};
+    EXPECT_EQ(expectedIntersection.size(), intersection.size());
+    EXPECT_TRUE(std::equal(
+        expectedIntersection.begin(),
+        expectedIntersection.end(),
+        intersection.begin()));
+
+    IntTree difference = makeTree(leftKeys);
+    const IntTree subtrahend = makeTree(rightKeys);
+    difference.differenceWith(subtrahend);
+    const std::vector<int> expectedDifference{1, 5, 7, 11};
+    EXPECT_EQ(expectedDifference.size(), difference.size());
+    EXPECT_TRUE(std::equal(
+        expectedDifference.begin(),
+        expectedDifference.end(),
+        difference.begin()));
+    EXPECT_EQ(rightKeys.size(), subtrahend.size());
+
+    IntTree empty;
+    empty.intersectWith(subtrahend);
+    EXPECT_TRUE(empty.empty());
+    empty.unionWith(subtrahend);
+    EXPECT_TRUE(std::equal(rightKeys.begin(), rightKeys.end(), empty.begin()));
+}
+
+TEST(splay_tree_test, parallelBulkOperations) {
+    // A small grain makes even this tree fork on several levels.
+    ParallelOptions options;
+    options.threads = 8;
+    options.grain = 4;
+
+    std::vector<int> keys;
+    for (int key = 0; key < 1000; ++key) {
+        keys.push_back(key);
+    }
+    SplayTree<int, int, Identity, std::less<int>, std::allocator<int>,
+        SubtreeSizeNodeUpdate> tree;
+    parallel_assign_sorted(tree, keys.begin(), keys.end(), options);
+    EXPECT_EQ(keys.size(), tree.size());
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), tree.begin()));
+    EXPECT_EQ(999, *tree.rbegin());
+    EXPECT_EQ(500, *tree.nth(500));
+
+    tree.erase(500);
+    auto copy = parallel_copy(tree, options);
+    EXPECT_EQ(tree.size(), copy.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), copy.begin()));
+    EXPECT_EQ(501, *copy.nth(500));
+    EXPECT_EQ(0, *copy.begin());
+
+    std::vector<int> visited;
+    std::mutex mutex;
+    parallel_for_each(copy, [&](int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        visited.push_back(key);
+    }, options);
+    std::sort(visited.begin(), visited.end());
+    EXPECT_TRUE(std::equal(visited.begin(), visited.end(), tree.begin()));
+
+    const long sum = parallel_accumulate(
+        copy,
+        0L, std::plus<long>(), std::plus<long>(), options);
+    EXPECT_EQ(999 * 1000 / 2 - 500, sum);
+    // Concatenation is not commutative, so this checks the order of parts.
+    const std::string digits = parallel_accumulate(
+        copy,
+        std::string(),
+        [](const std::string& prefix, int key) {
+            return prefix + static_cast<char>('0' + key % 10);
+        },
+        [](const std::string& lhs, const std::string& rhs) {
+            return lhs + rhs;
+        },
+        options);
+    EXPECT_EQ(copy.size(), digits.size());
+    EXPECT_EQ("0123456789", digits.substr(0, 10));
+    EXPECT_EQ("9123", digits.substr(499, 4));
+
+    parallel_clear(copy, options);
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(copy.end(), copy.begin());
+    EXPECT_EQ(0, parallel_accumulate(copy, 0, std::plus<int>(), std::plus<int>()));
+    copy.insertUnique(1);
+    EXPECT_EQ(1, copy.size());
+
+    parallel_assign_sorted(tree, keys.begin(), keys.begin() + 3);
+    EXPECT_EQ(3, tree.size());
+    EXPECT_EQ(2, *tree.nth(2));
+
+    // The containers go through the same implementation.
+    splay_tree::set<int> splayTreeSet;
+    parallel_assign_sorted(splayTreeSet, keys.begin(), keys.end(), options);
+    const splay_tree::set<int> setCopy = parallel_copy(splayTreeSet, options);
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), setCopy.begin()));
+    splay_tree::multiset<int> splayTreeMultiSet;
+    parallel_assign_sorted(splayTreeMultiSet, keys.begin(), keys.end(), options);
+    EXPECT_EQ(999 * 1000 / 2, parallel_accumulate(
+        splayTreeMultiSet, 0, std::plus<int>(), std::plus<int>(), options));
+    parallel_clear(splayTreeMultiSet, options);
+    EXPECT_TRUE(splayTreeMultiSet.empty());
+}
+
+TEST(splay_tree_test, copyOfDegenerateTree) {
+    // Ascending insertions leave a path: every new maximum is splayed to the
+    // root with all other nodes in its left spine. Copying it must neither
+    // recurse along the path nor keep its shape.
+    IntTree path;
+    const int size = 1000000;
+    for (int key = 0; key < size; ++key) {
+        path.insertUnique(key);
+    }
+    const IntTree copy(path);
+    EXPECT_EQ(path.size(), copy.size());
+    EXPECT_TRUE(std::equal(path.begin(), path.end(), copy.begin()));
+    EXPECT_EQ(0, *copy.begin());
+    EXPECT_EQ(size - 1, *copy.rbegin());
+    EXPECT_EQ(size - 1, *--copy.end());
+
+    IntTree assigned;
+    assigned = copy;
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(), assigned.begin()));
+}
+
+TEST(splay_tree_test, topDownSplay) {
+    SplayTree<std::string, std::string, Identity, std::less<std::string>,
+        std::allocator<std::string>, NullNodeUpdate, TopDownSplay> set;
+    for (const char* key : {"m", "c", "x", "a", "q"}) {
+        EXPECT_TRUE(set.emplaceUnique(key).second);
+    }
+    EXPECT_FALSE(set.emplaceUnique("q").second);
+    EXPECT_FALSE(set.insertUnique(std::string("a")).second);
+    EXPECT_EQ(5, set.size());
+    EXPECT_EQ("a", *set.begin());
+    EXPECT_EQ("x", *set.rbegin());
+
+    EXPECT_EQ("m", *set.find("m"));
+    EXPECT_EQ(set.end(), set.find("n"));
+    EXPECT_EQ("q", *set.lower_bound("n"));
+    EXPECT_EQ("q", *set.lower_bound("q"));
+    EXPECT_EQ("x", *set.upper_bound("q"));
+    EXPECT_EQ(set.end(), set.upper_bound("x"));
+    EXPECT_EQ(set.end(), set.lower_bound("y"));
+    EXPECT_EQ("a", *set.lower_bound(""));
+
+    const std::vector<std::string> expected{"a", "c", "m", "q", "x"};
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), set.begin()));
+}
+
+TEST(splay_tree_test, lightweightIterators) {
+    EXPECT_EQ(sizeof(void*), sizeof(IntTree::iterator));
+    EXPECT_EQ(sizeof(void*), sizeof(IntTree::const_iterator));
+
+    IntTree tree;
+    EXPECT_EQ(tree.begin(), tree.end());
+    const IntTree::iterator end = tree.end();
+    for (int key : {5, 1, 9, 3, 7}) {
+        tree.insertUnique(key);
+    }
+    // The end iterator survives insertions and erasures, and decrementing it
+    // reaches the maximum whatever was splayed last.
+    EXPECT_EQ(end, tree.end());
+    tree.find(1);
+    EXPECT_EQ(9, *--tree.end());
+    tree.erase(tree.find(9));
+    EXPECT_EQ(end, tree.end());
+    EXPECT_EQ(7, *std::prev(end));
+    EXPECT_EQ(end, std::next(tree.find(7)));
+
+    const std::vector<int> expected{7, 5, 3, 1};
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), tree.rbegin()));
+
+    // Moves and swaps keep iterators to the elements valid, end() belongs
+    // to each tree.
+    IntTree::iterator three = tree.find(3);
+    IntTree moved(std::move(tree));
+    EXPECT_EQ(3, *three);
+    EXPECT_EQ(moved.end(), std::next(moved.find(7)));
+    EXPECT_EQ(tree.begin(), tree.end());
+    IntTree other;
+    other.insertUnique(42);
+    other.swap(moved);
+    EXPECT_EQ(5, *++three);
+    EXPECT_EQ(other.end(), std::next(other.find(7)));
+    EXPECT_EQ(42, *--moved.end());
+    EXPECT_EQ(moved.end(), std::next(moved.begin()));
+}
+
+TEST(splay_tree_test, nodeHandles) {
+    typedef SplayTree<std::string, std::string, Identity, std::less<std::string>,
+        std::allocator<std::string>, SubtreeSizeNodeUpdate> StringTree;
+    StringTree source;
+    StringTree target;
+    for (const char* key : {"d", "b", "a", "c"}) {
+        source.insertUnique(std::string(key));
+    }
+    target.insertUnique(std::string("b"));
+
+    // The value stays where it was allocated.
+    const std::string* address = &*source.find("a");
+    StringTree::node_type node = source.extract(source.find("a"));
+    EXPECT_FALSE(node.empty());
+    EXPECT_EQ("a", node.value());
+    EXPECT_EQ(3, source.size());
+    EXPECT_EQ("b", *source.begin());
+    auto result = target.insertUnique(std::move(node));
+    EXPECT_TRUE(result.inserted);
+    EXPECT_TRUE(result.node.empty());
+    EXPECT_EQ(address, &*result.position);
+    EXPECT_EQ(2, target.size());
+    EXPECT_EQ("a", *target.begin());
+
+    // A present key hands the node back.
+    result = target.insertUnique(source.extract("b"));
+    EXPECT_FALSE(result.inserted);
+    EXPECT_EQ("b", result.node.value());
+    EXPECT_EQ("b", *result.position);
+    EXPECT_TRUE(source.extract("b").empty());
+    EXPECT_EQ(target.end(), target.insertEqual(StringTree::node_type()));
+    target.insertEqual(std::move(result.node));
+    EXPECT_EQ(3, target.size());
+
+    // Keys are overlapping, the metadata of relinked nodes stays right.
+    source.insertUnique(std::string("a"));
+    target.spliceUnique(source);
+    EXPECT_EQ(1, source.size());
+    EXPECT_EQ("a", *source.begin());
+    EXPECT_EQ(5, target.size());
+    const std::vector<std::string> expected{"a", "b", "b", "c", "d"};
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], *target.nth(i));
+    }
+    target.spliceEqual(source);
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(6, target.size());
+    EXPECT_EQ(2, target.rank("b"));
+}
+
+TEST(splay_tree_test, noexceptMoves) {
+    static_assert(std::is_nothrow_move_constructible<IntTree>::value, "");
+    static_assert(std::is_nothrow_move_assignable<IntTree>::value, "");
+    static_assert(noexcept(std::declval<IntTree&>().swap(std::declval<IntTree&>())), "");
+
+    // Relocation moves the trees, their nodes stay in place.
+    std::vector<IntTree> trees(1);
+    trees[0].insertUnique(1);
+    const int* address = &*trees[0].begin();
+    trees.resize(trees.capacity() + 1);
+    EXPECT_EQ(address, &*trees[0].begin());
+
+    typedef SplayTree<int, int, Identity, std::less<int>, TaggedAllocator<int>>
+        TaggedTree;
+    static_assert(!std::is_nothrow_move_assignable<TaggedTree>::value, "");
+    TaggedTree left(std::less<int>(), TaggedAllocator<int>(1));
+    TaggedTree sameTag(std::less<int>(), TaggedAllocator<int>(1));
+    TaggedTree otherTag(std::less<int>(), TaggedAllocator<int>(2));
+    for (int key : {3, 1, 2}) {
+        sameTag.insertUnique(key);
+        otherTag.insertUnique(key + 10);
+    }
+
+    // Equal allocators let the nodes move, different ones the values only.
+    address = &*sameTag.begin();
+    left = std::move(sameTag);
+    EXPECT_EQ(address, &*left.begin());
+    EXPECT_TRUE(sameTag.empty());
+    left = std::move(otherTag);
+    EXPECT_TRUE(otherTag.empty());
+    EXPECT_EQ(1, left.get_allocator().tag);
+    const std::vector<int> expected{11, 12, 13};
+    EXPECT_EQ(expected.size(), left.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), left.begin()));
+
+    TaggedTree moved(std::move(left));
+    EXPECT_EQ(1, moved.get_allocator().tag);
+    EXPECT_EQ(3, moved.size());
+    left.swap(sameTag);
+    EXPECT_TRUE(left.empty());
+}
+
+TEST(splay_tree_test, fingerSeek) {
+    IntTree tree;
+    for (int key = 0; key < 200; key += 2) {
+        tree.insertUnique(key);
+    }
+    const IntTree& constTree = tree;
+
+    auto finger = tree.finger();
+    EXPECT_EQ(tree.begin(), finger.position());
+    EXPECT_EQ(10, *finger.seek(9));
+    EXPECT_EQ(10, *finger.seek(10));
+    EXPECT_EQ(4, *finger.seek(3));
+    EXPECT_EQ(tree.end(), finger.seek(199));
+    EXPECT_EQ(198, *finger.seek(197));
+    EXPECT_EQ(0, *finger.seek(-5));
+    EXPECT_EQ(0, *finger.position());
+
+    // Random walks with and without splaying agree with lower_bound().
+    std::mt19937 mt(13);
+    std::uniform_int_distribution<int> step(-12, 12);
+    for (bool splays : {false, true}) {
+        auto walker = tree.finger(tree.find(100), splays);
+        int key = 100;
+        for (int i = 0; i < 2000; ++i) {
+            key = std::max(-3, std::min(203, key + step(mt)));
+            const auto expected = constTree.lower_bound(key);
+            EXPECT_EQ(expected, walker.seek(key));
+        }
+    }
+    EXPECT_EQ(100, tree.size());
+
+    IntTree empty;
+    EXPECT_EQ(empty.end(), empty.finger().seek(1));
+}
+
+TEST(splay_tree_test, deepest) {
+    typedef SplayTree<
+        int, int, Identity, std::less<int>, std::allocator<int>, SubtreeHeightNodeUpdate>
+        HeightTree;
+    HeightTree tree;
+    EXPECT_EQ(tree.cend(), tree.deepest());
+
+    // Every insertion of a new maximum splays it above the previous one.
+    for (int key = 0; key < 10; ++key) {
+        tree.insertUnique(key);
+    }
+    EXPECT_EQ(0, *tree.deepest());
+    while (!tree.empty()) {
+        tree.erase(tree.deepest());
+    }
+    EXPECT_EQ(tree.cend(), tree.deepest());
+
+    // Without splaying, a new key becomes a child of its predecessor or of
+    // its successor, whichever is deeper, which gives the depths to expect.
+    SplayTree<
+        int,
+        int,
+        Identity,
+        std::less<int>,
+        std::allocator<int>,
+        SubtreeHeightNodeUpdate,
+        SplayEveryKth<1000000>> unsplayed;
+    std::map<int, size_t> depths;
+    size_t maximumDepth = 0;
+    std::mt19937 mt(17);
+    for (int i = 0; i < 500; ++i) {
+        const int key = mt() % 10000;
+        if (!unsplayed.insertUnique(key).second) {
+            continue;
+        }
+        const auto position = depths.lower_bound(key);
+        size_t depth = 0;
+        if (position != depths.end()) {
+            depth = position->second + 1;
+        }
+        if (position != depths.begin()) {
+            depth = std::max(depth, std::prev(position)->second + 1);
+        }
+        depths[key] = depth;
+        maximumDepth = std::max(maximumDepth, depth);
+        ASSERT_EQ(maximumDepth, depths[*unsplayed.deepest()]);
+    }
+}
@@ -2,8 +2,11 @@
 #include "splay-tree/set.h"
 #include "splay-tree/multiset.h"
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 #include <random>
+#include <vector>
 
 // Test for insert, erase, count, lower_bound, upper_bound, size.
 TEST(splay_tree_test, stressTestWithSet) {
@@ -28,6 +31,7 @@ TEST(splay_tree_test, stressTestWithSet) {
         UPPER_BOUND,
         SIZE,
         VALIDATE_SIZE,
+        MIN_MAX,
         NUMBER_OF_OPERATIONS
     };
 
@@ -94,6 +98,13 @@ TEST(splay_tree_test, stressTestWithSet) {
                         splayTreeSet.begin(),
                         splayTreeSet.end()));
                 break;
+            case MIN_MAX:
+                EXPECT_EQ(stlSet.empty(), splayTreeSet.empty());
+                if (!stlSet.empty()) {
+                    EXPECT_EQ(*stlSet.begin(), *splayTreeSet.begin());
+                    EXPECT_EQ(*stlSet.rbegin(), *splayTreeSet.rbegin());
+                }
+                break;
         }
     }
 }
@@ -121,6 +132,7 @@ TEST(splay_tree_test, stressTestWithMultiSet) {
         UPPER_BOUND,
         SIZE,
         VALIDATE_SIZE,
+        MIN_MAX,
         NUMBER_OF_OPERATIONS
     };
 
@@ -134,8 +146,9 @@ TEST(splay_tree_test, stressTestWithMultiSet) {
                 {
                     int key = randomInt(mt);
                     auto stlMultiSetInsertResult = stlMultiSet.insert(key);
-                    auto splayTreeInsertResult =
-                        splayTreeMultiSet.insert(key);
+                    auto splayTreeInsertResult = i % 2 ?
+                        splayTreeMultiSet.insert(key) :
+                        splayTreeMultiSet.emplace(key);
                     EXPECT_EQ(
                         std::distance(
                             stlMultiSet.begin(),
@@ -191,6 +204,460 @@ TEST(splay_tree_test, stressTestWithMultiSet) {
                         splayTreeMultiSet.begin(),
                         splayTreeMultiSet.end()));
                 break;
+            case MIN_MAX:
+                EXPECT_EQ(stlMultiSet.empty(), splayTreeMultiSet.empty());
+                if (!stlMultiSet.empty()) {
+                    EXPECT_EQ(*stlMultiSet.begin(), *splayTreeMultiSet.begin());
+                    EXPECT_EQ(*stlMultiSet.rbegin(), *splayTreeMultiSet.rbegin());
+                }
+                break;
+        }
+    }
+}
+
+TEST(splay_tree_test, stressTestConstructionFromSorted) {
+    std::mt19937 mt(42);
+    std::uniform_int_distribution<int> randomInt(-1000, 1000);
+    for (int size = 0; size < 200; ++size) {
+        std::multiset<int> stlMultiSet;
+        for (int i = 0; i < size; ++i) {
+            stlMultiSet.insert(randomInt(mt));
+        }
+        std::set<int> stlSet(stlMultiSet.begin(), stlMultiSet.end());
+
+        splay_tree::multiset<int> splayTreeMultiSet(
+            splay_tree::from_sorted,
+            stlMultiSet.begin(),
+            stlMultiSet.end());
+        splay_tree::set<int> splayTreeSet(
+            splay_tree::from_sorted,
+            stlSet.begin(),
+            stlSet.end());
+        // The range constructor detects sorted input on its own.
+        splay_tree::set<int> detectedSplayTreeSet(
+            stlMultiSet.begin(),
+            stlMultiSet.end());
+
+        ASSERT_EQ(stlMultiSet.size(), splayTreeMultiSet.size());
+        EXPECT_TRUE(std::equal(
+            stlMultiSet.begin(),
+            stlMultiSet.end(),
+            splayTreeMultiSet.begin()));
+        ASSERT_EQ(stlSet.size(), splayTreeSet.size());
+        EXPECT_TRUE(std::equal(stlSet.begin(), stlSet.end(), splayTreeSet.begin()));
+        ASSERT_EQ(stlSet.size(), detectedSplayTreeSet.size());
+        EXPECT_TRUE(std::equal(
+            stlSet.begin(),
+            stlSet.end(),
+            detectedSplayTreeSet.begin()));
+
+        for (int key = -1001; key <= 1001; key += 7) {
+            EXPECT_EQ(stlMultiSet.count(key), splayTreeMultiSet.count(key));
+            EXPECT_EQ(stlSet.count(key), splayTreeSet.count(key));
+        }
+    }
+}
+
+TEST(splay_tree_test, stressTestOrderStatistics) {
+    splay_tree::multiset<
+        int,
+        std::less<int>,
+        std::allocator<int>,
+        splay_tree::SubtreeSizeNodeUpdate> splayTreeMultiSet;
+    std::multiset<int> stlMultiSet;
+
+    std::mt19937 mt(17);
+    std::uniform_int_distribution<int> randomInt(-300, 300);
+    for (int i = 0; i < 10000; ++i) {
+        const int key = randomInt(mt);
+        switch (mt() % 5) {
+            case 0:
+            case 1:
+                stlMultiSet.insert(key);
+                splayTreeMultiSet.insert(key);
+                break;
+            case 2:
+                EXPECT_EQ(stlMultiSet.erase(key), splayTreeMultiSet.erase(key));
+                break;
+            case 3:
+                EXPECT_EQ(
+                    std::distance(stlMultiSet.begin(), stlMultiSet.lower_bound(key)),
+                    splayTreeMultiSet.rank(key));
+                EXPECT_EQ(stlMultiSet.count(key), splayTreeMultiSet.count(key));
+                break;
+            case 4:
+                if (!stlMultiSet.empty()) {
+                    const size_t index = mt() % stlMultiSet.size();
+                    EXPECT_EQ(
+                        *std::next(stlMultiSet.begin(), index),
+                        *splayTreeMultiSet.nth(index));
+                }
+                break;
+        }
+    }
+}
+
+namespace {
+
+// The position an insertion returns, for both set and multiset.
+template<typename Iterator>
+Iterator positionOf(Iterator position) {
+    return position;
+}
+
+template<typename Iterator>
+Iterator positionOf(const std::pair<Iterator, bool>& result) {
+    return result.first;
+}
+
+// Checks lookups, insertions and the subtree sizes against the std
+// container while the tree restructures itself according to its splay policy.
+template<typename SplayTreeContainer, typename StlContainer>
+void stressTestSplayPolicy() {
+    SplayTreeContainer splayTreeMultiSet;
+    StlContainer stlMultiSet;
+
+    std::mt19937 mt(23);
+    std::uniform_int_distribution<int> randomInt(-300, 300);
+    for (int i = 0; i < 10000; ++i) {
+        const int key = randomInt(mt);
+        switch (mt() % 6) {
+            case 0:
+                EXPECT_EQ(
+                    std::distance(
+                        stlMultiSet.begin(),
+                        positionOf(stlMultiSet.insert(key))),
+                    std::distance(
+                        splayTreeMultiSet.begin(),
+                        positionOf(splayTreeMultiSet.insert(key))));
+                break;
+            case 1:
+                // Alternate between a hint next to the key and a mostly
+                // useless one.
+                if (key % 2) {
+                    splayTreeMultiSet.insert(splayTreeMultiSet.lower_bound(key), key);
+                } else {
+                    splayTreeMultiSet.emplace_hint(splayTreeMultiSet.begin(), key);
+                }
+                stlMultiSet.insert(key);
+                EXPECT_EQ(stlMultiSet.size(), splayTreeMultiSet.size());
+                break;
+            case 2:
+                EXPECT_EQ(stlMultiSet.erase(key), splayTreeMultiSet.erase(key));
+                break;
+            case 3:
+                EXPECT_EQ(
+                    stlMultiSet.find(key) == stlMultiSet.end(),
+                    splayTreeMultiSet.find(key) == splayTreeMultiSet.end());
+                EXPECT_EQ(stlMultiSet.count(key), splayTreeMultiSet.count(key));
+                break;
+            case 4:
+                EXPECT_EQ(
+                    std::distance(stlMultiSet.begin(), stlMultiSet.lower_bound(key)),
+                    std::distance(
+                        splayTreeMultiSet.begin(),
+                        splayTreeMultiSet.lower_bound(key)));
+                EXPECT_EQ(
+                    std::distance(stlMultiSet.begin(), stlMultiSet.upper_bound(key)),
+                    std::distance(
+                        splayTreeMultiSet.begin(),
+                        splayTreeMultiSet.upper_bound(key)));
+                break;
+            case 5:
+                if (!stlMultiSet.empty()) {
+                    const size_t index = mt() % stlMultiSet.size();
+                    EXPECT_EQ(
+                        *std::next(stlMultiSet.begin(), index),
+                        *splayTreeMultiSet.nth(index));
+                }
+                break;
         }
     }
+    EXPECT_TRUE(std::equal(
+        stlMultiSet.begin(),
+        stlMultiSet.end(),
+        splayTreeMultiSet.begin()));
+    EXPECT_TRUE(std::equal(
+        stlMultiSet.rbegin(),
+        stlMultiSet.rend(),
+        splayTreeMultiSet.rbegin()));
+}
+
+template<typename SplayPolicy>
+void stressTestSplayPolicy() {
+    stressTestSplayPolicy<
+        splay_tree::multiset<
+            int,
+            std::less<int>,
+            std::allocator<int>,
+            splay_tree::SubtreeSizeNodeUpdate,
+            SplayPolicy>,
+        std::multiset<int>>();
+    stressTestSplayPolicy<
+        splay_tree::set<
+            int,
+            std::less<int>,
+            std::allocator<int>,
+            splay_tree::SubtreeSizeNodeUpdate,
+            SplayPolicy>,
+        std::set<int>>();
+}
+
+} // namespace
+
+TEST(splay_tree_test, stressTestSplayPolicies) {
+    stressTestSplayPolicy<splay_tree::AlwaysSplay>();
+    stressTestSplayPolicy<splay_tree::SplayOnWrite>();
+    stressTestSplayPolicy<splay_tree::SemiSplay>();
+    stressTestSplayPolicy<splay_tree::SplayEveryKth<3>>();
+    stressTestSplayPolicy<splay_tree::TopDownSplay>();
+}
+
+namespace {
+
+struct CountedKey {
+    explicit CountedKey(int key) :
+            key(key) {
+        ++constructions;
+    }
+
+    CountedKey(const CountedKey& rhs) :
+            key(rhs.key) {
+        ++constructions;
+    }
+
+    int key;
+    static int constructions;
+};
+
+int CountedKey::constructions = 0;
+
+struct TransparentLess {
+    typedef void is_transparent;
+
+    bool operator()(const CountedKey& lhs, const CountedKey& rhs) const {
+        return lhs.key < rhs.key;
+    }
+
+    bool operator()(const CountedKey& lhs, int rhs) const {
+        return lhs.key < rhs;
+    }
+
+    bool operator()(int lhs, const CountedKey& rhs) const {
+        return lhs < rhs.key;
+    }
+};
+
+} // namespace
+
+TEST(splay_tree_test, transparentLookup) {
+    splay_tree::multiset<CountedKey, TransparentLess> multiset;
+    for (int key : {1, 3, 3, 5, 7}) {
+        multiset.emplace(key);
+    }
+    splay_tree::set<CountedKey, TransparentLess> set;
+    set.insert(CountedKey(4));
+
+    CountedKey::constructions = 0;
+    EXPECT_EQ(3, multiset.find(3)->key);
+    EXPECT_EQ(multiset.end(), multiset.find(4));
+    EXPECT_EQ(2, multiset.count(3));
+    EXPECT_EQ(5, multiset.lower_bound(4)->key);
+    EXPECT_EQ(7, multiset.upper_bound(5)->key);
+    auto range = multiset.equal_range(3);
+    EXPECT_EQ(2, std::distance(range.first, range.second));
+    const auto& constMultiset = multiset;
+    EXPECT_EQ(1, constMultiset.count(1));
+    EXPECT_EQ(3, constMultiset.lower_bound(2)->key);
+    EXPECT_EQ(2, multiset.erase(3));
+    EXPECT_EQ(1, set.count(4));
+    EXPECT_EQ(0, set.erase(5));
+    EXPECT_EQ(0, CountedKey::constructions);
+
+    // The key of an inserted value is no longer copied.
+    set.insert(CountedKey(6));
+    EXPECT_EQ(2, CountedKey::constructions);
+    EXPECT_EQ(3, multiset.size());
+}
+
+TEST(splay_tree_test, stressTestBatchLookups) {
+    splay_tree::multiset<int> splayTreeMultiSet;
+    std::multiset<int> stlMultiSet;
+
+    std::mt19937 mt(31);
+    std::uniform_int_distribution<int> randomInt(-1000, 1000);
+    for (int i = 0; i < 2000; ++i) {
+        const int key = randomInt(mt);
+        splayTreeMultiSet.insert(key);
+        stlMultiSet.insert(key);
+    }
+
+    std::vector<int> probes(5000);
+    for (int& probe : probes) {
+        probe = randomInt(mt);
+    }
+    for (bool sorted : {false, true}) {
+        if (sorted) {
+            std::sort(probes.begin(), probes.end());
+        }
+        std::vector<size_t> counts;
+        splayTreeMultiSet.count_batch(
+            probes.begin(),
+            probes.end(),
+            std::back_inserter(counts));
+        std::vector<splay_tree::multiset<int>::iterator> found;
+        splayTreeMultiSet.find_batch(
+            probes.begin(),
+            probes.end(),
+            std::back_inserter(found));
+        ASSERT_EQ(probes.size(), counts.size());
+        ASSERT_EQ(probes.size(), found.size());
+        for (size_t i = 0; i < probes.size(); ++i) {
+            EXPECT_EQ(stlMultiSet.count(probes[i]), counts[i]);
+            if (counts[i]) {
+                EXPECT_EQ(probes[i], *found[i]);
+            } else {
+                EXPECT_EQ(splayTreeMultiSet.end(), found[i]);
+            }
+        }
+    }
+}
+
+namespace {
+
+template<typename SplayTreeContainer>
+void stressTestSetAlgebra() {
+    typedef std::vector<int> Keys;
+    std::mt19937 mt(37);
+    for (int round = 0; round < 200; ++round) {
+        // Sizes from empty to lopsided, keys dense enough to overlap.
+        std::uniform_int_distribution<int> randomInt(0, 1 + round % 50);
+        Keys leftKeys(mt() % 60);
+        Keys rightKeys(mt() % (round % 2 ? 5 : 60));
+        for (int& key : leftKeys) {
+            key = randomInt(mt);
+        }
+        for (int& key : rightKeys) {
+            key = randomInt(mt);
+        }
+        const SplayTreeContainer left(leftKeys.begin(), leftKeys.end());
+        const SplayTreeContainer right(rightKeys.begin(), rightKeys.end());
+
+        Keys expected;
+        SplayTreeContainer result = left;
+        result.union_with(SplayTreeContainer(right));
+        std::set_union(
+            left.begin(), left.end(), right.begin(), right.end(),
+            std::back_inserter(expected));
+        EXPECT_EQ(expected.size(), result.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), result.begin()));
+
+        expected.clear();
+        result = left;
+        result.intersect_with(right);
+        std::set_intersection(
+            left.begin(), left.end(), right.begin(), right.end(),
+            std::back_inserter(expected));
+        EXPECT_EQ(expected.size(), result.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), result.begin()));
+
+        expected.clear();
+        result = left;
+        result.difference_with(right);
+        std::set_difference(
+            left.begin(), left.end(), right.begin(), right.end(),
+            std::back_inserter(expected));
+        EXPECT_EQ(expected.size(), result.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), result.begin()));
+        // Subtree sizes survive the splits and merges.
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i], *result.nth(i));
+        }
+        EXPECT_TRUE(std::equal(expected.rbegin(), expected.rend(), result.rbegin()));
+    }
+}
+
+} // namespace
+
+TEST(splay_tree_test, stressTestSetAlgebra) {
+    stressTestSetAlgebra<splay_tree::set<
+        int,
+        std::less<int>,
+        std::allocator<int>,
+        splay_tree::SubtreeSizeNodeUpdate>>();
+    stressTestSetAlgebra<splay_tree::multiset<
+        int,
+        std::less<int>,
+        std::allocator<int>,
+        splay_tree::SubtreeSizeNodeUpdate>>();
+}
+
+namespace {
+
+template<typename SplayTreeContainer, bool IsUnique>
+void stressTestMergeByNodes() {
+    typedef std::vector<int> Keys;
+    std::mt19937 mt(41);
+    for (int round = 0; round < 200; ++round) {
+        std::uniform_int_distribution<int> randomInt(0, 1 + round % 50);
+        Keys leftKeys(mt() % 60);
+        Keys rightKeys(mt() % (round % 2 ? 5 : 60));
+        for (int& key : leftKeys) {
+            key = randomInt(mt);
+        }
+        for (int& key : rightKeys) {
+            key = randomInt(mt);
+        }
+        SplayTreeContainer result(leftKeys.begin(), leftKeys.end());
+        SplayTreeContainer source(rightKeys.begin(), rightKeys.end());
+
+        // Sets keep the common keys in source, multisets take everything.
+        Keys expected;
+        Keys expectedSource;
+        if (IsUnique) {
+            std::set_union(
+                result.begin(), result.end(), source.begin(), source.end(),
+                std::back_inserter(expected));
+            std::set_intersection(
+                source.begin(), source.end(), result.begin(), result.end(),
+                std::back_inserter(expectedSource));
+        } else {
+            std::merge(
+                result.begin(), result.end(), source.begin(), source.end(),
+                std::back_inserter(expected));
+        }
+        result.merge(source);
+        EXPECT_EQ(expected.size(), result.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), result.begin()));
+        EXPECT_EQ(expectedSource.size(), source.size());
+        EXPECT_TRUE(std::equal(
+            expectedSource.begin(), expectedSource.end(), source.begin()));
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i], *result.nth(i));
+        }
+
+        // Single nodes moved one by one.
+        SplayTreeContainer moved;
+        const size_t half = expected.size() / 2;
+        while (moved.size() < half) {
+            moved.insert(result.extract(result.begin()));
+        }
+        EXPECT_TRUE(std::equal(moved.begin(), moved.end(), expected.begin()));
+        EXPECT_TRUE(std::equal(result.begin(), result.end(), expected.begin() + half));
+    }
+}
+
+} // namespace
+
+TEST(splay_tree_test, stressTestMergeByNodes) {
+    stressTestMergeByNodes<splay_tree::set<
+        int,
+        std::less<int>,
+        std::allocator<int>,
+        splay_tree::SubtreeSizeNodeUpdate>, true>();
+    stressTestMergeByNodes<splay_tree::multiset<
+        int,
+        std::less<int>,
+        std::allocator<int>,
+        splay_tree::SubtreeSizeNodeUpdate>, false>();
 }
@@ -0,0 +1,335 @@
+#include "gtest/gtest.h"
+#include "splay-tree/splay-tree.h"
+#include "splay-tree/key-of-value.h"
+#include "splay-tree/key-traits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Built with SPLAY_TREE_DEBUG and SPLAY_TREE_ENABLE_STATS: random operations
+// validate the trees as they go, adversarial access sequences keep the work
+// done within budgets.
+
+using namespace splay_tree;
+
+namespace {
+
+template<typename NodeUpdate, typename SplayPolicy>
+using IntTree = SplayTree<
+    int, int, Identity, std::less<int>, std::allocator<int>, NodeUpdate, SplayPolicy>;
+
+template<typename Tree>
+void insertNode(Tree& tree, typename Tree::node_type&& node, std::true_type) {
+    EXPECT_TRUE(tree.insertUnique(std::move(node)).inserted);
+}
+
+template<typename Tree>
+void insertNode(Tree& tree, typename Tree::node_type&& node, std::false_type) {
+    tree.insertEqual(std::move(node));
+}
+
+template<typename Tree>
+void mergeBack(Tree& tree, Tree&& right, std::true_type) {
+    tree.mergeUnique(std::move(right));
+}
+
+template<typename Tree>
+void mergeBack(Tree& tree, Tree&& right, std::false_type) {
+    tree.mergeEqual(std::move(right));
+}
+
+// Runs random operations on the tree and on the std container it must equal,
+// validating the tree after every validateEvery operations.
+template<typename Tree, bool IsUnique>
+void checkRandomOperations(
+        size_t operations,
+        int maxKey,
+        size_t validateEvery,
+        unsigned seed) {
+    typedef typename std::conditional<
+        IsUnique, std::set<int>, std::multiset<int>>::type Reference;
+    typedef std::integral_constant<bool, IsUnique> Uniqueness;
+    Tree tree;
+    Reference reference;
+    std::mt19937 mt(seed);
+    std::uniform_int_distribution<int> keys(-maxKey, maxKey);
+    std::uniform_int_distribution<int> kinds(0, 9);
+    for (size_t i = 0; i < operations; ++i) {
+        const int key = keys(mt);
+        const bool validating = i % validateEvery == 0;
+        switch (kinds(mt)) {
+        case 0:
+        case 1:
+        case 2:
+            if (IsUnique) {
+                tree.insertUnique(key);
+            } else {
+                tree.insertEqual(key);
+            }
+            reference.insert(key);
+            break;
+        case 3:
+            ASSERT_EQ(reference.erase(key), tree.erase(key));
+            break;
+        case 4: {
+            const auto it = tree.find(key);
+            const auto expected = reference.find(key);
+            ASSERT_EQ(expected == reference.end(), it == tree.end());
+            if (it != tree.end()) {
+                tree.erase(it);
+                reference.erase(expected);
+            }
+            break;
+        }
+        case 5: {
+            const auto it = tree.lower_bound(key);
+            const auto expected = reference.lower_bound(key);
+            ASSERT_EQ(expected == reference.end(), it == tree.end());
+            if (it != tree.end()) {
+                ASSERT_EQ(*expected, *it);
+            }
+            break;
+        }
+        case 6: {
+            const auto it = tree.upper_bound(key);
+            const auto expected = reference.upper_bound(key);
+            ASSERT_EQ(expected == reference.end(), it == tree.end());
+            if (it != tree.end()) {
+                ASSERT_EQ(*expected, *it);
+            }
+            break;
+        }
+        case 7: {
+            auto node = tree.extract(key);
+            ASSERT_EQ(reference.count(key) != 0, !node.empty());
+            if (!node.empty()) {
+                if (validating) {
+                    ASSERT_NO_THROW(tree.validate());
+                }
+                insertNode(tree, std::move(node), Uniqueness());
+            }
+            break;
+        }
+        case 8: {
+            Tree right = tree.split(tree.lower_bound(key));
+            if (validating) {
+                ASSERT_NO_THROW(tree.validate());
+                ASSERT_NO_THROW(right.validate());
+            }
+            mergeBack(tree, std::move(right), Uniqueness());
+            break;
+        }
+        case 9:
+            tree.erase(tree.lower_bound(key), tree.lower_bound(key + 16));
+            reference.erase(reference.lower_bound(key), reference.lower_bound(key + 16));
+            break;
+        }
+        if (validating) {
+            ASSERT_NO_THROW(tree.validate());
+        }
+    }
+    ASSERT_NO_THROW(tree.validate());
+    ASSERT_EQ(reference.size(), tree.size());
+    ASSERT_TRUE(std::equal(reference.begin(), reference.end(), tree.begin()));
+}
+
+template<typename SplayPolicy>
+void checkPolicy() {
+    const size_t operations = 20000;
+    const int maxKey = 500;
+    checkRandomOperations<IntTree<NullNodeUpdate, SplayPolicy>, true>(
+        operations, maxKey, 1, 1);
+    checkRandomOperations<IntTree<NullNodeUpdate, SplayPolicy>, false>(
+        operations, maxKey, 1, 2);
+    checkRandomOperations<IntTree<SubtreeSizeNodeUpdate, SplayPolicy>, true>(
+        operations, maxKey, 1, 3);
+    checkRandomOperations<IntTree<SubtreeSizeNodeUpdate, SplayPolicy>, false>(
+        operations, maxKey, 1, 4);
+    checkRandomOperations<IntTree<SubtreeHeightNodeUpdate, SplayPolicy>, true>(
+        operations, maxKey, 1, 5);
+    checkRandomOperations<IntTree<SubtreeHeightNodeUpdate, SplayPolicy>, false>(
+        operations, maxKey, 1, 6);
+}
+
+// Runs the accesses on a tree of the keys 0, ..., size - 1 and returns the
+// rotations per access.
+template<typename SplayPolicy>
+double rotationsPerAccess(size_t size, const std::vector<int>& accesses) {
+    std::vector<int> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = static_cast<int>(i);
+    }
+    IntTree<SubtreeSizeNodeUpdate, SplayPolicy> tree(
+        from_sorted, keys.begin(), keys.end());
+    tree.resetStats();
+    for (int key : accesses) {
+        EXPECT_EQ(key, *tree.find(key));
+    }
+    EXPECT_NO_THROW(tree.validate());
+    return static_cast<double>(tree.stats().rotations) / accesses.size();
+}
+
+std::vector<int> sequentialAccesses(size_t size, size_t rounds) {
+    std::vector<int> accesses;
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < size; ++i) {
+            accesses.push_back(static_cast<int>(round % 2 ? size - 1 - i : i));
+        }
+    }
+    return accesses;
+}
+
+// The keys in the order of their reversed bits, which no splay tree can
+// serve in less than logarithmic time per access.
+std::vector<int> bitReversalAccesses(unsigned bits) {
+    std::vector<int> accesses(size_t(1) << bits);
+    for (size_t i = 0; i < accesses.size(); ++i) {
+        size_t reversed = 0;
+        for (unsigned bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        accesses[i] = static_cast<int>(reversed);
+    }
+    return accesses;
+}
+
+std::vector<int> alternatingAccesses(size_t size, size_t count) {
+    std::vector<int> accesses(count);
+    for (size_t i = 0; i < count; ++i) {
+        accesses[i] = static_cast<int>(i % 2 ? size - 1 - i / 2 % 16 : i / 2 % 16);
+    }
+    return accesses;
+}
+
+std::vector<int> randomAccesses(size_t size, size_t count, size_t workingSet) {
+    std::mt19937 mt(static_cast<unsigned>(size + workingSet));
+    std::uniform_int_distribution<size_t> indices(0, workingSet - 1);
+    std::vector<int> accesses(count);
+    for (auto& access : accesses) {
+        access = static_cast<int>(indices(mt) * (size / workingSet));
+    }
+    return accesses;
+}
+
+// A comparator whose order can be reversed behind the tree's back.
+struct FlippableLess {
+    bool operator()(int lhs, int rhs) const {
+        return *reversed ? rhs < lhs : lhs < rhs;
+    }
+
+    const bool* reversed;
+};
+
+} // namespace
+
+TEST(validation_test, randomOperationsAlwaysSplay) {
+    checkPolicy<AlwaysSplay>();
+}
+
+TEST(validation_test, randomOperationsTopDownSplay) {
+    checkPolicy<TopDownSplay>();
+}
+
+TEST(validation_test, randomOperationsSemiSplay) {
+    checkPolicy<SemiSplay>();
+}
+
+TEST(validation_test, randomOperationsSplayOnWrite) {
+    checkPolicy<SplayOnWrite>();
+}
+
+TEST(validation_test, randomOperationsSplayEveryKth) {
+    checkPolicy<SplayEveryKth<4>>();
+}
+
+// Trees without subtree sizes count the smaller part of every split, which
+// would make the runs here quadratic.
+TEST(validation_test, largeTrees) {
+    checkRandomOperations<IntTree<SubtreeSizeNodeUpdate, AlwaysSplay>, true>(
+        2000000, 1000000, 250000, 7);
+    checkRandomOperations<IntTree<SubtreeSizeNodeUpdate, TopDownSplay>, false>(
+        2000000, 1000000, 250000, 8);
+}
+
+TEST(validation_test, stringKeysWithPrefixes) {
+    typedef SplayTree<
+        std::string,
+        std::string,
+        Identity,
+        StringPrefixLess,
+        std::allocator<std::string>,
+        SubtreeSizeNodeUpdate> StringTree;
+    StringTree tree;
+    std::set<std::string> reference;
+    std::mt19937 mt(9);
+    std::uniform_int_distribution<int> lengths(0, 12);
+    std::uniform_int_distribution<int> bytes(0, 2);
+    for (size_t i = 0; i < 20000; ++i) {
+        std::string key(lengths(mt), 'a');
+        for (auto& c : key) {
+            c = "\0ab"[bytes(mt)];
+        }
+        if (i % 4 == 3) {
+            auto node = tree.extract(key);
+            ASSERT_EQ(reference.erase(key), node.empty() ? 0u : 1u);
+            if (!node.empty()) {
+                node.value().append("z");
+                if (tree.insertUnique(std::move(node)).inserted) {
+                    reference.insert(key + "z");
+                }
+            }
+        } else {
+            ASSERT_EQ(reference.insert(key).second, tree.insertUnique(key).second);
+        }
+        ASSERT_NO_THROW(tree.validate());
+    }
+    ASSERT_TRUE(std::equal(reference.begin(), reference.end(), tree.begin()));
+}
+
+TEST(validation_test, detectsBrokenOrder) {
+    bool reversed = false;
+    SplayTree<int, int, Identity, FlippableLess> tree(FlippableLess{&reversed});
+    for (int key = 0; key < 100; ++key) {
+        tree.insertUnique(key);
+    }
+    EXPECT_NO_THROW(tree.validate());
+    reversed = true;
+    EXPECT_THROW(tree.validate(), std::logic_error);
+}
+
+// Budgets on the rotations per access, about half as much again as the
+// current figures. A splay tree serves sequential accesses in linear time in
+// total, a working set in time logarithmic in its size and any sequence in
+// amortized logarithmic time. Top-down splaying counts only the rotations of
+// its zig-zig steps.
+TEST(validation_test, rotationBudgets) {
+    const size_t size = 1 << 16;
+    const double logSize = std::log2(static_cast<double>(size));
+
+    EXPECT_LT(rotationsPerAccess<AlwaysSplay>(size, sequentialAccesses(size, 4)), 2.0);
+    EXPECT_LT(rotationsPerAccess<TopDownSplay>(size, sequentialAccesses(size, 4)), 0.5);
+    EXPECT_LT(rotationsPerAccess<AlwaysSplay>(size, alternatingAccesses(size, size)), 8.0);
+    EXPECT_LT(
+        rotationsPerAccess<AlwaysSplay>(size, bitReversalAccesses(16)),
+        2.25 * logSize);
+    EXPECT_LT(
+        rotationsPerAccess<TopDownSplay>(size, bitReversalAccesses(16)),
+        1.25 * logSize);
+    EXPECT_LT(
+        rotationsPerAccess<AlwaysSplay>(size, randomAccesses(size, 4 * size, size)),
+        2.0 * logSize);
+    EXPECT_LT(
+        rotationsPerAccess<SemiSplay>(size, randomAccesses(size, 4 * size, size)),
+        1.25 * logSize);
+    EXPECT_LT(
+        rotationsPerAccess<AlwaysSplay>(size, randomAccesses(size, 4 * size, 16)),
+        5.0);
+}